@@ -26,6 +26,7 @@
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
 #include "Exports.h"
+#include "frameprof.h"
 
 //
 // Override the StudioModelRender virtual member functions here to implement custom bone
@@ -59,6 +60,7 @@ R_StudioDrawPlayer
 */
 int R_StudioDrawPlayer(int flags, entity_state_t* pplayer)
 {
+	FRAMEPROF_SCOPE(FRAMEPROF_STUDIO);
 	return static_cast<int>(g_StudioRenderer.StudioDrawPlayer(flags, pplayer));
 }
 
@@ -70,6 +72,7 @@ R_StudioDrawModel
 */
 int R_StudioDrawModel(int flags)
 {
+	FRAMEPROF_SCOPE(FRAMEPROF_STUDIO);
 	return static_cast<int>(g_StudioRenderer.StudioDrawModel(flags));
 }
 
@@ -10,16 +10,22 @@
 #include "cl_entity.h"
 #include "dlight.h"
 #include "triangleapi.h"
+#include "entity_types.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <memory.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include "studio_util.h"
 #include "r_studioint.h"
 
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
+#include "frameprof.h"
 
 extern cvar_t* tfc_newmodels;
 
@@ -36,6 +42,315 @@ int m_nPlayerGaitSequences[MAX_PLAYERS];
 // Global engine <-> studio model rendering code interface
 engine_studio_api_t IEngineStudio;
 
+// Animation track cursors, one set per entity and blend animation
+#define STUDIO_CURSOR_SETS 128 // must be a power of two
+
+typedef struct
+{
+	int entity;
+	const studiohdr_t* phdr;
+	int length; // of phdr, in case another model is loaded at the same address
+	const mstudioanim_t* panim;
+	studio_animcursor_t tracks[MAXSTUDIOBONES][6];
+} studio_cursorset_t;
+
+// Per thread, the bone jobs decode animations on several threads at once
+static thread_local studio_cursorset_t g_StudioCursorSets[STUDIO_CURSOR_SETS];
+
+static studio_animcursor_t (*StudioAnimCursors(int entity, const studiohdr_t* phdr, const mstudioanim_t* panim))[6]
+{
+	if (phdr->numbones > MAXSTUDIOBONES)
+		return NULL;
+
+	const unsigned int hash = ((unsigned int)entity * 31 + (unsigned int)((size_t)panim >> 4)) & (STUDIO_CURSOR_SETS - 1);
+	studio_cursorset_t* pset = &g_StudioCursorSets[hash];
+
+	if (pset->entity != entity || pset->phdr != phdr || pset->length != phdr->length || pset->panim != panim)
+	{
+		pset->entity = entity;
+		pset->phdr = phdr;
+		pset->length = phdr->length;
+		pset->panim = panim;
+		memset(pset->tracks, -1, phdr->numbones * sizeof(pset->tracks[0]));
+	}
+
+	return pset->tracks;
+}
+
+// Skeletons from the last StudioSetupBones of each entity
+#define STUDIO_BONECACHE_SLOTS 256 // must be a power of two
+
+typedef struct
+{
+	studio_bonekey_t key;
+	int numbones; // 0 if the slot is empty
+	int allocated;
+	float (*bonetransform)[3][4];
+	float (*lighttransform)[3][4];
+} studio_bonecache_t;
+
+static studio_bonecache_t g_StudioBoneCache[STUDIO_BONECACHE_SLOTS];
+
+static void StudioBoneCacheStore(studio_bonecache_t* pcache, const studio_bonekey_t* pkey, int numbones, const float bonetransform[][3][4], const float lighttransform[][3][4])
+{
+	if (pcache->allocated < numbones)
+	{
+		delete[] pcache->bonetransform;
+		delete[] pcache->lighttransform;
+		pcache->bonetransform = new float[numbones][3][4];
+		pcache->lighttransform = new float[numbones][3][4];
+		pcache->allocated = numbones;
+	}
+
+	pcache->key = *pkey;
+	pcache->numbones = numbones;
+	memcpy(pcache->bonetransform, bonetransform, numbones * sizeof(pcache->bonetransform[0]));
+	memcpy(pcache->lighttransform, lighttransform, numbones * sizeof(pcache->lighttransform[0]));
+}
+
+// Visible studio entities, gathered by HUD_AddEntity and built by StudioPrepareFrame
+#define STUDIO_MAX_BONEJOBS 256
+#define STUDIO_MIN_BONEJOBS 4 // fewer than this aren't worth waking the workers for
+#define STUDIO_MAX_WORKERS 8
+
+struct studio_bonejob_s
+{
+	cl_entity_t* entity;
+	model_t* model;
+	studiohdr_t* header;
+	player_info_t* playerinfo; // NULL unless a player
+	double time;
+	double frame;
+	bool cacheable; // store in the bone cache once built
+	bool built;
+	bool hardware; // m_fHardware of the renderer that prepared it
+	studio_bonekey_t key;
+	Vector gaitangles; // players, angles set by StudioProcessGait
+	float rotationmatrix[3][4];
+	float aliastransform[3][4];
+	float bonetransform[MAXSTUDIOBONES][3][4];
+	float lighttransform[MAXSTUDIOBONES][3][4];
+};
+
+typedef struct
+{
+	cl_entity_t* entity;
+	int type;
+} studio_queued_t;
+
+static studio_queued_t g_StudioQueue[STUDIO_MAX_BONEJOBS];
+static int g_iStudioQueued;
+static bool g_fStudioQueueSealed; // HUD_CreateEntities ran, the next HUD_AddEntity starts a new list
+
+static studio_bonejob_t* g_pStudioJobs[STUDIO_MAX_BONEJOBS];
+static int g_iStudioJobs;
+static int g_iStudioJobCursor; // draw order mostly follows the queue order
+
+// Jobs that still have to be built, run by the workers and the main thread
+static studio_bonejob_t* g_pStudioWork[STUDIO_MAX_BONEJOBS];
+static int g_iStudioWork;
+
+struct StudioWorkers
+{
+	std::thread Threads[STUDIO_MAX_WORKERS];
+	CStudioModelRenderer* Renderers[STUDIO_MAX_WORKERS + 1]; // the last one is used by the main thread
+	int Count = 0;
+	bool Started = false;
+
+	std::mutex Mutex;
+	std::condition_variable Wake;
+	std::condition_variable Done;
+	int Generation = 0;
+	int Busy = 0;
+	bool QuittingTime = false;
+
+	std::atomic<int> NextJob{0};
+};
+
+static StudioWorkers g_StudioWorkers;
+
+static void StudioRunBoneJobs(CStudioModelRenderer* prenderer)
+{
+	int i;
+
+	while ((i = g_StudioWorkers.NextJob++) < g_iStudioWork)
+		prenderer->StudioRunBoneJob(g_pStudioWork[i]);
+}
+
+static void StudioWorkerThread(int worker)
+{
+	int generation = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock lock{g_StudioWorkers.Mutex};
+
+			g_StudioWorkers.Wake.wait(lock, [&]() { return g_StudioWorkers.QuittingTime || g_StudioWorkers.Generation != generation; });
+
+			if (g_StudioWorkers.QuittingTime)
+				return;
+
+			generation = g_StudioWorkers.Generation;
+		}
+
+		StudioRunBoneJobs(g_StudioWorkers.Renderers[worker]);
+
+		{
+			std::lock_guard guard{g_StudioWorkers.Mutex};
+
+			if (--g_StudioWorkers.Busy == 0)
+				g_StudioWorkers.Done.notify_one();
+		}
+	}
+}
+
+static void StudioStartWorkers()
+{
+	g_StudioWorkers.Started = true;
+	g_StudioWorkers.Count = V_min((int)std::thread::hardware_concurrency() - 1, STUDIO_MAX_WORKERS);
+
+	if (g_StudioWorkers.Count < 1)
+	{
+		g_StudioWorkers.Count = 0;
+		return;
+	}
+
+	for (int i = 0; i <= g_StudioWorkers.Count; i++)
+		g_StudioWorkers.Renderers[i] = new CStudioModelRenderer;
+
+	for (int i = 0; i < g_StudioWorkers.Count; i++)
+		g_StudioWorkers.Threads[i] = std::thread{&StudioWorkerThread, i};
+}
+
+/*
+====================
+StudioShutdownWorkers
+
+====================
+*/
+void StudioShutdownWorkers()
+{
+	if (g_StudioWorkers.Count == 0)
+		return;
+
+	{
+		std::lock_guard guard{g_StudioWorkers.Mutex};
+		g_StudioWorkers.QuittingTime = true;
+	}
+
+	g_StudioWorkers.Wake.notify_all();
+
+	for (int i = 0; i < g_StudioWorkers.Count; i++)
+		g_StudioWorkers.Threads[i].join();
+
+	for (int i = 0; i <= g_StudioWorkers.Count; i++)
+	{
+		delete g_StudioWorkers.Renderers[i];
+		g_StudioWorkers.Renderers[i] = NULL;
+	}
+
+	g_StudioWorkers.Count = 0;
+}
+
+/*
+====================
+StudioQueueEntity
+
+Called for every entity HUD_AddEntity lets through
+====================
+*/
+void StudioQueueEntity(int type, cl_entity_t* ent)
+{
+	if (g_fStudioQueueSealed)
+	{
+		g_iStudioQueued = 0;
+		g_fStudioQueueSealed = false;
+	}
+
+	if (type != ET_NORMAL && type != ET_PLAYER)
+		return;
+
+	if (!ent->model || ent->model->type != mod_studio || g_iStudioQueued == STUDIO_MAX_BONEJOBS)
+		return;
+
+	g_StudioQueue[g_iStudioQueued].entity = ent;
+	g_StudioQueue[g_iStudioQueued].type = type;
+	g_iStudioQueued++;
+}
+
+/*
+====================
+StudioSealQueue
+
+From HUD_CreateEntities, every visible entity has been queued
+====================
+*/
+void StudioSealQueue()
+{
+	g_fStudioQueueSealed = true;
+}
+
+/*
+====================
+StudioFindSpan
+
+Walks an RLE track to the span holding frame, returning it with k
+set to the frame's position in the span. Starts from the cursor if
+the cursor's span begins at or before frame, then moves the cursor.
+====================
+*/
+static mstudioanimvalue_t* StudioFindSpan(mstudioanimvalue_t* ptrack, int frame, int& k, studio_animcursor_t* pcursor)
+{
+	mstudioanimvalue_t* panimvalue = ptrack;
+	bool reset = false;
+
+	k = frame;
+
+	if (pcursor && pcursor->frame >= 0 && pcursor->frame <= frame)
+	{
+		panimvalue = ptrack + pcursor->offset;
+		k = frame - pcursor->frame;
+	}
+	// DEBUG
+	else if (panimvalue->num.total < panimvalue->num.valid)
+	{
+		k = 0;
+		reset = true;
+	}
+
+	// find span of values that includes the frame we want
+	while (panimvalue->num.total <= k)
+	{
+		k -= panimvalue->num.total;
+		panimvalue += panimvalue->num.valid + 1;
+		// DEBUG
+		if (panimvalue->num.total < panimvalue->num.valid)
+		{
+			k = 0;
+			reset = true;
+		}
+	}
+
+	if (pcursor)
+	{
+		const int offset = panimvalue - ptrack;
+
+		// a corrupt track isn't worth remembering
+		if (reset || offset > 0xFFFF || frame - k > 0x7FFF)
+		{
+			pcursor->frame = -1;
+		}
+		else
+		{
+			pcursor->offset = offset;
+			pcursor->frame = frame - k;
+		}
+	}
+
+	return panimvalue;
+}
+
 /////////////////////
 // Implementation of CStudioModelRenderer.h
 
@@ -51,6 +366,8 @@ void CStudioModelRenderer::Init()
 	m_pCvarHiModels = IEngineStudio.GetCvar("cl_himodels");
 	m_pCvarDeveloper = IEngineStudio.GetCvar("developer");
 	m_pCvarDrawEntities = IEngineStudio.GetCvar("r_drawentities");
+	m_pCvarBoneCache = CVAR_CREATE("cl_bonecache", "1", FCVAR_ARCHIVE);
+	m_pCvarStudioThreads = CVAR_CREATE("cl_studiothreads", "1", FCVAR_ARCHIVE);
 
 	m_pChromeSprite = IEngineStudio.GetChromeSprite();
 
@@ -77,6 +394,10 @@ CStudioModelRenderer::CStudioModelRenderer()
 	m_pCvarHiModels = NULL;
 	m_pCvarDeveloper = NULL;
 	m_pCvarDrawEntities = NULL;
+	m_pCvarBoneCache = NULL;
+	m_pCvarStudioThreads = NULL;
+	m_nPreparedFrame = -1;
+	m_fHardware = false;
 	m_pChromeSprite = NULL;
 	m_pStudioModelCount = NULL;
 	m_pModelsDrawn = NULL;
@@ -84,6 +405,7 @@ CStudioModelRenderer::CStudioModelRenderer()
 	m_paliastransform = NULL;
 	m_pbonetransform = NULL;
 	m_plighttransform = NULL;
+	m_pBoneCursors = NULL;
 	m_pStudioHeader = NULL;
 	m_pBodyPart = NULL;
 	m_pSubModel = NULL;
@@ -192,19 +514,7 @@ void CStudioModelRenderer::StudioCalcBoneQuaterion(int frame, float s, mstudiobo
 		}
 		else
 		{
-			panimvalue = (mstudioanimvalue_t*)((byte*)panim + panim->offset[j + 3]);
-			k = frame;
-			// DEBUG
-			if (panimvalue->num.total < panimvalue->num.valid)
-				k = 0;
-			while (panimvalue->num.total <= k)
-			{
-				k -= panimvalue->num.total;
-				panimvalue += panimvalue->num.valid + 1;
-				// DEBUG
-				if (panimvalue->num.total < panimvalue->num.valid)
-					k = 0;
-			}
+			panimvalue = StudioFindSpan((mstudioanimvalue_t*)((byte*)panim + panim->offset[j + 3]), frame, k, m_pBoneCursors ? &m_pBoneCursors[j + 3] : NULL);
 			// Bah, missing blend!
 			if (panimvalue->num.valid > k)
 			{
@@ -273,25 +583,7 @@ void CStudioModelRenderer::StudioCalcBonePosition(int frame, float s, mstudiobon
 		pos[j] = pbone->value[j]; // default;
 		if (panim->offset[j] != 0)
 		{
-			panimvalue = (mstudioanimvalue_t*)((byte*)panim + panim->offset[j]);
-			/*
-			if (i == 0 && j == 0)
-				Con_DPrintf("%d  %d:%d  %f\n", frame, panimvalue->num.valid, panimvalue->num.total, s );
-			*/
-
-			k = frame;
-			// DEBUG
-			if (panimvalue->num.total < panimvalue->num.valid)
-				k = 0;
-			// find span of values that includes the frame we want
-			while (panimvalue->num.total <= k)
-			{
-				k -= panimvalue->num.total;
-				panimvalue += panimvalue->num.valid + 1;
-				// DEBUG
-				if (panimvalue->num.total < panimvalue->num.valid)
-					k = 0;
-			}
+			panimvalue = StudioFindSpan((mstudioanimvalue_t*)((byte*)panim + panim->offset[j]), frame, k, m_pBoneCursors ? &m_pBoneCursors[j] : NULL);
 			// if we're inside the span
 			if (panimvalue->num.valid > k)
 			{
@@ -333,28 +625,13 @@ StudioSlerpBones
 */
 void CStudioModelRenderer::StudioSlerpBones(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s)
 {
-	int i;
-	vec4_t q3;
-	float s1;
-
 	if (s < 0)
 		s = 0;
 	else if (s > 1.0)
 		s = 1.0;
 
-	s1 = 1.0 - s;
-
-	for (i = 0; i < m_pStudioHeader->numbones; i++)
-	{
-		QuaternionSlerp(q1[i], q2[i], s, q3);
-		q1[i][0] = q3[0];
-		q1[i][1] = q3[1];
-		q1[i][2] = q3[2];
-		q1[i][3] = q3[3];
-		pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s;
-		pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s;
-		pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s;
-	}
+	QuaternionSlerpArray(q1, q2, s, m_pStudioHeader->numbones);
+	VectorLerpArray(pos1, pos2, s, m_pStudioHeader->numbones);
 }
 
 /*
@@ -622,8 +899,12 @@ void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudi
 
 	StudioCalcBoneAdj(dadt, adj, m_pCurrentEntity->curstate.controller, m_pCurrentEntity->latched.prevcontroller, m_pCurrentEntity->mouth.mouthopen);
 
+	studio_animcursor_t(*cursors)[6] = StudioAnimCursors(m_pCurrentEntity->index, m_pStudioHeader, panim);
+
 	for (i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++)
 	{
+		m_pBoneCursors = cursors ? cursors[i] : NULL;
+
 		StudioCalcBoneQuaterion(frame, s, pbone, panim, adj, q[i]);
 
 		StudioCalcBonePosition(frame, s, pbone, panim, adj, pos[i]);
@@ -631,6 +912,8 @@ void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudi
 		//	Con_DPrintf("%d %d %d %d\n", m_pCurrentEntity->curstate.sequence, frame, j, k );
 	}
 
+	m_pBoneCursors = NULL;
+
 	if ((pseqdesc->motiontype & STUDIO_X) != 0)
 	{
 		pos[pseqdesc->motionbone][0] = 0.0;
@@ -766,6 +1049,73 @@ float CStudioModelRenderer::StudioEstimateFrame(mstudioseqdesc_t* pseqdesc)
 	return f;
 }
 
+/*
+====================
+StudioBoneCacheable
+
+False if the skeleton depends on the time or random numbers
+====================
+*/
+bool CStudioModelRenderer::StudioBoneCacheable()
+{
+	if (!m_pCvarBoneCache || 0 == m_pCvarBoneCache->value || m_pStudioHeader->numbones > MAXSTUDIOBONES)
+		return false;
+
+	// blending out of the last sequence
+	if (m_fDoInterp &&
+		0 != m_pCurrentEntity->latched.sequencetime &&
+		(m_pCurrentEntity->latched.sequencetime + 0.2 > m_clTime) &&
+		(m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq))
+		return false;
+
+	switch (m_pCurrentEntity->curstate.renderfx)
+	{
+	case kRenderFxDistort:
+	case kRenderFxHologram:
+	case kRenderFxExplode:
+		return false;
+	}
+
+	return true;
+}
+
+/*
+====================
+StudioFillBoneKey
+
+Fills in the inputs of this StudioSetupBones call
+====================
+*/
+void CStudioModelRenderer::StudioFillBoneKey(double f, studio_bonekey_t* pkey)
+{
+	// memcmp'd, so the padding has to be zero too
+	memset(pkey, 0, sizeof(*pkey));
+
+	pkey->model = m_pRenderModel;
+	pkey->frame = f;
+	pkey->sequence = m_pCurrentEntity->curstate.sequence;
+	pkey->renderfx = m_pCurrentEntity->curstate.renderfx;
+	pkey->hardware = m_fHardware ? 1 : 0;
+	memcpy(pkey->controller, m_pCurrentEntity->curstate.controller, sizeof(pkey->controller));
+	memcpy(pkey->prevcontroller, m_pCurrentEntity->latched.prevcontroller, sizeof(pkey->prevcontroller));
+	memcpy(pkey->blending, m_pCurrentEntity->curstate.blending, sizeof(pkey->blending));
+	memcpy(pkey->prevblending, m_pCurrentEntity->latched.prevblending, sizeof(pkey->prevblending));
+	pkey->mouthopen = m_pCurrentEntity->mouth.mouthopen;
+
+	if (0 != memcmp(pkey->controller, pkey->prevcontroller, sizeof(pkey->controller)) || 0 != memcmp(pkey->blending, pkey->prevblending, sizeof(pkey->blending)))
+		pkey->dadt = StudioEstimateInterpolant();
+
+	if (m_pPlayerInfo)
+	{
+		pkey->gaitsequence = m_pPlayerInfo->gaitsequence;
+		pkey->gaitframe = m_pPlayerInfo->gaitframe;
+	}
+
+	memcpy(pkey->rotationmatrix, *m_protationmatrix, sizeof(pkey->rotationmatrix));
+	if (0 == pkey->hardware)
+		memcpy(pkey->aliastransform, *m_paliastransform, sizeof(pkey->aliastransform));
+}
+
 /*
 ====================
 StudioSetupBones
@@ -774,23 +1124,8 @@ StudioSetupBones
 */
 void CStudioModelRenderer::StudioSetupBones()
 {
-	int i;
 	double f;
-
-	mstudiobone_t* pbones;
 	mstudioseqdesc_t* pseqdesc;
-	mstudioanim_t* panim;
-
-	static float pos[MAXSTUDIOBONES][3];
-	static vec4_t q[MAXSTUDIOBONES];
-	float bonematrix[3][4];
-
-	static float pos2[MAXSTUDIOBONES][3];
-	static vec4_t q2[MAXSTUDIOBONES];
-	static float pos3[MAXSTUDIOBONES][3];
-	static vec4_t q3[MAXSTUDIOBONES];
-	static float pos4[MAXSTUDIOBONES][3];
-	static vec4_t q4[MAXSTUDIOBONES];
 
 	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq)
 	{
@@ -822,6 +1157,71 @@ void CStudioModelRenderer::StudioSetupBones()
 		//Con_DPrintf("%f %f\n", m_pCurrentEntity->prevframe, f );
 	}
 
+	studio_bonekey_t key;
+	StudioFillBoneKey(f, &key);
+
+	// Already built by the workers for this frame?
+	studio_bonejob_t* pjob = StudioFindBoneJob();
+
+	if (pjob && pjob->built && pjob->time == m_clTime && 0 == memcmp(&pjob->key, &key, sizeof(key)))
+	{
+		memcpy(*m_pbonetransform, pjob->bonetransform, m_pStudioHeader->numbones * sizeof(pjob->bonetransform[0]));
+		memcpy(*m_plighttransform, pjob->lighttransform, m_pStudioHeader->numbones * sizeof(pjob->lighttransform[0]));
+		return;
+	}
+
+	// Same inputs as the last time this entity was set up? Then the skeleton is too
+	studio_bonecache_t* pcache = NULL;
+
+	if (StudioBoneCacheable())
+	{
+		pcache = &g_StudioBoneCache[m_pCurrentEntity->index & (STUDIO_BONECACHE_SLOTS - 1)];
+
+		if (pcache->numbones == m_pStudioHeader->numbones && 0 == memcmp(&pcache->key, &key, sizeof(key)))
+		{
+			memcpy(*m_pbonetransform, pcache->bonetransform, pcache->numbones * sizeof(pcache->bonetransform[0]));
+			memcpy(*m_plighttransform, pcache->lighttransform, pcache->numbones * sizeof(pcache->lighttransform[0]));
+			m_pCurrentEntity->latched.prevframe = f;
+
+			g_FrameProfCounters[FRAMEPROF_COUNTER_BONES_CACHED]++;
+			return;
+		}
+	}
+
+	g_FrameProfCounters[FRAMEPROF_COUNTER_BONES_BUILT]++;
+
+	StudioBuildBones(pseqdesc, f);
+
+	if (pcache)
+		StudioBoneCacheStore(pcache, &key, m_pStudioHeader->numbones, *m_pbonetransform, *m_plighttransform);
+}
+
+/*
+====================
+StudioBuildBones
+
+Runs on the bone job workers as well, so only touches the current
+entity and the renderer's own members
+====================
+*/
+void CStudioModelRenderer::StudioBuildBones(mstudioseqdesc_t* pseqdesc, double f)
+{
+	int i;
+
+	mstudiobone_t* pbones;
+	mstudioanim_t* panim;
+
+	static thread_local float pos[MAXSTUDIOBONES][3];
+	static thread_local vec4_t q[MAXSTUDIOBONES];
+	float bonematrix[3][4];
+
+	static thread_local float pos2[MAXSTUDIOBONES][3];
+	static thread_local vec4_t q2[MAXSTUDIOBONES];
+	static thread_local float pos3[MAXSTUDIOBONES][3];
+	static thread_local vec4_t q3[MAXSTUDIOBONES];
+	static thread_local float pos4[MAXSTUDIOBONES][3];
+	static thread_local vec4_t q4[MAXSTUDIOBONES];
+
 	panim = StudioGetAnim(m_pRenderModel, pseqdesc);
 	StudioCalcRotations(pos, q, pseqdesc, panim, f);
 
@@ -860,8 +1260,8 @@ void CStudioModelRenderer::StudioSetupBones()
 		(m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq))
 	{
 		// blend from last sequence
-		static float pos1b[MAXSTUDIOBONES][3];
-		static vec4_t q1b[MAXSTUDIOBONES];
+		static thread_local float pos1b[MAXSTUDIOBONES][3];
+		static thread_local vec4_t q1b[MAXSTUDIOBONES];
 		float s;
 
 		if (m_pCurrentEntity->latched.prevsequence >= m_pStudioHeader->numseq)
@@ -962,9 +1362,9 @@ void CStudioModelRenderer::StudioSetupBones()
 
 		if (pbones[i].parent == -1)
 		{
-			if (0 != IEngineStudio.IsHardware())
+			if (m_fHardware)
 			{
-				ConcatTransforms((*m_protationmatrix), bonematrix, (*m_pbonetransform)[i]);
+				ConcatBoneTransforms((*m_protationmatrix), bonematrix, (*m_pbonetransform)[i]);
 
 				// MatrixCopy should be faster...
 				//ConcatTransforms ((*m_protationmatrix), bonematrix, (*m_plighttransform)[i]);
@@ -972,8 +1372,8 @@ void CStudioModelRenderer::StudioSetupBones()
 			}
 			else
 			{
-				ConcatTransforms((*m_paliastransform), bonematrix, (*m_pbonetransform)[i]);
-				ConcatTransforms((*m_protationmatrix), bonematrix, (*m_plighttransform)[i]);
+				ConcatBoneTransforms((*m_paliastransform), bonematrix, (*m_pbonetransform)[i]);
+				ConcatBoneTransforms((*m_protationmatrix), bonematrix, (*m_plighttransform)[i]);
 			}
 
 			// Apply client-side effects to the transformation matrix
@@ -981,12 +1381,316 @@ void CStudioModelRenderer::StudioSetupBones()
 		}
 		else
 		{
-			ConcatTransforms((*m_pbonetransform)[pbones[i].parent], bonematrix, (*m_pbonetransform)[i]);
-			ConcatTransforms((*m_plighttransform)[pbones[i].parent], bonematrix, (*m_plighttransform)[i]);
+			ConcatBoneTransforms((*m_pbonetransform)[pbones[i].parent], bonematrix, (*m_pbonetransform)[i]);
+			ConcatBoneTransforms((*m_plighttransform)[pbones[i].parent], bonematrix, (*m_plighttransform)[i]);
+		}
+	}
+}
+
+
+/*
+====================
+StudioPrepareFrame
+
+Called before every studio draw, the first one of a render frame sets
+up the transforms and gait of every queued entity the way the draw
+calls will, then builds their bones on the workers in one go
+====================
+*/
+void CStudioModelRenderer::StudioPrepareFrame()
+{
+	int i;
+
+	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
+
+	if (m_nFrameCount == m_nPreparedFrame)
+		return;
+
+	m_nPreparedFrame = m_nFrameCount;
+	m_fHardware = 0 != IEngineStudio.IsHardware();
+	g_iStudioJobs = 0;
+	g_iStudioJobCursor = 0;
+	g_iStudioWork = 0;
+
+	if (!m_pCvarStudioThreads || 0 == m_pCvarStudioThreads->value || !g_fStudioQueueSealed)
+		return;
+
+	if (!g_StudioWorkers.Started)
+		StudioStartWorkers();
+
+	if (g_StudioWorkers.Count == 0)
+		return;
+
+	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
+	IEngineStudio.GetAliasScale(&m_fSoftwareXScale, &m_fSoftwareYScale);
+
+	for (i = 0; i < g_iStudioQueued; i++)
+	{
+		if (StudioPrepareBoneJob(g_StudioQueue[i].entity, g_StudioQueue[i].type))
+			g_iStudioJobs++;
+	}
+
+	m_pCurrentEntity = NULL;
+	m_pPlayerInfo = NULL;
+
+	if (g_iStudioWork == 0)
+		return;
+
+	g_FrameProfCounters[FRAMEPROF_COUNTER_BONES_BUILT] += g_iStudioWork;
+	g_StudioWorkers.NextJob = 0;
+
+	if (g_iStudioWork < STUDIO_MIN_BONEJOBS)
+	{
+		StudioRunBoneJobs(g_StudioWorkers.Renderers[g_StudioWorkers.Count]);
+	}
+	else
+	{
+		{
+			std::lock_guard guard{g_StudioWorkers.Mutex};
+			g_StudioWorkers.Busy = g_StudioWorkers.Count;
+			g_StudioWorkers.Generation++;
+		}
+
+		g_StudioWorkers.Wake.notify_all();
+
+		StudioRunBoneJobs(g_StudioWorkers.Renderers[g_StudioWorkers.Count]);
+
+		std::unique_lock lock{g_StudioWorkers.Mutex};
+		g_StudioWorkers.Done.wait(lock, []() { return g_StudioWorkers.Busy == 0; });
+	}
+
+	for (i = 0; i < g_iStudioWork; i++)
+	{
+		studio_bonejob_t* pjob = g_pStudioWork[i];
+
+		if (pjob->cacheable)
+		{
+			studio_bonecache_t* pcache = &g_StudioBoneCache[pjob->entity->index & (STUDIO_BONECACHE_SLOTS - 1)];
+			StudioBoneCacheStore(pcache, &pjob->key, pjob->header->numbones, pjob->bonetransform, pjob->lighttransform);
+		}
+	}
+}
+
+/*
+====================
+StudioPrepareBoneJob
+
+Mirrors StudioDrawModel and StudioDrawPlayer up to StudioSetupBones.
+Returns false if the entity has to be set up when it's drawn instead.
+A job that isn't built still tells the draw call the gait has run.
+====================
+*/
+bool CStudioModelRenderer::StudioPrepareBoneJob(cl_entity_t* ent, int type)
+{
+	mstudioseqdesc_t* pseqdesc;
+	studio_bonejob_t* pjob;
+	double f;
+
+	if (g_iStudioJobs == STUDIO_MAX_BONEJOBS)
+		return false;
+
+	// random numbers, and the engine's own state between frames
+	switch (ent->curstate.renderfx)
+	{
+	case kRenderFxDistort:
+	case kRenderFxHologram:
+	case kRenderFxExplode:
+	case kRenderFxDeadPlayer:
+		return false;
+	}
+
+	if (type == ET_NORMAL && ent->curstate.movetype == MOVETYPE_FOLLOW)
+		return false;
+
+	pjob = g_pStudioJobs[g_iStudioJobs];
+
+	if (!pjob)
+		pjob = g_pStudioJobs[g_iStudioJobs] = new studio_bonejob_t;
+
+	pjob->entity = ent;
+	pjob->time = m_clTime;
+	pjob->built = false;
+
+	m_pCurrentEntity = ent;
+	m_pPlayerInfo = NULL;
+
+	if (type == ET_PLAYER)
+	{
+		entity_state_t* pplayer = IEngineStudio.GetPlayerState(ent->index - 1);
+
+		m_nPlayerIndex = pplayer->number - 1;
+
+		if (m_nPlayerIndex < 0 || m_nPlayerIndex >= gEngfuncs.GetMaxClients())
+			return false;
+
+		m_pRenderModel = IEngineStudio.SetupPlayerModel(m_nPlayerIndex);
+
+		if (m_pRenderModel == NULL)
+			return false;
+
+		m_pStudioHeader = (studiohdr_t*)IEngineStudio.Mod_Extradata(m_pRenderModel);
+
+		if (!m_pStudioHeader || m_pStudioHeader->numbones > MAXSTUDIOBONES)
+			return false;
+
+		IEngineStudio.StudioSetHeader(m_pStudioHeader);
+		IEngineStudio.SetRenderModel(m_pRenderModel);
+
+		if (0 != pplayer->gaitsequence)
+		{
+			Vector orig_angles;
+			m_pPlayerInfo = IEngineStudio.PlayerInfo(m_nPlayerIndex);
+
+			VectorCopy(m_pCurrentEntity->angles, orig_angles);
+
+			// the draw call will skip this, gait moves on every call
+			StudioProcessGait(pplayer);
+			VectorCopy(m_pCurrentEntity->angles, pjob->gaitangles);
+
+			m_pPlayerInfo->gaitsequence = pplayer->gaitsequence;
+			m_pPlayerInfo = NULL;
+
+			StudioSetUpTransform(false);
+			VectorCopy(orig_angles, m_pCurrentEntity->angles);
+		}
+		else
+		{
+			m_pCurrentEntity->curstate.controller[0] = 127;
+			m_pCurrentEntity->curstate.controller[1] = 127;
+			m_pCurrentEntity->curstate.controller[2] = 127;
+			m_pCurrentEntity->curstate.controller[3] = 127;
+			m_pCurrentEntity->latched.prevcontroller[0] = m_pCurrentEntity->curstate.controller[0];
+			m_pCurrentEntity->latched.prevcontroller[1] = m_pCurrentEntity->curstate.controller[1];
+			m_pCurrentEntity->latched.prevcontroller[2] = m_pCurrentEntity->curstate.controller[2];
+			m_pCurrentEntity->latched.prevcontroller[3] = m_pCurrentEntity->curstate.controller[3];
+
+			m_pPlayerInfo = IEngineStudio.PlayerInfo(m_nPlayerIndex);
+			m_pPlayerInfo->gaitsequence = 0;
+
+			StudioSetUpTransform(false);
 		}
+
+		m_pPlayerInfo = IEngineStudio.PlayerInfo(m_nPlayerIndex);
 	}
+	else
+	{
+		m_pRenderModel = m_pCurrentEntity->model;
+		m_pStudioHeader = (studiohdr_t*)IEngineStudio.Mod_Extradata(m_pRenderModel);
+
+		if (!m_pStudioHeader || m_pStudioHeader->numbones > MAXSTUDIOBONES)
+			return false;
+
+		IEngineStudio.StudioSetHeader(m_pStudioHeader);
+		IEngineStudio.SetRenderModel(m_pRenderModel);
+
+		StudioSetUpTransform(false);
+	}
+
+	if (m_pStudioHeader->numbodyparts == 0)
+		return true;
+
+	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq)
+	{
+		m_pCurrentEntity->curstate.sequence = 0;
+	}
+
+	if (m_pPlayerInfo && m_pPlayerInfo->gaitsequence >= m_pStudioHeader->numseq)
+	{
+		m_pPlayerInfo->gaitsequence = 0;
+	}
+
+	// sequences in demand loaded groups go through the engine's cache
+	pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex);
+
+	if (0 != pseqdesc[m_pCurrentEntity->curstate.sequence].seqgroup ||
+		(m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq && 0 != pseqdesc[m_pCurrentEntity->latched.prevsequence].seqgroup) ||
+		(m_pPlayerInfo && 0 != pseqdesc[m_pPlayerInfo->gaitsequence].seqgroup))
+		return true;
+
+	pseqdesc += m_pCurrentEntity->curstate.sequence;
+	f = StudioEstimateFrame(pseqdesc);
+
+	pjob->model = m_pRenderModel;
+	pjob->header = m_pStudioHeader;
+	pjob->playerinfo = m_pPlayerInfo;
+	pjob->frame = f;
+	pjob->cacheable = StudioBoneCacheable();
+	pjob->hardware = m_fHardware;
+	StudioFillBoneKey(f, &pjob->key);
+	memcpy(pjob->rotationmatrix, *m_protationmatrix, sizeof(pjob->rotationmatrix));
+	memcpy(pjob->aliastransform, *m_paliastransform, sizeof(pjob->aliastransform));
+
+	if (pjob->cacheable)
+	{
+		studio_bonecache_t* pcache = &g_StudioBoneCache[ent->index & (STUDIO_BONECACHE_SLOTS - 1)];
+
+		if (pcache->numbones == m_pStudioHeader->numbones && 0 == memcmp(&pcache->key, &pjob->key, sizeof(pjob->key)))
+		{
+			memcpy(pjob->bonetransform, pcache->bonetransform, pcache->numbones * sizeof(pcache->bonetransform[0]));
+			memcpy(pjob->lighttransform, pcache->lighttransform, pcache->numbones * sizeof(pcache->lighttransform[0]));
+			m_pCurrentEntity->latched.prevframe = f;
+			pjob->built = true;
+
+			g_FrameProfCounters[FRAMEPROF_COUNTER_BONES_CACHED]++;
+			return true;
+		}
+	}
+
+	g_pStudioWork[g_iStudioWork++] = pjob;
+	return true;
 }
 
+/*
+====================
+StudioFindBoneJob
+
+The job prepared for the current entity this frame, if any
+====================
+*/
+studio_bonejob_t* CStudioModelRenderer::StudioFindBoneJob()
+{
+	for (int i = 0; i < g_iStudioJobs; i++)
+	{
+		const int job = (g_iStudioJobCursor + i) % g_iStudioJobs;
+
+		if (g_pStudioJobs[job]->entity == m_pCurrentEntity)
+		{
+			g_iStudioJobCursor = job;
+			return g_pStudioJobs[job];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+====================
+StudioRunBoneJob
+
+On a worker's own renderer, builds the bones into the job
+====================
+*/
+void CStudioModelRenderer::StudioRunBoneJob(studio_bonejob_t* pjob)
+{
+	mstudioseqdesc_t* pseqdesc;
+
+	m_pCurrentEntity = pjob->entity;
+	m_pRenderModel = pjob->model;
+	m_pStudioHeader = pjob->header;
+	m_pPlayerInfo = pjob->playerinfo;
+	m_clTime = pjob->time;
+	m_fHardware = pjob->hardware;
+
+	m_protationmatrix = &pjob->rotationmatrix;
+	m_paliastransform = &pjob->aliastransform;
+	m_pbonetransform = &pjob->bonetransform;
+	m_plighttransform = &pjob->lighttransform;
+
+	pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->curstate.sequence;
+	StudioBuildBones(pseqdesc, pjob->frame);
+
+	pjob->built = true;
+}
 
 /*
 ====================
@@ -1074,7 +1778,7 @@ void CStudioModelRenderer::StudioMergeBones(model_t* m_pSubModel)
 			{
 				if (0 != IEngineStudio.IsHardware())
 				{
-					ConcatTransforms((*m_protationmatrix), bonematrix, (*m_pbonetransform)[i]);
+					ConcatBoneTransforms((*m_protationmatrix), bonematrix, (*m_pbonetransform)[i]);
 
 					// MatrixCopy should be faster...
 					//ConcatTransforms ((*m_protationmatrix), bonematrix, (*m_plighttransform)[i]);
@@ -1082,8 +1786,8 @@ void CStudioModelRenderer::StudioMergeBones(model_t* m_pSubModel)
 				}
 				else
 				{
-					ConcatTransforms((*m_paliastransform), bonematrix, (*m_pbonetransform)[i]);
-					ConcatTransforms((*m_protationmatrix), bonematrix, (*m_plighttransform)[i]);
+					ConcatBoneTransforms((*m_paliastransform), bonematrix, (*m_pbonetransform)[i]);
+					ConcatBoneTransforms((*m_protationmatrix), bonematrix, (*m_plighttransform)[i]);
 				}
 
 				// Apply client-side effects to the transformation matrix
@@ -1091,8 +1795,8 @@ void CStudioModelRenderer::StudioMergeBones(model_t* m_pSubModel)
 			}
 			else
 			{
-				ConcatTransforms((*m_pbonetransform)[pbones[i].parent], bonematrix, (*m_pbonetransform)[i]);
-				ConcatTransforms((*m_plighttransform)[pbones[i].parent], bonematrix, (*m_plighttransform)[i]);
+				ConcatBoneTransforms((*m_pbonetransform)[pbones[i].parent], bonematrix, (*m_pbonetransform)[i]);
+				ConcatBoneTransforms((*m_plighttransform)[pbones[i].parent], bonematrix, (*m_plighttransform)[i]);
 			}
 		}
 	}
@@ -1110,6 +1814,8 @@ bool CStudioModelRenderer::StudioDrawModel(int flags)
 	alight_t lighting;
 	Vector dir;
 
+	StudioPrepareFrame();
+
 	m_pCurrentEntity = IEngineStudio.GetCurrentEntity();
 	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
 	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
@@ -1397,6 +2103,8 @@ bool CStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t* pplayer)
 	alight_t lighting;
 	Vector dir;
 
+	StudioPrepareFrame();
+
 	m_pCurrentEntity = IEngineStudio.GetCurrentEntity();
 	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
 	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
@@ -1425,7 +2133,17 @@ bool CStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t* pplayer)
 
 		VectorCopy(m_pCurrentEntity->angles, orig_angles);
 
-		StudioProcessGait(pplayer);
+		// the gait already moved on when the frame was prepared
+		studio_bonejob_t* pjob = StudioFindBoneJob();
+
+		if (pjob && pjob->time == m_clTime)
+		{
+			VectorCopy(pjob->gaitangles, m_pCurrentEntity->angles);
+		}
+		else
+		{
+			StudioProcessGait(pplayer);
+		}
 
 		m_pPlayerInfo->gaitsequence = pplayer->gaitsequence;
 		m_pPlayerInfo = NULL;
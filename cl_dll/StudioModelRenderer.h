@@ -7,6 +7,37 @@
 
 #pragma once
 
+// Where the last decode of an animation track found its frame, so the next
+// decode for the same entity can start there instead of at the track start
+typedef struct
+{
+	unsigned short offset; // span start, in animvalues from the track start
+	short frame;		   // first frame of that span, -1 if unset
+} studio_animcursor_t;
+
+// Everything StudioSetupBones reads; the same key builds the same skeleton
+typedef struct
+{
+	model_t* model;
+	double frame;
+	int sequence;
+	float dadt; // only when controllers or blending are being interpolated
+	int renderfx;
+	int hardware;
+	byte controller[4];
+	byte prevcontroller[4];
+	byte blending[2];
+	byte prevblending[2];
+	byte mouthopen;
+	int gaitsequence;
+	float gaitframe;
+	float rotationmatrix[3][4];
+	float aliastransform[3][4]; // software renderer only
+} studio_bonekey_t;
+
+// Bones built ahead of the draw calls by StudioPrepareFrame
+typedef struct studio_bonejob_s studio_bonejob_t;
+
 /*
 ====================
 CStudioModelRenderer
@@ -179,4 +210,32 @@ public:
 	// Concatenated bone and light transforms
 	float (*m_pbonetransform)[MAXSTUDIOBONES][3][4];
 	float (*m_plighttransform)[MAXSTUDIOBONES][3][4];
+
+	// Span cursors for the six tracks of the bone being decoded, NULL if not cached
+	studio_animcursor_t* m_pBoneCursors;
+
+	// Reuse the last skeleton built for an entity?
+	cvar_t* m_pCvarBoneCache;
+
+	bool StudioBoneCacheable();
+	void StudioFillBoneKey(double f, studio_bonekey_t* pkey);
+
+	// Build the visible models' bones on worker threads before the first draw of a frame?
+	cvar_t* m_pCvarStudioThreads;
+	// Render frame the bone jobs were prepared for
+	int m_nPreparedFrame;
+	// IEngineStudio.IsHardware(), read on the main thread so the workers don't call the engine
+	bool m_fHardware;
+
+	void StudioPrepareFrame();
+	bool StudioPrepareBoneJob(cl_entity_t* ent, int type);
+	studio_bonejob_t* StudioFindBoneJob();
+	void StudioRunBoneJob(studio_bonejob_t* pjob);
+
+	// Evaluate the sequences into m_pbonetransform and m_plighttransform
+	void StudioBuildBones(mstudioseqdesc_t* pseqdesc, double f);
 };
+
+void StudioQueueEntity(int type, cl_entity_t* ent);
+void StudioSealQueue();
+void StudioShutdownWorkers();
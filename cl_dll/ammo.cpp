@@ -92,8 +92,17 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	pWeapon->hAmmo = 0;
 	pWeapon->hAmmo2 = 0;
 
-	sprintf(sz, "sprites/%s.txt", pWeapon->szName);
-	client_sprite_t* pList = SPR_GetList(sz, &i);
+	// The weapon script is only parsed the first time this weapon is seen
+	const int id = pWeapon->iId;
+	if (!rgpSpriteLists[id] || 0 != strcmp(rgszSpriteListNames[id], pWeapon->szName))
+	{
+		sprintf(sz, "sprites/%s.txt", pWeapon->szName);
+		rgpSpriteLists[id] = SPR_GetList(sz, &riSpriteListCounts[id]);
+		strcpy(rgszSpriteListNames[id], pWeapon->szName);
+	}
+
+	client_sprite_t* pList = rgpSpriteLists[id];
+	i = riSpriteListCounts[id];
 
 	if (!pList)
 		return;
@@ -103,8 +112,7 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	p = GetSpriteList(pList, "crosshair", iRes, i);
 	if (p)
 	{
-		sprintf(sz, "sprites/%s.spr", p->szSprite);
-		pWeapon->hCrosshair = SPR_Load(sz);
+		pWeapon->hCrosshair = gHUD.GetSpriteHandle(p->szSprite);
 		pWeapon->rcCrosshair = p->rc;
 	}
 	else
@@ -113,8 +121,7 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	p = GetSpriteList(pList, "autoaim", iRes, i);
 	if (p)
 	{
-		sprintf(sz, "sprites/%s.spr", p->szSprite);
-		pWeapon->hAutoaim = SPR_Load(sz);
+		pWeapon->hAutoaim = gHUD.GetSpriteHandle(p->szSprite);
 		pWeapon->rcAutoaim = p->rc;
 	}
 	else
@@ -123,8 +130,7 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	p = GetSpriteList(pList, "zoom", iRes, i);
 	if (p)
 	{
-		sprintf(sz, "sprites/%s.spr", p->szSprite);
-		pWeapon->hZoomedCrosshair = SPR_Load(sz);
+		pWeapon->hZoomedCrosshair = gHUD.GetSpriteHandle(p->szSprite);
 		pWeapon->rcZoomedCrosshair = p->rc;
 	}
 	else
@@ -136,8 +142,7 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	p = GetSpriteList(pList, "zoom_autoaim", iRes, i);
 	if (p)
 	{
-		sprintf(sz, "sprites/%s.spr", p->szSprite);
-		pWeapon->hZoomedAutoaim = SPR_Load(sz);
+		pWeapon->hZoomedAutoaim = gHUD.GetSpriteHandle(p->szSprite);
 		pWeapon->rcZoomedAutoaim = p->rc;
 	}
 	else
@@ -149,8 +154,7 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	p = GetSpriteList(pList, "weapon", iRes, i);
 	if (p)
 	{
-		sprintf(sz, "sprites/%s.spr", p->szSprite);
-		pWeapon->hInactive = SPR_Load(sz);
+		pWeapon->hInactive = gHUD.GetSpriteHandle(p->szSprite);
 		pWeapon->rcInactive = p->rc;
 
 		gHR.iHistoryGap = V_max(gHR.iHistoryGap, pWeapon->rcActive.bottom - pWeapon->rcActive.top);
@@ -161,8 +165,7 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	p = GetSpriteList(pList, "weapon_s", iRes, i);
 	if (p)
 	{
-		sprintf(sz, "sprites/%s.spr", p->szSprite);
-		pWeapon->hActive = SPR_Load(sz);
+		pWeapon->hActive = gHUD.GetSpriteHandle(p->szSprite);
 		pWeapon->rcActive = p->rc;
 	}
 	else
@@ -171,8 +174,7 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	p = GetSpriteList(pList, "ammo", iRes, i);
 	if (p)
 	{
-		sprintf(sz, "sprites/%s.spr", p->szSprite);
-		pWeapon->hAmmo = SPR_Load(sz);
+		pWeapon->hAmmo = gHUD.GetSpriteHandle(p->szSprite);
 		pWeapon->rcAmmo = p->rc;
 
 		gHR.iHistoryGap = V_max(gHR.iHistoryGap, pWeapon->rcActive.bottom - pWeapon->rcActive.top);
@@ -183,8 +185,7 @@ void WeaponsResource::LoadWeaponSprites(WEAPON* pWeapon)
 	p = GetSpriteList(pList, "ammo2", iRes, i);
 	if (p)
 	{
-		sprintf(sz, "sprites/%s.spr", p->szSprite);
-		pWeapon->hAmmo2 = SPR_Load(sz);
+		pWeapon->hAmmo2 = gHUD.GetSpriteHandle(p->szSprite);
 		pWeapon->rcAmmo2 = p->rc;
 
 		gHR.iHistoryGap = V_max(gHR.iHistoryGap, pWeapon->rcActive.bottom - pWeapon->rcActive.top);
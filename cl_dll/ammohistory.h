@@ -31,6 +31,11 @@ private:
 	WEAPON* rgSlots[MAX_WEAPON_SLOTS + 1][MAX_WEAPON_POSITIONS + 1]; // The slots currently in use by weapons.  The value is a pointer to the weapon;  if it's NULL, no weapon is there
 	int riAmmo[MAX_AMMO_TYPES];										 // count of each ammo type
 
+	// Parsed sprites/<weapon>.txt scripts, kept across HUD resets
+	client_sprite_t* rgpSpriteLists[MAX_WEAPONS];
+	int riSpriteListCounts[MAX_WEAPONS];
+	char rgszSpriteListNames[MAX_WEAPONS][MAX_WEAPON_NAME];
+
 public:
 	void Init()
 	{
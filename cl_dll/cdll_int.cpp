@@ -35,6 +35,7 @@
 #include "tri.h"
 #include "vgui_TeamFortressViewport.h"
 #include "filesystem_utils.h"
+#include "frameprof.h"
 
 cl_enginefunc_t gEngfuncs;
 CHud gHUD;
@@ -262,6 +263,8 @@ void DLLEXPORT HUD_Frame(double time)
 {
 	//	RecClHudFrame(time);
 
+	FrameProf_Frame();
+
 	GetClientVoiceMgr()->Frame(time);
 }
 
@@ -18,6 +18,8 @@
 extern IParticleMan* g_pParticleMan;
 
 void Game_AddObjects();
+void StudioQueueEntity(int type, cl_entity_t* ent);
+void StudioSealQueue();
 
 extern Vector v_origin;
 
@@ -58,6 +60,9 @@ int DLLEXPORT HUD_AddEntity(int type, struct cl_entity_s* ent, const char* model
 			return 0; // don't draw the player we are following in eye
 	}
 
+	// build its bones along with the others before the first one is drawn
+	StudioQueueEntity(type, ent);
+
 	return 1;
 }
 
@@ -310,6 +315,8 @@ void DLLEXPORT HUD_CreateEntities()
 	Game_AddObjects();
 
 	GetClientVoiceMgr()->CreateEntities();
+
+	StudioSealQueue();
 }
 
 
@@ -0,0 +1,367 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//
+// frameprof.cpp
+//
+// Client frame time profiler. A frame runs from one HUD_Frame to the
+// next; every scope closed in between adds to its zone. The overlay
+// shows the last FRAMEPROF_HISTORY frames as stacked bars with a
+// running average per zone, and frameprof_trace writes each scope as
+// a Chrome trace event (load the file in chrome://tracing or Perfetto).
+//
+#include "hud.h"
+#include "cl_util.h"
+#include "perf_counter.h"
+#include "frameprof.h"
+
+#define FRAMEPROF_HISTORY 128	// frames in the overlay graph
+#define FRAMEPROF_MAX_EVENTS 4096 // trace events kept per frame
+#define FRAMEPROF_GRAPH_HEIGHT 100
+#define FRAMEPROF_PIXELS_PER_MS 2
+
+typedef struct
+{
+	int zone;
+	double start;
+	double duration;
+} frameprof_event_t;
+
+static CPerformanceCounter g_FrameProfTimer;
+static cvar_t* cl_frameprof;
+
+static double g_flFrameStart;
+static double g_flZoneTime[FRAMEPROF_ZONES]; // this frame
+static float g_flZoneAverage[FRAMEPROF_ZONES];
+static float g_flFrameAverage;
+static int g_iFrameCounters[FRAMEPROF_COUNTERS]; // last frame
+
+// Graph history, the subsystem zones only
+static float g_flHistory[FRAMEPROF_HISTORY][FRAMEPROF_HUD_ELEMENTS];
+static float g_flHistoryFrame[FRAMEPROF_HISTORY];
+static int g_iHistory;
+
+static CHudBase* g_pHudZoneElements[FRAMEPROF_MAX_HUD_ELEMENTS];
+static const char* g_pszHudZoneNames[FRAMEPROF_MAX_HUD_ELEMENTS];
+static int g_iHudZones;
+
+static FILE* g_pTraceFile;
+static int g_iTraceFrames; // frames left to write
+static double g_flTraceStart;
+static bool g_fTraceFirstEvent;
+static frameprof_event_t g_TraceEvents[FRAMEPROF_MAX_EVENTS];
+static int g_iTraceEvents;
+
+static const char* g_pszZoneNames[FRAMEPROF_HUD_ELEMENTS] =
+	{
+		"view",
+		"studio",
+		"particles",
+		"hud",
+		"vgui",
+};
+
+static const int g_ZoneColors[FRAMEPROF_HUD_ELEMENTS][3] =
+	{
+		{255, 160, 0},
+		{0, 160, 255},
+		{255, 80, 200},
+		{80, 255, 80},
+		{255, 255, 0},
+};
+
+static const char* FrameProf_ZoneName(int zone)
+{
+	if (zone < FRAMEPROF_HUD_ELEMENTS)
+		return g_pszZoneNames[zone];
+
+	return g_pszHudZoneNames[zone - FRAMEPROF_HUD_ELEMENTS];
+}
+
+double FrameProf_Begin()
+{
+	return g_FrameProfTimer.GetCurTime();
+}
+
+void FrameProf_End(int zone, double start)
+{
+	const double duration = g_FrameProfTimer.GetCurTime() - start;
+
+	g_flZoneTime[zone] += duration;
+
+	if (g_pTraceFile && g_iTraceEvents < FRAMEPROF_MAX_EVENTS)
+	{
+		frameprof_event_t* pEvent = &g_TraceEvents[g_iTraceEvents++];
+		pEvent->zone = zone;
+		pEvent->start = start;
+		pEvent->duration = duration;
+	}
+}
+
+// Elements get a zone the first time they are drawn while profiling
+int FrameProf_HudZone(CHudBase* pElement)
+{
+	int i;
+
+	for (i = 0; i < g_iHudZones; i++)
+	{
+		if (g_pHudZoneElements[i] == pElement)
+			return FRAMEPROF_HUD_ELEMENTS + i;
+	}
+
+	if (g_iHudZones == FRAMEPROF_MAX_HUD_ELEMENTS)
+		return -1;
+
+	const struct
+	{
+		CHudBase* pElement;
+		const char* pszName;
+	} names[] =
+		{
+			{&gHUD.m_Ammo, "ammo"},
+			{&gHUD.m_Health, "health"},
+			{&gHUD.m_Spectator, "spectator"},
+			{&gHUD.m_Geiger, "geiger"},
+			{&gHUD.m_Battery, "battery"},
+			{&gHUD.m_Train, "train"},
+			{&gHUD.m_Flash, "flashlight"},
+			{&gHUD.m_Message, "message"},
+			{&gHUD.m_StatusBar, "statusbar"},
+			{&gHUD.m_DeathNotice, "deathnotice"},
+			{&gHUD.m_SayText, "saytext"},
+			{&gHUD.m_Menu, "menu"},
+			{&gHUD.m_AmmoSecondary, "ammo2"},
+			{&gHUD.m_TextMessage, "textmessage"},
+			{&gHUD.m_StatusIcons, "statusicons"},
+			{GetClientVoiceMgr(), "voice"},
+		};
+
+	const char* pszName = "element";
+	for (i = 0; i < (int)ARRAYSIZE(names); i++)
+	{
+		if (names[i].pElement == pElement)
+			pszName = names[i].pszName;
+	}
+
+	g_pHudZoneElements[g_iHudZones] = pElement;
+	g_pszHudZoneNames[g_iHudZones] = pszName;
+	return FRAMEPROF_HUD_ELEMENTS + g_iHudZones++;
+}
+
+static void FrameProf_WriteTraceEvent(const char* pszName, double start, double duration)
+{
+	fprintf(g_pTraceFile, "%s{\"name\":\"%s\",\"cat\":\"client\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f}",
+		g_fTraceFirstEvent ? "" : ",\n", pszName, (start - g_flTraceStart) * 1000000.0, duration * 1000000.0);
+
+	g_fTraceFirstEvent = false;
+}
+
+static void FrameProf_EndTrace()
+{
+	fprintf(g_pTraceFile, "\n]}\n");
+	fclose(g_pTraceFile);
+	g_pTraceFile = NULL;
+
+	ConsolePrint("frameprof_trace: done\n");
+}
+
+static void FrameProf_Reset()
+{
+	memset(g_flZoneTime, 0, sizeof(g_flZoneTime));
+	memset(g_flZoneAverage, 0, sizeof(g_flZoneAverage));
+	memset(g_flHistory, 0, sizeof(g_flHistory));
+	memset(g_flHistoryFrame, 0, sizeof(g_flHistoryFrame));
+	g_flFrameAverage = 0;
+	g_iTraceEvents = 0;
+}
+
+void FrameProf_Frame()
+{
+	int i;
+
+	memcpy(g_iFrameCounters, g_FrameProfCounters, sizeof(g_iFrameCounters));
+	memset(g_FrameProfCounters, 0, sizeof(g_FrameProfCounters));
+
+	if (0 == cl_frameprof->value && !g_pTraceFile)
+	{
+		g_fFrameProfActive = false;
+		return;
+	}
+
+	const double now = g_FrameProfTimer.GetCurTime();
+
+	// Nothing was timed yet, start with the next frame
+	if (!g_fFrameProfActive)
+	{
+		FrameProf_Reset();
+		g_fFrameProfActive = true;
+		g_flFrameStart = now;
+		return;
+	}
+
+	const float frameMs = (now - g_flFrameStart) * 1000.0;
+
+	g_flFrameAverage += (frameMs - g_flFrameAverage) * 0.05f;
+
+	for (i = 0; i < FRAMEPROF_ZONES; i++)
+	{
+		const float zoneMs = g_flZoneTime[i] * 1000.0;
+
+		g_flZoneAverage[i] += (zoneMs - g_flZoneAverage[i]) * 0.05f;
+
+		if (i < FRAMEPROF_HUD_ELEMENTS)
+			g_flHistory[g_iHistory][i] = zoneMs;
+	}
+
+	g_flHistoryFrame[g_iHistory] = frameMs;
+	g_iHistory = (g_iHistory + 1) % FRAMEPROF_HISTORY;
+
+	if (g_pTraceFile)
+	{
+		FrameProf_WriteTraceEvent("frame", g_flFrameStart, now - g_flFrameStart);
+
+		for (i = 0; i < g_iTraceEvents; i++)
+			FrameProf_WriteTraceEvent(FrameProf_ZoneName(g_TraceEvents[i].zone), g_TraceEvents[i].start, g_TraceEvents[i].duration);
+
+		fprintf(g_pTraceFile, ",\n{\"name\":\"bone cache\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"args\":{\"cached\":%d,\"built\":%d}}",
+			(g_flFrameStart - g_flTraceStart) * 1000000.0, g_iFrameCounters[FRAMEPROF_COUNTER_BONES_CACHED], g_iFrameCounters[FRAMEPROF_COUNTER_BONES_BUILT]);
+
+		if (--g_iTraceFrames <= 0)
+			FrameProf_EndTrace();
+	}
+
+	memset(g_flZoneTime, 0, sizeof(g_flZoneTime));
+	g_iTraceEvents = 0;
+	g_flFrameStart = now;
+}
+
+static int FrameProf_DrawLine(int x, int y, int lineHeight, float r, float g, float b, const char* pszText)
+{
+	gEngfuncs.pfnDrawSetTextColor(r, g, b);
+	DrawConsoleString(x, y, pszText);
+	return y + lineHeight;
+}
+
+void FrameProf_Draw()
+{
+	int i, zone;
+	char sz[128];
+
+	if (!g_fFrameProfActive || 0 == cl_frameprof->value)
+		return;
+
+	const int x = 16;
+	int y = ScreenHeight / 4;
+
+	// Stacked bars, oldest frame on the left, whatever no zone claimed in gray
+	for (i = 0; i < FRAMEPROF_HISTORY; i++)
+	{
+		const int slot = (g_iHistory + i) % FRAMEPROF_HISTORY;
+		int bottom = y + FRAMEPROF_GRAPH_HEIGHT;
+		float claimed = 0;
+
+		for (zone = 0; zone < FRAMEPROF_HUD_ELEMENTS && bottom > y; zone++)
+		{
+			const int height = V_min((int)(g_flHistory[slot][zone] * FRAMEPROF_PIXELS_PER_MS + 0.5f), bottom - y);
+
+			claimed += g_flHistory[slot][zone];
+			if (height <= 0)
+				continue;
+
+			bottom -= height;
+			FillRGBA(x + i, bottom, 1, height, g_ZoneColors[zone][0], g_ZoneColors[zone][1], g_ZoneColors[zone][2], 255);
+		}
+
+		const int other = V_min((int)((g_flHistoryFrame[slot] - claimed) * FRAMEPROF_PIXELS_PER_MS + 0.5f), bottom - y);
+		if (other > 0)
+			FillRGBA(x + i, bottom - other, 1, other, 128, 128, 128, 255);
+	}
+
+	// 60 and 30 fps marks
+	FillRGBA(x, y + FRAMEPROF_GRAPH_HEIGHT - (int)(16.7f * FRAMEPROF_PIXELS_PER_MS), FRAMEPROF_HISTORY, 1, 255, 255, 255, 128);
+	FillRGBA(x, y + FRAMEPROF_GRAPH_HEIGHT - (int)(33.3f * FRAMEPROF_PIXELS_PER_MS), FRAMEPROF_HISTORY, 1, 255, 64, 64, 128);
+
+	y += FRAMEPROF_GRAPH_HEIGHT + 4;
+
+	int lineWidth, lineHeight;
+	GetConsoleStringSize("0", &lineWidth, &lineHeight);
+
+	sprintf(sz, "frame     %6.2f ms  %4.0f fps", g_flFrameAverage, g_flFrameAverage > 0 ? 1000.0f / g_flFrameAverage : 0.0f);
+	y = FrameProf_DrawLine(x, y, lineHeight, 1, 1, 1, sz);
+
+	for (zone = 0; zone < FRAMEPROF_HUD_ELEMENTS; zone++)
+	{
+		sprintf(sz, "%-9s %6.2f ms", g_pszZoneNames[zone], g_flZoneAverage[zone]);
+		y = FrameProf_DrawLine(x, y, lineHeight, g_ZoneColors[zone][0] / 255.0f, g_ZoneColors[zone][1] / 255.0f, g_ZoneColors[zone][2] / 255.0f, sz);
+
+		if (zone != FRAMEPROF_HUD)
+			continue;
+
+		// HUD elements nest under the HUD zone, skip the idle ones
+		for (i = 0; i < g_iHudZones; i++)
+		{
+			if (g_flZoneAverage[FRAMEPROF_HUD_ELEMENTS + i] < 0.005f)
+				continue;
+
+			sprintf(sz, "  %-12s %6.3f ms", g_pszHudZoneNames[i], g_flZoneAverage[FRAMEPROF_HUD_ELEMENTS + i]);
+			y = FrameProf_DrawLine(x, y, lineHeight, 0.6f, 0.8f, 0.6f, sz);
+		}
+	}
+
+	const int cached = g_iFrameCounters[FRAMEPROF_COUNTER_BONES_CACHED];
+	const int built = g_iFrameCounters[FRAMEPROF_COUNTER_BONES_BUILT];
+	sprintf(sz, "bones     %3d%% cached  %d/%d", cached + built > 0 ? cached * 100 / (cached + built) : 0, cached, cached + built);
+	y = FrameProf_DrawLine(x, y, lineHeight, 1, 1, 1, sz);
+}
+
+// frameprof_trace [frames]
+static void FrameProf_Trace()
+{
+	char szPath[256];
+
+	if (g_pTraceFile)
+	{
+		ConsolePrint("frameprof_trace: already writing a trace\n");
+		return;
+	}
+
+	g_iTraceFrames = gEngfuncs.Cmd_Argc() > 1 ? atoi(gEngfuncs.Cmd_Argv(1)) : 300;
+	if (g_iTraceFrames <= 0)
+		return;
+
+	sprintf(szPath, "%s/frameprof.json", gEngfuncs.pfnGetGameDirectory());
+	g_pTraceFile = fopen(szPath, "w");
+	if (!g_pTraceFile)
+	{
+		ConsolePrint("frameprof_trace: couldn't open frameprof.json\n");
+		return;
+	}
+
+	fprintf(g_pTraceFile, "{\"traceEvents\":[\n");
+	g_fTraceFirstEvent = true;
+	g_flTraceStart = g_FrameProfTimer.GetCurTime();
+
+	// Restart the frame so no event predates the trace
+	g_fFrameProfActive = false;
+
+	char szMsg[320];
+	sprintf(szMsg, "frameprof_trace: writing %d frames to %s\n", g_iTraceFrames, szPath);
+	ConsolePrint(szMsg);
+}
+
+void FrameProf_Init()
+{
+	cl_frameprof = CVAR_CREATE("cl_frameprof", "0", 0);
+	gEngfuncs.pfnAddCommand("frameprof_trace", FrameProf_Trace);
+}
@@ -0,0 +1,76 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+//
+// frameprof.h - client frame time profiler. Scoped timers attribute
+// time to client subsystems and HUD elements; cl_frameprof draws the
+// overlay and frameprof_trace writes a Chrome trace. Disabled scopes
+// only test g_fFrameProfActive.
+//
+
+enum
+{
+	FRAMEPROF_VIEW = 0, // V_CalcRefdef
+	FRAMEPROF_STUDIO,	// studio model drawing
+	FRAMEPROF_PARTICLES,
+	FRAMEPROF_HUD,
+	FRAMEPROF_VGUI,
+	FRAMEPROF_HUD_ELEMENTS, // one zone per HUD element from here on
+
+	FRAMEPROF_MAX_HUD_ELEMENTS = 32,
+	FRAMEPROF_ZONES = FRAMEPROF_HUD_ELEMENTS + FRAMEPROF_MAX_HUD_ELEMENTS
+};
+
+// Per frame event counts, shown in the overlay and the trace
+enum
+{
+	FRAMEPROF_COUNTER_BONES_CACHED = 0, // StudioSetupBones served from the bone cache
+	FRAMEPROF_COUNTER_BONES_BUILT,		// StudioSetupBones that built the skeleton
+
+	FRAMEPROF_COUNTERS
+};
+
+inline bool g_fFrameProfActive = false;
+inline int g_FrameProfCounters[FRAMEPROF_COUNTERS]; // counted even while disabled, cleared every frame
+
+class CHudBase;
+
+void FrameProf_Init();
+void FrameProf_Frame(); // from HUD_Frame, closes the previous frame
+void FrameProf_Draw();	// from CHud::Redraw
+int FrameProf_HudZone(CHudBase* pElement);
+
+double FrameProf_Begin();
+void FrameProf_End(int zone, double start);
+
+class CFrameProfScope
+{
+public:
+	CFrameProfScope(int zone) : m_iZone(zone), m_flStart(g_fFrameProfActive && zone >= 0 ? FrameProf_Begin() : -1) {}
+
+	~CFrameProfScope()
+	{
+		if (m_flStart >= 0)
+			FrameProf_End(m_iZone, m_flStart);
+	}
+
+private:
+	int m_iZone;
+	double m_flStart;
+};
+
+#define FRAMEPROF_SCOPE(zone) CFrameProfScope frameProfScope(zone)
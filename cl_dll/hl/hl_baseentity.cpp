@@ -74,6 +74,10 @@ void UTIL_LogPrintf(char*, ...) {}
 void UTIL_ClientPrintAll(int, char const*, char const*, char const*, char const*, char const*) {}
 void ClientPrint(entvars_t* client, int msg_dest, const char* msg_name, const char* param1, const char* param2, const char* param3, const char* param4) {}
 
+// Entity pool Stubs
+void* EntPool_Alloc(size_t size) { return ::operator new(size); }
+void EntPool_Free(void* pMem, size_t size) { ::operator delete(pMem); }
+
 // CBaseToggle Stubs
 bool CBaseToggle::Restore(class CRestore&) { return true; }
 bool CBaseToggle::Save(class CSave&) { return true; }
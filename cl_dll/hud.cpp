@@ -29,6 +29,7 @@
 #include "demo.h"
 #include "demo_api.h"
 #include "vgui_ScorePanel.h"
+#include "frameprof.h"
 
 #include "materials/CMaterialFIO.h"
 #include "materials/CMaterialSystem.h"
@@ -340,6 +341,8 @@ void CHud::Init()
 	cl_rollspeed = CVAR_CREATE("cl_rollspeed", "200", FCVAR_ARCHIVE);
 	cl_bobtilt = CVAR_CREATE("cl_bobtilt", "0", FCVAR_ARCHIVE);
 
+	FrameProf_Init();
+
 	m_pSpriteList = NULL;
 
 	// Clear any old HUD list
@@ -386,6 +389,7 @@ CHud::~CHud()
 	delete[] m_rghSprites;
 	delete[] m_rgrcRects;
 	delete[] m_rgszSpriteNames;
+	delete[] m_rgiSpriteHash;
 
 	if (m_pHudList)
 	{
@@ -400,20 +404,85 @@ CHud::~CHud()
 	}
 }
 
+// FNV-1a over at most maxlen characters
+static unsigned int HashSpriteName(const char* psz, int maxlen)
+{
+	unsigned int hash = 2166136261u;
+
+	for (int i = 0; i < maxlen && '\0' != psz[i]; i++)
+	{
+		hash ^= (unsigned char)psz[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 // GetSpriteIndex()
 // searches through the sprite list loaded from hud.txt for a name matching SpriteName
 // returns an index into the gHUD.m_rghSprites[] array
-// returns 0 if sprite not found
+// returns -1 if sprite not found
 int CHud::GetSpriteIndex(const char* SpriteName)
 {
-	// look through the loaded sprite name list for SpriteName
-	for (int i = 0; i < m_iSpriteCount; i++)
+	if (!m_rgiSpriteHash)
+		return -1;
+
+	for (unsigned int h = HashSpriteName(SpriteName, MAX_SPRITE_NAME_LENGTH) & m_iSpriteHashMask;; h = (h + 1) & m_iSpriteHashMask)
 	{
+		const int i = m_rgiSpriteHash[h];
+
+		if (i < 0)
+			return -1; // invalid sprite
+
 		if (strncmp(SpriteName, m_rgszSpriteNames + (i * MAX_SPRITE_NAME_LENGTH), MAX_SPRITE_NAME_LENGTH) == 0)
 			return i;
 	}
+}
+
+// GetSpriteHandle()
+// returns the handle for sprites/<szSprite>.spr, loading the file only once
+// per VidInit no matter how many hud.txt or weapon entries use it
+HSPRITE CHud::GetSpriteHandle(const char* szSprite)
+{
+	const int len = sizeof(m_rgSpriteFiles[0].szSprite) - 1;
+	hud_spritefile_t* pFile = NULL;
+	unsigned int h = HashSpriteName(szSprite, len);
+
+	for (int n = 0; n < MAX_HUD_SPRITE_FILES; n++, h++)
+	{
+		hud_spritefile_t* f = &m_rgSpriteFiles[h & (MAX_HUD_SPRITE_FILES - 1)];
+
+		if ('\0' == f->szSprite[0])
+		{
+			strncpy(f->szSprite, szSprite, len);
+			f->szSprite[len] = '\0';
+			f->iLoad = 0;
+			pFile = f;
+			break;
+		}
+
+		if (strncmp(f->szSprite, szSprite, len) == 0)
+		{
+			pFile = f;
+			break;
+		}
+	}
+
+	if (pFile && pFile->iLoad == m_iSpriteLoad)
+		return pFile->hSprite;
+
+	char sz[256];
+	sprintf(sz, "sprites/%s.spr", szSprite);
+	HSPRITE hSprite = SPR_Load(sz);
+
+	// a full table just means loading uncached
+	if (pFile)
+	{
+		pFile->hSprite = hSprite;
+		pFile->iLoad = m_iSpriteLoad;
+	}
 
-	return -1; // invalid sprite
+	return hSprite;
 }
 
 void CHud::VidInit()
@@ -434,62 +503,84 @@ void CHud::VidInit()
 	else
 		m_iRes = 640;
 
+	// sprite handles from the last map are stale
+	m_iSpriteLoad++;
+
 	// Only load this once
 	if (!m_pSpriteList)
 	{
 		// we need to load the hud.txt, and all sprites within
 		m_pSpriteList = SPR_GetList("sprites/hud.txt", &m_iSpriteCountAllRes);
+	}
+
+	if (m_pSpriteList && m_iSpriteRes != m_iRes)
+	{
+		// count the number of sprites of the appropriate res
+		m_iSpriteCount = 0;
+		client_sprite_t* p = m_pSpriteList;
+		int j;
+		for (j = 0; j < m_iSpriteCountAllRes; j++)
+		{
+			if (p->iRes == m_iRes)
+				m_iSpriteCount++;
+			p++;
+		}
 
-		if (m_pSpriteList)
+		// hash table at most half full
+		int hashSize = 16;
+		while (hashSize < m_iSpriteCount * 2)
+			hashSize <<= 1;
+
+		// allocated memory for sprite handle arrays
+		delete[] m_rghSprites;
+		delete[] m_rgrcRects;
+		delete[] m_rgszSpriteNames;
+		delete[] m_rgiSpriteHash;
+		m_rghSprites = new HSPRITE[m_iSpriteCount];
+		m_rgrcRects = new Rect[m_iSpriteCount];
+		m_rgszSpriteNames = new char[m_iSpriteCount * MAX_SPRITE_NAME_LENGTH];
+		m_rgiSpriteHash = new int[hashSize];
+		m_iSpriteHashMask = hashSize - 1;
+		memset(m_rgiSpriteHash, -1, hashSize * sizeof(m_rgiSpriteHash[0]));
+
+		p = m_pSpriteList;
+		int index = 0;
+		for (j = 0; j < m_iSpriteCountAllRes; j++)
 		{
-			// count the number of sprites of the appropriate res
-			m_iSpriteCount = 0;
-			client_sprite_t* p = m_pSpriteList;
-			int j;
-			for (j = 0; j < m_iSpriteCountAllRes; j++)
+			if (p->iRes == m_iRes)
 			{
-				if (p->iRes == m_iRes)
-					m_iSpriteCount++;
-				p++;
-			}
+				char* pszName = &m_rgszSpriteNames[index * MAX_SPRITE_NAME_LENGTH];
+				m_rgrcRects[index] = p->rc;
+				strncpy(pszName, p->szName, MAX_SPRITE_NAME_LENGTH);
 
-			// allocated memory for sprite handle arrays
-			m_rghSprites = new HSPRITE[m_iSpriteCount];
-			m_rgrcRects = new Rect[m_iSpriteCount];
-			m_rgszSpriteNames = new char[m_iSpriteCount * MAX_SPRITE_NAME_LENGTH];
+				// the first entry with a name wins, same as the old linear search
+				unsigned int h = HashSpriteName(pszName, MAX_SPRITE_NAME_LENGTH) & m_iSpriteHashMask;
+				while (m_rgiSpriteHash[h] >= 0 && strncmp(pszName, m_rgszSpriteNames + (m_rgiSpriteHash[h] * MAX_SPRITE_NAME_LENGTH), MAX_SPRITE_NAME_LENGTH) != 0)
+					h = (h + 1) & m_iSpriteHashMask;
 
-			p = m_pSpriteList;
-			int index = 0;
-			for (j = 0; j < m_iSpriteCountAllRes; j++)
-			{
-				if (p->iRes == m_iRes)
-				{
-					char sz[256];
-					sprintf(sz, "sprites/%s.spr", p->szSprite);
-					m_rghSprites[index] = SPR_Load(sz);
-					m_rgrcRects[index] = p->rc;
-					strncpy(&m_rgszSpriteNames[index * MAX_SPRITE_NAME_LENGTH], p->szName, MAX_SPRITE_NAME_LENGTH);
-
-					index++;
-				}
-
-				p++;
+				if (m_rgiSpriteHash[h] < 0)
+					m_rgiSpriteHash[h] = index;
+
+				index++;
 			}
+
+			p++;
 		}
+
+		m_iSpriteRes = m_iRes;
 	}
-	else
+
+	if (m_pSpriteList)
 	{
-		// we have already have loaded the sprite reference from hud.txt, but
 		// we need to make sure all the sprites have been loaded (we've gone through a transition, or loaded a save game)
+		// entries sharing a sprite file share its handle, so every file is loaded once
 		client_sprite_t* p = m_pSpriteList;
 		int index = 0;
 		for (int j = 0; j < m_iSpriteCountAllRes; j++)
 		{
 			if (p->iRes == m_iRes)
 			{
-				char sz[256];
-				sprintf(sz, "sprites/%s.spr", p->szSprite);
-				m_rghSprites[index] = SPR_Load(sz);
+				m_rghSprites[index] = GetSpriteHandle(p->szSprite);
 				index++;
 			}
 
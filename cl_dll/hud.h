@@ -442,6 +442,7 @@ private:
 //-----------------------------------------------------
 //
 #define MAX_SPRITE_NAME_LENGTH 24
+#define MAX_HUD_SPRITE_FILES 256 // must be a power of two
 
 class CHudStatusIcons : public CHudBase
 {
@@ -538,10 +539,24 @@ public:
 
 private:
 	// the memory for these arrays are allocated in the first call to CHud::VidInit(), when the hud.txt and associated sprites are loaded.
-	// freed in ~CHud()
+	// rebuilt if the resolution changes, freed in ~CHud()
 	HSPRITE* m_rghSprites; /*[HUD_SPRITE_COUNT]*/ // the sprites loaded from hud.txt
 	Rect* m_rgrcRects;							  /*[HUD_SPRITE_COUNT]*/
 	char* m_rgszSpriteNames;					  /*[HUD_SPRITE_COUNT][MAX_SPRITE_NAME_LENGTH]*/
+	int* m_rgiSpriteHash;						  // open addressed name -> index table, -1 is empty
+	int m_iSpriteHashMask;
+	int m_iSpriteRes; // resolution the arrays above were built for
+
+	// sprite files used by hud.txt and the weapon scripts, many entries share a file
+	typedef struct
+	{
+		char szSprite[64];
+		HSPRITE hSprite;
+		int iLoad; // m_iSpriteLoad when hSprite was loaded
+	} hud_spritefile_t;
+
+	hud_spritefile_t m_rgSpriteFiles[MAX_HUD_SPRITE_FILES];
+	int m_iSpriteLoad; // bumped every VidInit, since the engine drops sprites on map change
 
 	struct cvar_s* default_fov;
 
@@ -558,6 +573,7 @@ public:
 
 
 	int GetSpriteIndex(const char* SpriteName); // gets a sprite index, for use in the m_rghSprites[] array
+	HSPRITE GetSpriteHandle(const char* szSprite); // loads sprites/<szSprite>.spr once per VidInit
 
 	CHudAmmo m_Ammo;
 	CHudHealth m_Health;
@@ -581,7 +597,7 @@ public:
 	bool Redraw(float flTime, bool intermission);
 	bool UpdateClientData(client_data_t* cdata, float time);
 
-	CHud() : m_iSpriteCount(0), m_pHudList(NULL) {}
+	CHud() : m_iSpriteCount(0), m_pHudList(NULL), m_rgiSpriteHash(NULL), m_iSpriteRes(0), m_iSpriteLoad(0) {}
 	~CHud(); // destructor, frees allocated memory
 
 	// user messages
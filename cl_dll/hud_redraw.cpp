@@ -22,6 +22,8 @@
 
 #include "materials/CMaterialSystem.h"
 
+#include "frameprof.h"
+
 #define MAX_LOGO_FRAMES 56
 
 int grgLogoFrame[MAX_LOGO_FRAMES] =
@@ -158,10 +160,13 @@ bool CHud::Redraw(float flTime, bool intermission)
 	// draw all registered HUD elements
 	if (0 != m_pCvarDraw->value)
 	{
+		FRAMEPROF_SCOPE(FRAMEPROF_HUD);
 		HUDLIST* pList = m_pHudList;
 
 		while (pList)
 		{
+			CFrameProfScope elementScope(g_fFrameProfActive ? FrameProf_HudZone(pList->p) : -1);
+
 			if (!intermission)
 			{
 				if ((pList->p->m_iFlags & HUD_ACTIVE) != 0 && (m_iHideHUDDisplay & HIDEHUD_ALL) == 0)
@@ -220,6 +225,8 @@ bool CHud::Redraw(float flTime, bool intermission)
 	}
 	*/
 
+	FrameProf_Draw();
+
 	return true;
 }
 
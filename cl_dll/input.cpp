@@ -1012,6 +1012,7 @@ void ShutdownInput()
 
 #include "interface.h"
 void CL_UnloadParticleMan();
+void StudioShutdownWorkers();
 
 
 void DLLEXPORT HUD_Shutdown()
@@ -1023,4 +1024,5 @@ void DLLEXPORT HUD_Shutdown()
 
 	FileSystem_FreeFileSystem();
 	CL_UnloadParticleMan();
+	StudioShutdownWorkers();
 }
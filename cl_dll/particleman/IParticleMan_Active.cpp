@@ -22,6 +22,7 @@
 #include "particleman_internal.h"
 #include "CMiniMem.h"
 #include "IParticleMan_Active.h"
+#include "frameprof.h"
 
 static bool g_iRenderMode = true;
 
@@ -127,7 +128,10 @@ void IParticleMan_Active::Update()
 
 	g_cFrustum.CalculateFrustum();
 
-	memory->ProcessAll();
+	{
+		FRAMEPROF_SCOPE(FRAMEPROF_PARTICLES);
+		memory->ProcessAll();
+	}
 
 	if (nullptr != cl_pmanstats && cl_pmanstats->value == 1)
 	{
@@ -12,6 +12,10 @@
 #include "com_model.h"
 #include "studio_util.h"
 
+#ifdef STUDIO_SSE
+#include <xmmintrin.h>
+#endif
+
 // angles index are not the same as ROLL, PITCH, YAW
 
 /*
@@ -136,4 +140,184 @@ MatrixCopy
 void MatrixCopy(float in[3][4], float out[3][4])
 {
 	memcpy(out, in, sizeof(float) * 3 * 4);
-}
\ No newline at end of file
+}
+
+/*
+====================
+QuaternionSlerpArray
+
+p[i] = slerp( p[i], q[i], t ), four quaternions at a time.
+The acos/sin weights are still computed per quaternion with
+the same expressions as QuaternionSlerp, so the results match
+it; only the nearly opposite case falls back to it entirely.
+====================
+*/
+void QuaternionSlerpArray(vec4_t p[], vec4_t q[], float t, int count)
+{
+	int i = 0;
+
+#ifdef STUDIO_SSE
+	const __m128 signmask = _mm_set1_ps(-0.0f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 px = _mm_loadu_ps(p[i]);
+		__m128 py = _mm_loadu_ps(p[i + 1]);
+		__m128 pz = _mm_loadu_ps(p[i + 2]);
+		__m128 pw = _mm_loadu_ps(p[i + 3]);
+		__m128 qx = _mm_loadu_ps(q[i]);
+		__m128 qy = _mm_loadu_ps(q[i + 1]);
+		__m128 qz = _mm_loadu_ps(q[i + 2]);
+		__m128 qw = _mm_loadu_ps(q[i + 3]);
+		_MM_TRANSPOSE4_PS(px, py, pz, pw);
+		_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+		// decide if one of the quaternions is backwards
+		__m128 d, a, b;
+		d = _mm_sub_ps(px, qx);
+		a = _mm_mul_ps(d, d);
+		d = _mm_sub_ps(py, qy);
+		a = _mm_add_ps(a, _mm_mul_ps(d, d));
+		d = _mm_sub_ps(pz, qz);
+		a = _mm_add_ps(a, _mm_mul_ps(d, d));
+		d = _mm_sub_ps(pw, qw);
+		a = _mm_add_ps(a, _mm_mul_ps(d, d));
+		d = _mm_add_ps(px, qx);
+		b = _mm_mul_ps(d, d);
+		d = _mm_add_ps(py, qy);
+		b = _mm_add_ps(b, _mm_mul_ps(d, d));
+		d = _mm_add_ps(pz, qz);
+		b = _mm_add_ps(b, _mm_mul_ps(d, d));
+		d = _mm_add_ps(pw, qw);
+		b = _mm_add_ps(b, _mm_mul_ps(d, d));
+
+		const __m128 flip = _mm_and_ps(_mm_cmpgt_ps(a, b), signmask);
+		qx = _mm_xor_ps(qx, flip);
+		qy = _mm_xor_ps(qy, flip);
+		qz = _mm_xor_ps(qz, flip);
+		qw = _mm_xor_ps(qw, flip);
+
+		__m128 cosom = _mm_mul_ps(px, qx);
+		cosom = _mm_add_ps(cosom, _mm_mul_ps(py, qy));
+		cosom = _mm_add_ps(cosom, _mm_mul_ps(pz, qz));
+		cosom = _mm_add_ps(cosom, _mm_mul_ps(pw, qw));
+
+		float cosoms[4], sclp[4], sclq[4];
+		int opposite = 0;
+		int j;
+
+		_mm_storeu_ps(cosoms, cosom);
+
+		for (j = 0; j < 4; j++)
+		{
+			if ((1.0 + cosoms[j]) > 0.000001)
+			{
+				if ((1.0 - cosoms[j]) > 0.000001)
+				{
+					const float omega = acos(cosoms[j]);
+					const float sinom = sin(omega);
+					sclp[j] = sin((1.0 - t) * omega) / sinom;
+					sclq[j] = sin(t * omega) / sinom;
+				}
+				else
+				{
+					sclp[j] = 1.0 - t;
+					sclq[j] = t;
+				}
+			}
+			else
+			{
+				opposite |= 1 << j;
+				sclp[j] = sclq[j] = 0;
+			}
+		}
+
+		vec4_t fallback[4];
+		for (j = 0; j < 4; j++)
+		{
+			if ((opposite & (1 << j)) != 0)
+				QuaternionSlerp(p[i + j], q[i + j], t, fallback[j]);
+		}
+
+		const __m128 vp = _mm_loadu_ps(sclp);
+		const __m128 vq = _mm_loadu_ps(sclq);
+		px = _mm_add_ps(_mm_mul_ps(vp, px), _mm_mul_ps(vq, qx));
+		py = _mm_add_ps(_mm_mul_ps(vp, py), _mm_mul_ps(vq, qy));
+		pz = _mm_add_ps(_mm_mul_ps(vp, pz), _mm_mul_ps(vq, qz));
+		pw = _mm_add_ps(_mm_mul_ps(vp, pw), _mm_mul_ps(vq, qw));
+		_MM_TRANSPOSE4_PS(px, py, pz, pw);
+		_mm_storeu_ps(p[i], px);
+		_mm_storeu_ps(p[i + 1], py);
+		_mm_storeu_ps(p[i + 2], pz);
+		_mm_storeu_ps(p[i + 3], pw);
+
+		for (j = 0; j < 4; j++)
+		{
+			if ((opposite & (1 << j)) != 0)
+				memcpy(p[i + j], fallback[j], sizeof(vec4_t));
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		vec4_t qt;
+		QuaternionSlerp(p[i], q[i], t, qt);
+		memcpy(p[i], qt, sizeof(vec4_t));
+	}
+}
+
+/*
+====================
+VectorLerpArray
+
+a[i] = a[i] * ( 1 - t ) + b[i] * t
+====================
+*/
+void VectorLerpArray(float a[][3], float b[][3], float t, int count)
+{
+	float* pa = a[0];
+	const float* pb = b[0];
+	const float t1 = 1.0 - t;
+	const int floats = count * 3;
+	int i = 0;
+
+#ifdef STUDIO_SSE
+	const __m128 vt = _mm_set1_ps(t);
+	const __m128 vt1 = _mm_set1_ps(t1);
+
+	for (; i + 4 <= floats; i += 4)
+		_mm_storeu_ps(pa + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pa + i), vt1), _mm_mul_ps(_mm_loadu_ps(pb + i), vt)));
+#endif
+
+	for (; i < floats; i++)
+		pa[i] = pa[i] * t1 + pb[i] * t;
+}
+
+/*
+====================
+ConcatBoneTransforms
+
+ConcatTransforms with each output row built from the rows of
+in2, adding in the same order so the results are the same
+====================
+*/
+void ConcatBoneTransforms(float in1[3][4], float in2[3][4], float out[3][4])
+{
+#ifdef STUDIO_SSE
+	const __m128 row0 = _mm_loadu_ps(in2[0]);
+	const __m128 row1 = _mm_loadu_ps(in2[1]);
+	const __m128 row2 = _mm_loadu_ps(in2[2]);
+
+	for (int i = 0; i < 3; i++)
+	{
+		__m128 r = _mm_mul_ps(_mm_set1_ps(in1[i][0]), row0);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(in1[i][1]), row1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(in1[i][2]), row2));
+		r = _mm_add_ps(r, _mm_set_ps(in1[i][3], 0, 0, 0));
+		_mm_storeu_ps(out[i], r);
+	}
+#else
+	ConcatTransforms(in1, in2, out);
+#endif
+}
@@ -28,3 +28,12 @@ void	MatrixCopy( float in[3][4], float out[3][4] );
 void	QuaternionMatrix( vec4_t quaternion, float (*matrix)[4] );
 void	QuaternionSlerp( vec4_t p, vec4_t q, float t, vec4_t qt );
 void	AngleQuaternion( float *angles, vec4_t quaternion );
+
+// Batched versions for bone setup, SSE where the compiler targets it
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define STUDIO_SSE
+#endif
+
+void	QuaternionSlerpArray( vec4_t p[], vec4_t q[], float t, int count );
+void	VectorLerpArray( float a[][3], float b[][3], float t, int count );
+void	ConcatBoneTransforms( float in1[3][4], float in2[3][4], float out[3][4] );
@@ -53,6 +53,7 @@
 #include "vgui_TeamFortressViewport.h"
 #include "vgui_ScorePanel.h"
 #include "vgui_SpectatorPanel.h"
+#include "frameprof.h"
 
 #include "shake.h"
 #include "screenfade.h"
@@ -1697,6 +1698,8 @@ void TeamFortressViewport::GetAllPlayersInfo()
 
 void TeamFortressViewport::paintBackground()
 {
+	FRAMEPROF_SCOPE(FRAMEPROF_VGUI);
+
 	int wide, tall;
 	getParent()->getSize(wide, tall);
 	setSize(wide, tall);
@@ -19,6 +19,7 @@
 #include "shake.h"
 #include "hltv.h"
 #include "Exports.h"
+#include "frameprof.h"
 
 int CL_IsThirdPerson();
 void CL_CameraOffset(float* ofs);
@@ -1625,6 +1626,8 @@ void DLLEXPORT V_CalcRefdef(struct ref_params_s* pparams)
 {
 	//	RecClCalcRefdef(pparams);
 
+	FRAMEPROF_SCOPE(FRAMEPROF_VIEW);
+
 	// intermission / finale rendering
 	if (0 != pparams->intermission)
 	{
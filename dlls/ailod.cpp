@@ -0,0 +1,284 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// ailod.cpp - AI level of detail
+//
+// Each time a monster thinks it is given a level from its
+// distance to the nearest player and whether any player's
+// PVS holds it. Monsters in combat, in a script, with an
+// enemy or recently hurt always think at full rate, and
+// moving monsters no slower than AILOD_NEAR so their routes
+// stay smooth.
+//
+// Slower levels think on a phase picked from the entity
+// index, so a crowd that drops to the same level doesn't
+// end up thinking on the same frame.
+//
+// With ai_budget set, once the AI run this frame has taken
+// that many milliseconds, AILOD_FAR and AILOD_DORMANT
+// monsters are put off to the next frame.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "monsters.h"
+#include "game.h"
+#include "perf_counter.h"
+#include "ailod.h"
+
+#define AILOD_DAMAGE_TIME 5.0 // seconds a hurt monster stays at full rate
+#define AILOD_PVS_BYTES (8192 / 8) // the engine's PVS buffers hold MAX_MAP_LEAFS bits
+
+static const float g_flAILodInterval[AILOD_LEVELS] = {0.1, 0.2, 0.5, 1.0};
+
+typedef struct
+{
+	Vector origin;
+	bool pvsBuilt;
+	byte pvs[AILOD_PVS_BYTES];
+} lodplayer_t;
+
+static lodplayer_t g_LodPlayers[MAX_PLAYERS];
+static int g_iLodPlayers;
+
+static CPerformanceCounter g_AILodTimer;
+static double g_flAITime; // seconds of AI run this frame
+
+typedef struct
+{
+	int frames;
+	int thought[AILOD_LEVELS];
+	int deferred;
+	int peak; // most monsters thought in one frame
+	double time;
+} lodstats_t;
+
+static lodstats_t g_LodStats;	  // the current window
+static lodstats_t g_LodLastStats; // the last complete window
+static float g_flLodWindowStart;
+static int g_iLodFrameThought;
+
+//=========================================================
+// AILOD_Frame - gathers the players' view origins, the
+// PVS of each is only built when a monster asks for it.
+//=========================================================
+void AILOD_Frame()
+{
+	int i;
+
+	g_iLodPlayers = 0;
+
+	for (i = 1; i <= gpGlobals->maxClients; i++)
+	{
+		CBaseEntity* pPlayer = UTIL_PlayerByIndex(i);
+
+		if (!pPlayer || (pPlayer->pev->flags & FL_CLIENT) == 0)
+			continue;
+
+		lodplayer_t* p = &g_LodPlayers[g_iLodPlayers++];
+		p->origin = pPlayer->pev->origin + pPlayer->pev->view_ofs;
+		p->pvsBuilt = false;
+	}
+
+	// one second windows for ai_lod_stats
+	g_LodStats.frames++;
+	g_LodStats.time += g_flAITime;
+	g_LodStats.peak = V_max(g_LodStats.peak, g_iLodFrameThought);
+
+	if (gpGlobals->time - g_flLodWindowStart >= 1.0 || gpGlobals->time < g_flLodWindowStart)
+	{
+		g_LodLastStats = g_LodStats;
+		memset(&g_LodStats, 0, sizeof(g_LodStats));
+		g_flLodWindowStart = gpGlobals->time;
+	}
+
+	g_flAITime = 0;
+	g_iLodFrameThought = 0;
+}
+
+static bool AILOD_InPlayerPVS(CBaseMonster* pMonster)
+{
+	for (int i = 0; i < g_iLodPlayers; i++)
+	{
+		lodplayer_t* p = &g_LodPlayers[i];
+
+		if (!p->pvsBuilt)
+		{
+			memcpy(p->pvs, ENGINE_SET_PVS(p->origin), sizeof(p->pvs));
+			p->pvsBuilt = true;
+		}
+
+		if (0 != ENGINE_CHECK_VISIBILITY(pMonster->edict(), p->pvs))
+			return true;
+	}
+
+	return false;
+}
+
+//=========================================================
+// AILOD_Level
+//=========================================================
+int AILOD_Level(CBaseMonster* pMonster)
+{
+	if (0 == ai_lod.value)
+		return AILOD_FULL;
+
+	switch (pMonster->m_MonsterState)
+	{
+	case MONSTERSTATE_COMBAT:
+	case MONSTERSTATE_SCRIPT:
+	case MONSTERSTATE_PRONE:
+		return AILOD_FULL;
+	default:
+		break;
+	}
+
+	if (pMonster->m_hEnemy != NULL || pMonster->m_pCine != NULL)
+		return AILOD_FULL;
+
+	if (0 != pMonster->m_flLastDamageTime && gpGlobals->time - pMonster->m_flLastDamageTime < AILOD_DAMAGE_TIME)
+		return AILOD_FULL;
+
+	// no one to see it yet, e.g. before the player spawns
+	if (g_iLodPlayers == 0)
+		return AILOD_FULL;
+
+	float flNearest = 0;
+
+	for (int i = 0; i < g_iLodPlayers; i++)
+	{
+		const float flDist = (g_LodPlayers[i].origin - pMonster->pev->origin).Length();
+
+		if (i == 0 || flDist < flNearest)
+			flNearest = flDist;
+	}
+
+	int level;
+
+	if (AILOD_InPlayerPVS(pMonster))
+	{
+		if (flNearest < ai_lod_near.value)
+			level = AILOD_FULL;
+		else if (flNearest < ai_lod_far.value)
+			level = AILOD_NEAR;
+		else
+			level = AILOD_FAR;
+	}
+	else
+	{
+		if (flNearest < ai_lod_near.value)
+			level = AILOD_NEAR;
+		else if (flNearest < ai_lod_far.value)
+			level = AILOD_FAR;
+		else
+			level = AILOD_DORMANT;
+	}
+
+	if (pMonster->m_movementGoal != MOVEGOAL_NONE)
+		level = V_min(level, (int)AILOD_NEAR);
+
+	return level;
+}
+
+//=========================================================
+// AILOD_NextThink
+//=========================================================
+float AILOD_NextThink(CBaseMonster* pMonster, int level)
+{
+	const float flInterval = g_flAILodInterval[level];
+
+	if (level == AILOD_FULL)
+		return gpGlobals->time + flInterval;
+
+	// the next time on this monster's phase, at least a full rate think away
+	const float flPhase = fmod(pMonster->entindex() * 0.618034f, 1.0f) * flInterval;
+	float flNext = (floor((gpGlobals->time - flPhase) / flInterval) + 1) * flInterval + flPhase;
+
+	if (flNext < gpGlobals->time + g_flAILodInterval[AILOD_FULL])
+		flNext += flInterval;
+
+	return flNext;
+}
+
+//=========================================================
+// AILOD_Wake
+//=========================================================
+void AILOD_Wake(CBaseMonster* pMonster)
+{
+	pMonster->m_flLastDamageTime = gpGlobals->time;
+
+	if (pMonster->m_pfnThink == static_cast<void (CBaseEntity::*)()>(&CBaseMonster::CallMonsterThink) &&
+		pMonster->pev->nextthink > gpGlobals->time + g_flAILodInterval[AILOD_FULL])
+	{
+		pMonster->pev->nextthink = gpGlobals->time + g_flAILodInterval[AILOD_FULL];
+	}
+}
+
+//=========================================================
+// AILOD_Defer
+//=========================================================
+bool AILOD_Defer(int level)
+{
+	if (ai_budget.value <= 0 || level < AILOD_FAR)
+		return false;
+
+	if (g_flAITime * 1000 < ai_budget.value)
+		return false;
+
+	g_LodStats.deferred++;
+	return true;
+}
+
+double AILOD_Begin()
+{
+	return g_AILodTimer.GetCurTime();
+}
+
+void AILOD_End(int level, double start)
+{
+	g_flAITime += g_AILodTimer.GetCurTime() - start;
+	g_LodStats.thought[level]++;
+	g_iLodFrameThought++;
+}
+
+//=========================================================
+// AILOD_Stats - "ai_lod_stats" server command, prints the
+// last complete second.
+//=========================================================
+static void AILOD_Stats()
+{
+	const lodstats_t* s = &g_LodLastStats;
+
+	if (0 == s->frames)
+	{
+		g_engfuncs.pfnServerPrint("ai_lod_stats: no complete window yet\n");
+		return;
+	}
+
+	int total = 0;
+	for (int i = 0; i < AILOD_LEVELS; i++)
+		total += s->thought[i];
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("ai_lod_stats: %d frames, %.1f monsters thought per frame (peak %d), %.3f ms AI per frame\n",
+		s->frames, (float)total / s->frames, s->peak, s->time * 1000 / s->frames));
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  full %d  near %d  far %d  dormant %d  deferred %d\n",
+		s->thought[AILOD_FULL], s->thought[AILOD_NEAR], s->thought[AILOD_FAR], s->thought[AILOD_DORMANT], s->deferred));
+}
+
+void AILOD_Init()
+{
+	g_engfuncs.pfnAddServerCommand("ai_lod_stats", AILOD_Stats);
+}
@@ -0,0 +1,47 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+//=========================================================
+// ailod.h - AI level of detail. Monsters that are far from
+// every player or out of every player's PVS run their AI
+// less often than 10 Hz, and ai_budget caps the time the
+// low priority ones may take in a frame.
+//=========================================================
+
+enum
+{
+	AILOD_FULL = 0, // every 0.1 seconds, as before
+	AILOD_NEAR,
+	AILOD_FAR,
+	AILOD_DORMANT,
+
+	AILOD_LEVELS
+};
+
+class CBaseMonster;
+
+void AILOD_Init();
+void AILOD_Frame(); // from StartFrame, before any entity thinks
+
+int AILOD_Level(CBaseMonster* pMonster);
+float AILOD_NextThink(CBaseMonster* pMonster, int level);
+void AILOD_Wake(CBaseMonster* pMonster); // took damage, think at full rate again right away
+
+// Returns true if the AI time for this frame is used up and the monster should wait a frame
+bool AILOD_Defer(int level);
+double AILOD_Begin();
+void AILOD_End(int level, double start);
@@ -50,6 +50,198 @@ bool ExtractBbox(void* pmodel, int sequence, float* mins, float* maxs)
 }
 
 
+// Sequence lookup tables for each model, built the first time the model is searched
+#define SEQUENCE_CACHE_MODELS 512 // must be a power of two
+
+typedef struct
+{
+	int activity;
+	int first; // into sequences and cumweight
+	int count;
+	int heaviest; // ACTIVITY_NOT_AVAILABLE if every weight is 0
+} seqactivity_t;
+
+typedef struct
+{
+	studiohdr_t* pstudiohdr; // NULL if the slot is empty
+	int length;
+	char name[64];
+
+	int namemask;
+	short* names; // sequence + 1 by label hash, 0 if empty
+
+	int numactivities;
+	seqactivity_t* activities; // sorted by activity
+	short* sequences;		   // grouped by activity, in model order
+	int* cumweight;			   // running actweight total within each group
+} seqcache_t;
+
+static seqcache_t g_SequenceCache[SEQUENCE_CACHE_MODELS];
+
+static unsigned int SequenceNameHash(const char* label)
+{
+	unsigned int hash = 2166136261u;
+
+	for (; '\0' != *label; label++)
+	{
+		hash ^= (unsigned char)tolower(*label);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void SequenceCache_Free(seqcache_t* pcache)
+{
+	delete[] pcache->names;
+	delete[] pcache->activities;
+	delete[] pcache->sequences;
+	delete[] pcache->cumweight;
+	memset(pcache, 0, sizeof(*pcache));
+}
+
+void SequenceCache_Reset()
+{
+	for (int i = 0; i < SEQUENCE_CACHE_MODELS; i++)
+		SequenceCache_Free(&g_SequenceCache[i]);
+}
+
+static mstudioseqdesc_t* g_pSortSeqDesc;
+
+static int SequenceCompareActivity(const void* a, const void* b)
+{
+	const int seqa = *(const short*)a;
+	const int seqb = *(const short*)b;
+
+	if (g_pSortSeqDesc[seqa].activity != g_pSortSeqDesc[seqb].activity)
+		return g_pSortSeqDesc[seqa].activity < g_pSortSeqDesc[seqb].activity ? -1 : 1;
+
+	return seqa - seqb;
+}
+
+static void SequenceCache_Build(seqcache_t* pcache, studiohdr_t* pstudiohdr)
+{
+	mstudioseqdesc_t* pseqdesc = (mstudioseqdesc_t*)((byte*)pstudiohdr + pstudiohdr->seqindex);
+	const int numseq = pstudiohdr->numseq;
+	int i;
+
+	SequenceCache_Free(pcache);
+
+	pcache->pstudiohdr = pstudiohdr;
+	pcache->length = pstudiohdr->length;
+	strncpy(pcache->name, pstudiohdr->name, sizeof(pcache->name));
+
+	// names, kept under half full; the first of two equal labels stays first in its probe chain
+	int size = 16;
+	while (size < numseq * 2)
+		size <<= 1;
+
+	pcache->namemask = size - 1;
+	pcache->names = new short[size];
+	memset(pcache->names, 0, size * sizeof(short));
+
+	for (i = 0; i < numseq; i++)
+	{
+		unsigned int slot = SequenceNameHash(pseqdesc[i].label) & pcache->namemask;
+
+		while (0 != pcache->names[slot])
+			slot = (slot + 1) & pcache->namemask;
+
+		pcache->names[slot] = i + 1;
+	}
+
+	// activities
+	pcache->sequences = new short[V_max(numseq, 1)];
+	pcache->cumweight = new int[V_max(numseq, 1)];
+	pcache->activities = new seqactivity_t[V_max(numseq, 1)];
+	pcache->numactivities = 0;
+
+	for (i = 0; i < numseq; i++)
+		pcache->sequences[i] = i;
+
+	g_pSortSeqDesc = pseqdesc;
+	qsort(pcache->sequences, numseq, sizeof(short), SequenceCompareActivity);
+
+	seqactivity_t* pact = NULL;
+	int heaviestweight = 0;
+
+	for (i = 0; i < numseq; i++)
+	{
+		mstudioseqdesc_t* pseq = &pseqdesc[pcache->sequences[i]];
+
+		if (!pact || pact->activity != pseq->activity)
+		{
+			pact = &pcache->activities[pcache->numactivities++];
+			pact->activity = pseq->activity;
+			pact->first = i;
+			pact->count = 0;
+			pact->heaviest = ACTIVITY_NOT_AVAILABLE;
+			heaviestweight = 0;
+		}
+
+		pcache->cumweight[i] = (0 != pact->count ? pcache->cumweight[i - 1] : 0) + pseq->actweight;
+		pact->count++;
+
+		if (pseq->actweight > heaviestweight)
+		{
+			heaviestweight = pseq->actweight;
+			pact->heaviest = pcache->sequences[i];
+		}
+	}
+}
+
+static seqcache_t* SequenceCache_Get(studiohdr_t* pstudiohdr)
+{
+	const unsigned int home = ((unsigned int)((size_t)pstudiohdr >> 4) * 2654435761u) & (SEQUENCE_CACHE_MODELS - 1);
+	seqcache_t* pcache;
+
+	for (int i = 0; i < 8; i++)
+	{
+		pcache = &g_SequenceCache[(home + i) & (SEQUENCE_CACHE_MODELS - 1)];
+
+		if (pcache->pstudiohdr == pstudiohdr)
+		{
+			// a different model loaded at the same address?
+			if (pcache->length != pstudiohdr->length || 0 != strncmp(pcache->name, pstudiohdr->name, sizeof(pcache->name)))
+				SequenceCache_Build(pcache, pstudiohdr);
+
+			return pcache;
+		}
+
+		if (!pcache->pstudiohdr)
+		{
+			SequenceCache_Build(pcache, pstudiohdr);
+			return pcache;
+		}
+	}
+
+	// too crowded, take over the home slot
+	pcache = &g_SequenceCache[home];
+	SequenceCache_Build(pcache, pstudiohdr);
+	return pcache;
+}
+
+static const seqactivity_t* SequenceCache_FindActivity(const seqcache_t* pcache, int activity)
+{
+	int low = 0;
+	int high = pcache->numactivities - 1;
+
+	while (low <= high)
+	{
+		const int mid = (low + high) / 2;
+
+		if (pcache->activities[mid].activity == activity)
+			return &pcache->activities[mid];
+
+		if (pcache->activities[mid].activity < activity)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return NULL;
+}
+
 int LookupActivity(void* pmodel, entvars_t* pev, int activity)
 {
 	studiohdr_t* pstudiohdr;
@@ -58,23 +250,35 @@ int LookupActivity(void* pmodel, entvars_t* pev, int activity)
 	if (!pstudiohdr)
 		return 0;
 
-	mstudioseqdesc_t* pseqdesc;
+	const seqcache_t* pcache = SequenceCache_Get(pstudiohdr);
+	const seqactivity_t* pact = SequenceCache_FindActivity(pcache, activity);
 
-	pseqdesc = (mstudioseqdesc_t*)((byte*)pstudiohdr + pstudiohdr->seqindex);
+	if (!pact)
+		return ACTIVITY_NOT_AVAILABLE;
 
-	int weighttotal = 0;
-	int seq = ACTIVITY_NOT_AVAILABLE;
-	for (int i = 0; i < pstudiohdr->numseq; i++)
+	const int last = pact->first + pact->count - 1;
+	const int weighttotal = pcache->cumweight[last];
+
+	// nothing weighted, the last one wins
+	if (weighttotal <= 0)
+		return pcache->sequences[last];
+
+	// the first sequence whose running total passes the pick
+	const int pick = RANDOM_LONG(0, weighttotal - 1);
+	int low = pact->first;
+	int high = last;
+
+	while (low < high)
 	{
-		if (pseqdesc[i].activity == activity)
-		{
-			weighttotal += pseqdesc[i].actweight;
-			if (0 == weighttotal || RANDOM_LONG(0, weighttotal - 1) < pseqdesc[i].actweight)
-				seq = i;
-		}
+		const int mid = (low + high) / 2;
+
+		if (pcache->cumweight[mid] > pick)
+			high = mid;
+		else
+			low = mid + 1;
 	}
 
-	return seq;
+	return pcache->sequences[low];
 }
 
 
@@ -86,25 +290,12 @@ int LookupActivityHeaviest(void* pmodel, entvars_t* pev, int activity)
 	if (!pstudiohdr)
 		return 0;
 
-	mstudioseqdesc_t* pseqdesc;
-
-	pseqdesc = (mstudioseqdesc_t*)((byte*)pstudiohdr + pstudiohdr->seqindex);
+	const seqactivity_t* pact = SequenceCache_FindActivity(SequenceCache_Get(pstudiohdr), activity);
 
-	int weight = 0;
-	int seq = ACTIVITY_NOT_AVAILABLE;
-	for (int i = 0; i < pstudiohdr->numseq; i++)
-	{
-		if (pseqdesc[i].activity == activity)
-		{
-			if (pseqdesc[i].actweight > weight)
-			{
-				weight = pseqdesc[i].actweight;
-				seq = i;
-			}
-		}
-	}
+	if (!pact)
+		return ACTIVITY_NOT_AVAILABLE;
 
-	return seq;
+	return pact->heaviest;
 }
 
 void GetEyePosition(void* pmodel, float* vecEyePosition)
@@ -134,8 +325,13 @@ int LookupSequence(void* pmodel, const char* label)
 
 	pseqdesc = (mstudioseqdesc_t*)((byte*)pstudiohdr + pstudiohdr->seqindex);
 
-	for (int i = 0; i < pstudiohdr->numseq; i++)
+	const seqcache_t* pcache = SequenceCache_Get(pstudiohdr);
+	unsigned int slot = SequenceNameHash(label) & pcache->namemask;
+
+	for (; 0 != pcache->names[slot]; slot = (slot + 1) & pcache->namemask)
 	{
+		const int i = pcache->names[slot] - 1;
+
 		if (stricmp(pseqdesc[i].label, label) == 0)
 			return i;
 	}
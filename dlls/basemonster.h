@@ -60,6 +60,7 @@ public:
 	WayPoint_t m_Route[ROUTE_SIZE]; // Positions of movement
 	int m_movementGoal;				// Goal that defines route
 	int m_iRouteIndex;				// index into m_Route[]
+	nodepath_t m_NodePath;			// the node path m_Route was last filled from, see routecache.cpp
 	float m_moveWaitTime;			// How long I should wait for something to move
 
 	Vector m_vecMoveGoal;		 // kept around for node graph moves, so we know our ultimate goal
@@ -95,6 +96,8 @@ public:
 
 	float m_flHungryTime; // set this is a future time to stop the monster from eating for a while.
 
+	float m_flLastDamageTime; // keeps the AI at full rate for a while, not saved
+
 	float m_flDistTooFar; // if enemy farther away than this, bits_COND_ENEMY_TOOFAR set in CheckEnemy
 	float m_flDistLook;	  // distance monster sees (Default 2048)
 
@@ -210,6 +213,9 @@ public:
 	bool PopEnemy();
 
 	bool FGetNodeRoute(Vector vecDest);
+	bool FCopyNodeRoute(const Vector& vecDest, const int* iPath, int iResult);
+	int RouteNode(int iRoute);
+	int CheckRouteLocalMove(const Vector& vecStart, int iStartNode, int iRoute, CBaseEntity* pTargetEnt);
 
 	inline void TaskComplete()
 	{
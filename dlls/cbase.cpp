@@ -155,6 +155,7 @@ int DispatchSpawn(edict_t* pent)
 		pEntity->pev->absmax = pEntity->pev->origin + Vector(1, 1, 1);
 
 		pEntity->Spawn();
+		NameIndex_Changed();
 
 		// Try to get the pointer again, in case the spawn function deleted the entity.
 		// UNDONE: Spawn() should really return a code to ask that the entity be deleted, but
@@ -201,6 +202,7 @@ void DispatchKeyValue(edict_t* pentKeyvalue, KeyValueData* pkvd)
 		return;
 
 	EntvarsKeyvalue(VARS(pentKeyvalue), pkvd);
+	NameIndex_Changed();
 
 	// If the key was an entity variable, or there's no class set yet, don't look for the object, it may
 	// not exist yet.
@@ -391,6 +393,8 @@ int DispatchRestore(edict_t* pent, SAVERESTOREDATA* pSaveData, int globalEntity)
 			pEntity->Precache();
 		}
 
+		NameIndex_Changed();
+
 		// Again, could be deleted, get the pointer again.
 		pEntity = (CBaseEntity*)GET_PRIVATE(pent);
 
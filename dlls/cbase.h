@@ -49,6 +49,8 @@ CBaseEntity
 #include "saverestore.h"
 #include "schedule.h"
 #include "monsterevent.h"
+#include "entpool.h"
+#include "routecache.h"
 
 // C functions for external declarations that call the appropriate C++ methods
 
@@ -248,15 +250,15 @@ public:
 	void* operator new(size_t stAllocateBlock)
 	{
 		//Allocate zero-initialized memory.
-		auto memory = ::operator new(stAllocateBlock);
+		auto memory = EntPool_Alloc(stAllocateBlock);
 		std::memset(memory, 0, stAllocateBlock);
 		return memory;
 	}
 
 	//Don't call delete on entities directly, tell the engine to delete it instead.
-	void operator delete(void* pMem)
+	void operator delete(void* pMem, size_t stAllocateBlock)
 	{
-		::operator delete(pMem);
+		EntPool_Free(pMem, stAllocateBlock);
 	}
 
 	void UpdateOnRemove();
@@ -697,6 +699,10 @@ public:
 // Converts a entvars_t * to a class pointer
 // It will allocate the class and entity if necessary
 //
+
+// counts every entity given a class, so a caller holding a list of edicts can tell if one was created meanwhile
+inline int g_iEntitiesCreated;
+
 template <class T>
 T* GetClassPtr(T* a)
 {
@@ -706,6 +712,9 @@ T* GetClassPtr(T* a)
 	if (pev == NULL)
 		pev = VARS(CREATE_ENTITY());
 
+	// it's about to get a classname, and maybe a targetname
+	NameIndex_Changed();
+
 	// get the private data
 	a = (T*)GET_PRIVATE(ENT(pev));
 
@@ -713,6 +722,7 @@ T* GetClassPtr(T* a)
 	{
 		// allocate private data
 		a = new T;
+		g_iEntitiesCreated++;
 
 		//Replicate the ALLOC_PRIVATE engine function's behavior.
 		pev->pContainingEntity->pvPrivateData = a;
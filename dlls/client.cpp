@@ -40,12 +40,19 @@
 #include "netadr.h"
 #include "pm_shared.h"
 #include "UserMessages.h"
+#include "netprof.h"
+#include "lagcomp.h"
+#include "ailod.h"
+#include "movecache.h"
+#include "tracecache.h"
+#include "animation.h"
 
 DLL_GLOBAL unsigned int g_ulFrameCount;
 
 extern void CopyToBodyQue(entvars_t* pev);
 
 void LinkUserMessages();
+static void PackCache_Reset();
 
 /*
  * used by kill command and disconnect command
@@ -198,6 +205,7 @@ void ClientPutInServer(edict_t* pEntity)
 
 	pPlayer = GetClassPtr((CBasePlayer*)pev);
 	pPlayer->SetCustomDecalFrames(-1); // Assume none;
+	pPlayer->m_HudQueue.Clear();	   // drop anything queued for the previous occupant of this slot
 
 	// Allocate a CBasePlayer for pev, and call spawn
 	pPlayer->Spawn();
@@ -687,6 +695,10 @@ void ServerDeactivate()
 
 	// Peform any shutdown operations here...
 	//
+	PackCache_Reset();
+	SequenceCache_Reset();
+	NameIndex_Reset();
+	RouteCache_Reset();
 }
 
 void ServerActivate(edict_t* pEdictList, int edictCount, int clientMax)
@@ -697,6 +709,9 @@ void ServerActivate(edict_t* pEdictList, int edictCount, int clientMax)
 	// Every call to ServerActivate should be matched by a call to ServerDeactivate
 	g_serveractive = 1;
 
+	PackCache_Reset();
+	LagComp_Reset();
+
 	// Clients have not been initialized yet
 	for (i = 0; i < edictCount; i++)
 	{
@@ -779,6 +794,16 @@ void ParmsChangeLevel()
 //
 void StartFrame()
 {
+	NetProf_Frame();
+	LagComp_Record();
+	AILOD_Frame();
+	MoveCache_Frame();
+	NameIndex_Frame();
+	TraceCache_Frame();
+
+	// counted during intermission too, the pack cache is rebuilt on every new frame
+	g_ulFrameCount++;
+
 	if (g_pGameRules)
 		g_pGameRules->Think();
 
@@ -786,7 +811,6 @@ void StartFrame()
 		return;
 
 	gpGlobals->teamplay = teamplay.value;
-	g_ulFrameCount++;
 }
 
 
@@ -1026,6 +1050,223 @@ void SpectatorThink(edict_t* pEntity)
 // PAS and PVS routines for client messaging
 //
 
+/*
+================
+Full pack cache
+
+AddToFullPack is called for every client/entity pair each frame.  Whatever does not depend on
+the client is worked out once per frame, the first time SetupVisibility runs after the world has
+moved.  Entities linked into an identical set of leafs always pass or fail the PVS test together,
+so they share a cluster and the engine visibility check is only done once per cluster per client.
+================
+*/
+#define PACK_NEVER 1	 // no model, never sent
+#define PACK_HOSTONLY 2	 // EF_NODRAW or spectator, only sent to itself
+#define PACK_SKIPLOCAL 4 // FL_SKIPLOCALHOST
+
+enum
+{
+	PACK_PRIORITY_ESSENTIAL = 0, // players, brush models, beams, attachments and player owned entities
+	PACK_PRIORITY_NORMAL,		 // monsters and solid entities
+	PACK_PRIORITY_COSMETIC,		 // everything else that does not collide
+};
+
+typedef struct
+{
+	int serialnumber;
+	byte flags;
+	byte priority;
+	int cluster; // -1 if the entity needs its own visibility check
+} packentity_t;
+
+static packentity_t* g_pPackEntities = NULL;
+static int* g_pPackClusterEnt = NULL;  // representative entity of each cluster
+static int* g_pPackClusterNext = NULL; // hash chain
+static byte* g_pPackClusterVis = NULL; // 0 not tested yet, 1 hidden, 2 visible for g_pPackHost
+static int* g_pPackHash = NULL;
+static int g_iPackMaxEntities = 0;
+static int g_iPackHashSize = 0;
+static int g_iPackClusters = 0;
+static int g_iPackSendable = 0;
+static unsigned int g_ulPackFrame = (unsigned int)-1; // g_ulFrameCount it was built for
+
+static edict_t* g_pPackHost = NULL;
+static unsigned char* g_pPackSet = NULL;
+static Vector g_vecPackOrigin;
+static bool g_fPackCull = false;
+
+static void PackCache_Reset()
+{
+	g_ulPackFrame = g_ulFrameCount - 1;
+	g_pPackHost = NULL;
+}
+
+static void PackCache_Alloc(int maxEntities)
+{
+	delete[] g_pPackEntities;
+	delete[] g_pPackClusterEnt;
+	delete[] g_pPackClusterNext;
+	delete[] g_pPackClusterVis;
+	delete[] g_pPackHash;
+
+	g_iPackHashSize = 256;
+	while (g_iPackHashSize < maxEntities * 2)
+		g_iPackHashSize <<= 1;
+
+	g_iPackMaxEntities = maxEntities;
+	g_pPackEntities = new packentity_t[maxEntities];
+	g_pPackClusterEnt = new int[maxEntities];
+	g_pPackClusterNext = new int[maxEntities];
+	g_pPackClusterVis = new byte[maxEntities];
+	g_pPackHash = new int[g_iPackHashSize];
+}
+
+static int PackCache_Priority(int e, edict_t* ent)
+{
+	if (e <= gpGlobals->maxClients)
+		return PACK_PRIORITY_ESSENTIAL;
+
+	if ((ent->v.flags & FL_CUSTOMENTITY) != 0 || ent->v.aiment || STRING(ent->v.model)[0] == '*')
+		return PACK_PRIORITY_ESSENTIAL;
+
+	if (ent->v.owner)
+	{
+		int owner = ENTINDEX(ent->v.owner);
+
+		if (owner >= 1 && owner <= gpGlobals->maxClients)
+			return PACK_PRIORITY_ESSENTIAL;
+	}
+
+	if ((ent->v.flags & FL_MONSTER) != 0 || ent->v.solid != SOLID_NOT)
+		return PACK_PRIORITY_NORMAL;
+
+	return PACK_PRIORITY_COSMETIC;
+}
+
+static int PackCache_Cluster(edict_t* pEdicts, edict_t* ent)
+{
+	int i, c;
+	unsigned int hash;
+
+	// Entities in too many leafs are tested against the headnode as well
+	if (ent->headnode >= 0)
+		return -1;
+
+	hash = ent->num_leafs;
+	for (i = 0; i < ent->num_leafs; i++)
+		hash = hash * 31 + ent->leafnums[i];
+	hash &= g_iPackHashSize - 1;
+
+	for (c = g_pPackHash[hash]; c != -1; c = g_pPackClusterNext[c])
+	{
+		edict_t* other = pEdicts + g_pPackClusterEnt[c];
+
+		if (other->num_leafs == ent->num_leafs && 0 == memcmp(other->leafnums, ent->leafnums, ent->num_leafs * sizeof(ent->leafnums[0])))
+			return c;
+	}
+
+	c = g_iPackClusters++;
+	g_pPackClusterEnt[c] = ent - pEdicts;
+	g_pPackClusterNext[c] = g_pPackHash[hash];
+	g_pPackHash[hash] = c;
+	return c;
+}
+
+static void PackCache_Build()
+{
+	int e;
+	edict_t* pEdicts = INDEXENT(0);
+
+	if (gpGlobals->maxEntities != g_iPackMaxEntities)
+		PackCache_Alloc(gpGlobals->maxEntities);
+
+	memset(g_pPackHash, -1, g_iPackHashSize * sizeof(g_pPackHash[0]));
+	g_iPackClusters = 0;
+	g_iPackSendable = 0;
+
+	for (e = 0; e < g_iPackMaxEntities; e++)
+	{
+		edict_t* ent = pEdicts + e;
+		packentity_t* pe = &g_pPackEntities[e];
+
+		pe->serialnumber = ent->serialnumber;
+		pe->flags = 0;
+		pe->priority = PACK_PRIORITY_ESSENTIAL;
+		pe->cluster = -1;
+
+		if (0 != ent->free || 0 == ent->v.modelindex || !STRING(ent->v.model))
+		{
+			pe->flags = PACK_NEVER;
+			continue;
+		}
+
+		if ((ent->v.effects & EF_NODRAW) != 0 || (ent->v.flags & FL_SPECTATOR) != 0)
+			pe->flags |= PACK_HOSTONLY;
+		else
+			g_iPackSendable++;
+
+		if ((ent->v.flags & FL_SKIPLOCALHOST) != 0)
+			pe->flags |= PACK_SKIPLOCAL;
+
+		pe->priority = PackCache_Priority(e, ent);
+		pe->cluster = PackCache_Cluster(pEdicts, ent);
+	}
+
+	g_ulPackFrame = g_ulFrameCount;
+}
+
+/*
+================
+PackCache_Entity
+
+Returns the cached state for the entity, or NULL if it has to take the uncached path
+================
+*/
+static const packentity_t* PackCache_Entity(int e, edict_t* ent, edict_t* host)
+{
+	if (host != g_pPackHost || e < 0 || e >= g_iPackMaxEntities)
+		return NULL;
+
+	const packentity_t* pe = &g_pPackEntities[e];
+
+	if (pe->serialnumber != ent->serialnumber)
+		return NULL;
+
+	return pe;
+}
+
+static bool PackCache_Visible(const packentity_t* pe, edict_t* ent, unsigned char* pSet)
+{
+	// The engine reuses the same buffer for every client, so the set only tells us about
+	// changes within one client's pass
+	if (pSet != g_pPackSet)
+	{
+		memset(g_pPackClusterVis, 0, g_iPackClusters);
+		g_pPackSet = pSet;
+	}
+
+	if (pe->cluster < 0)
+		return 0 != ENGINE_CHECK_VISIBILITY((const struct edict_s*)ent, pSet);
+
+	byte* vis = &g_pPackClusterVis[pe->cluster];
+
+	if (0 == *vis)
+		*vis = 0 != ENGINE_CHECK_VISIBILITY((const struct edict_s*)ent, pSet) ? 2 : 1;
+
+	return 2 == *vis;
+}
+
+static bool PackCache_Culled(const packentity_t* pe, edict_t* ent)
+{
+	// players and anything else at priority 0 are never culled, whatever the cvar says
+	if (!g_fPackCull || pe->priority < V_max(1, (int)sv_cull_priority.value))
+		return false;
+
+	Vector center = (ent->v.absmin + ent->v.absmax) * 0.5;
+
+	return (center - g_vecPackOrigin).LengthSquared() > sv_cull_distance.value * sv_cull_distance.value;
+}
+
 /*
 ================
 SetupVisibility
@@ -1051,6 +1292,15 @@ void SetupVisibility(edict_t* pViewEntity, edict_t* pClient, unsigned char** pvs
 		pView = pViewEntity;
 	}
 
+	// First client this frame, classify the entities for AddToFullPack
+	if (g_ulFrameCount != g_ulPackFrame)
+		PackCache_Build();
+
+	g_pPackHost = pClient;
+	g_pPackSet = NULL;
+	memset(g_pPackClusterVis, 0, g_iPackClusters);
+	g_fPackCull = false;
+
 	if ((pClient->v.flags & FL_PROXY) != 0)
 	{
 		*pvs = NULL; // the spectator proxy sees
@@ -1064,6 +1314,10 @@ void SetupVisibility(edict_t* pViewEntity, edict_t* pClient, unsigned char** pvs
 		org = org + (VEC_HULL_MIN - VEC_DUCK_HULL_MIN);
 	}
 
+	// Thin out far away unimportant entities once the frame has more than sv_cull_load of them
+	g_vecPackOrigin = org;
+	g_fPackCull = sv_cull_distance.value > 0 && g_iPackSendable > (int)sv_cull_load.value;
+
 	*pvs = ENGINE_SET_PVS((float*)&org);
 	*pas = ENGINE_SET_PAS((float*)&org);
 }
@@ -1086,38 +1340,66 @@ we could also use the pas/ pvs that we set in SetupVisibility, if we wanted to.
 int AddToFullPack(struct entity_state_s* state, int e, edict_t* ent, edict_t* host, int hostflags, int player, unsigned char* pSet)
 {
 	int i;
+	const packentity_t* pe = PackCache_Entity(e, ent, host);
 
-	// don't send if flagged for NODRAW and it's not the host getting the message
-	if ((ent->v.effects & EF_NODRAW) != 0 &&
-		(ent != host))
-		return 0;
+	if (pe)
+	{
+		// Same tests as below, using the flags worked out for this frame
+		if ((pe->flags & PACK_NEVER) != 0)
+			return 0;
 
-	// Ignore ents without valid / visible models
-	if (0 == ent->v.modelindex || !STRING(ent->v.model))
-		return 0;
+		if (ent != host)
+		{
+			if ((pe->flags & PACK_HOSTONLY) != 0)
+				return 0;
 
-	// Don't send spectators to other players
-	if ((ent->v.flags & FL_SPECTATOR) != 0 && (ent != host))
-	{
-		return 0;
-	}
+			if (!PackCache_Visible(pe, ent, pSet))
+				return 0;
 
-	// Ignore if not the host and not touching a PVS/PAS leaf
-	// If pSet is NULL, then the test will always succeed and the entity will be added to the update
-	if (ent != host)
-	{
-		if (!ENGINE_CHECK_VISIBILITY((const struct edict_s*)ent, pSet))
+			if (PackCache_Culled(pe, ent))
+				return 0;
+		}
+
+		if ((pe->flags & PACK_SKIPLOCAL) != 0)
 		{
-			return 0;
+			if ((hostflags & 1) != 0 && (ent->v.owner == host))
+				return 0;
 		}
 	}
+	else
+	{
+		// don't send if flagged for NODRAW and it's not the host getting the message
+		if ((ent->v.effects & EF_NODRAW) != 0 &&
+			(ent != host))
+			return 0;
 
+		// Ignore ents without valid / visible models
+		if (0 == ent->v.modelindex || !STRING(ent->v.model))
+			return 0;
 
-	// Don't send entity to local client if the client says it's predicting the entity itself.
-	if ((ent->v.flags & FL_SKIPLOCALHOST) != 0)
-	{
-		if ((hostflags & 1) != 0 && (ent->v.owner == host))
+		// Don't send spectators to other players
+		if ((ent->v.flags & FL_SPECTATOR) != 0 && (ent != host))
+		{
 			return 0;
+		}
+
+		// Ignore if not the host and not touching a PVS/PAS leaf
+		// If pSet is NULL, then the test will always succeed and the entity will be added to the update
+		if (ent != host)
+		{
+			if (!ENGINE_CHECK_VISIBILITY((const struct edict_s*)ent, pSet))
+			{
+				return 0;
+			}
+		}
+
+
+		// Don't send entity to local client if the client says it's predicting the entity itself.
+		if ((ent->v.flags & FL_SKIPLOCALHOST) != 0)
+		{
+			if ((hostflags & 1) != 0 && (ent->v.owner == host))
+				return 0;
+		}
 	}
 
 	if (0 != host->v.groupinfo)
@@ -1370,6 +1652,9 @@ void Entity_Encode(struct delta_s* pFields, const unsigned char* from, const uns
 	f = (entity_state_t*)from;
 	t = (entity_state_t*)to;
 
+	if (g_fNetProfActive)
+		NetProf_EntityDelta(f, t, NETPROF_DELTA_ENTITY);
+
 	// Never send origin to local player, it's sent with more resolution in clientdata_t structure
 	const bool localplayer = (t->number - 1) == ENGINE_CURRENT_PLAYER();
 	if (localplayer)
@@ -1440,6 +1725,9 @@ void Player_Encode(struct delta_s* pFields, const unsigned char* from, const uns
 	f = (entity_state_t*)from;
 	t = (entity_state_t*)to;
 
+	if (g_fNetProfActive)
+		NetProf_EntityDelta(f, t, NETPROF_DELTA_PLAYER);
+
 	// Never send origin to local player, it's sent with more resolution in clientdata_t structure
 	const bool localplayer = (t->number - 1) == ENGINE_CURRENT_PLAYER();
 	if (localplayer)
@@ -1523,6 +1811,9 @@ void Custom_Encode(struct delta_s* pFields, const unsigned char* from, const uns
 	f = (entity_state_t*)from;
 	t = (entity_state_t*)to;
 
+	if (g_fNetProfActive)
+		NetProf_EntityDelta(f, t, NETPROF_DELTA_CUSTOM);
+
 	beamType = t->rendermode & 0x0f;
 
 	if (beamType != BEAM_POINTS && beamType != BEAM_ENTPOINT)
@@ -1771,6 +2062,8 @@ void CmdStart(const edict_t* player, const struct usercmd_s* cmd, unsigned int r
 	}
 
 	pl->random_seed = random_seed;
+
+	LagComp_SetClientLerp(pl->edict(), cmd->lerp_msec);
 }
 
 /*
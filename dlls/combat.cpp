@@ -29,13 +29,87 @@
 #include "animation.h"
 #include "weapons.h"
 #include "func_break.h"
+#include "lagcomp.h"
+#include "ailod.h"
+#include "tracecache.h"
+#include "game.h"
 
 extern Vector VecBModelOrigin(entvars_t* pevBModel);
 
+#define RADIUS_DAMAGE_CANDIDATES 256
+
 #define GERMAN_GIB_COUNT 4
 #define HUMAN_GIB_COUNT 6
 #define ALIEN_GIB_COUNT 4
 
+// when fewer edicts than this are left, gibs are culled down to a quarter of sv_maxgibs
+#define GIB_EDICT_RESERVE 100
+
+static CGib* g_pOldestGib;
+static CGib* g_pNewestGib;
+
+CGib::CGib()
+{
+	m_pPrevGib = g_pNewestGib;
+	if (g_pNewestGib)
+		g_pNewestGib->m_pNextGib = this;
+	else
+		g_pOldestGib = this;
+	g_pNewestGib = this;
+
+	m_cGibs++;
+}
+
+CGib::~CGib()
+{
+	if (m_pPrevGib)
+		m_pPrevGib->m_pNextGib = m_pNextGib;
+	else
+		g_pOldestGib = m_pNextGib;
+
+	if (m_pNextGib)
+		m_pNextGib->m_pPrevGib = m_pPrevGib;
+	else
+		g_pNewestGib = m_pPrevGib;
+
+	m_cGibs--;
+}
+
+//=========================================================
+// CullGibs - removes the oldest gibs still in the world
+// until no more than sv_maxgibs are left, or a quarter of
+// that if the edicts are nearly used up. Gibs already
+// removed stay in the list until the engine frees them,
+// so those aren't counted.
+//=========================================================
+void CGib::CullGibs()
+{
+	CGib* pGib;
+	int cLimit = (int)sv_maxgibs.value;
+	int cLive = 0;
+
+	if (NUMBER_OF_ENTITIES() >= gpGlobals->maxEntities - GIB_EDICT_RESERVE)
+		cLimit = cLimit > 0 ? V_max(cLimit / 4, 1) : 32;
+	else if (cLimit <= 0)
+		return;
+
+	for (pGib = g_pOldestGib; pGib; pGib = pGib->m_pNextGib)
+	{
+		if (pGib->pev && (pGib->pev->flags & FL_KILLME) == 0)
+			cLive++;
+	}
+
+	for (pGib = g_pOldestGib; pGib && cLive > cLimit; pGib = pGib->m_pNextGib)
+	{
+		if (!pGib->pev || (pGib->pev->flags & FL_KILLME) != 0)
+			continue;
+
+		UTIL_Remove(pGib);
+		cLive--;
+		m_cCulledGibs++;
+	}
+}
+
 
 // HACKHACK -- The gib velocity equations don't work
 void CGib::LimitVelocity()
@@ -798,6 +872,9 @@ void CGib::Spawn(const char* szGibModel)
 
 	m_material = matNone;
 	m_cBloodDecals = 5; // how many blood decals this gib can place (1 per bounce until none remain).
+
+	// this one's the newest, so it stays
+	CullGibs();
 }
 
 // take health
@@ -894,6 +971,8 @@ bool CBaseMonster::TakeDamage(entvars_t* pevInflictor, entvars_t* pevAttacker, f
 	// do the damage
 	pev->health -= flTake;
 
+	AILOD_Wake(this);
+
 
 	// HACKHACK Don't kill monsters in a script.  Let them break their scripts first
 	if (m_MonsterState == MONSTERSTATE_SCRIPT)
@@ -1029,11 +1108,21 @@ float CBaseMonster::DamageForce(float damage)
 // RadiusDamage - this entity is exploding, or otherwise needs to inflict damage upon entities within a certain range.
 //
 // only damage ents that can clearly be seen by the explosion!
+//
+// The entities in range are gathered in one pass, and taken in the
+// order the engine's sphere search would have found them. Hurting one
+// can spawn another (a breakable's contents, a dropped grenade), so
+// if anything was created the rest of the search goes back to the
+// engine from where the list had got to, as it would have before.
 
 
 void RadiusDamage(Vector vecSrc, entvars_t* pevInflictor, entvars_t* pevAttacker, float flDamage, float flRadius, int iClassIgnore, int bitsDamageType)
 {
+	CTraceCaller traceCaller("RadiusDamage");
 	CBaseEntity* pEntity = NULL;
+	edict_t* pCandidates[RADIUS_DAMAGE_CANDIDATES];
+	edict_t* pentLast = NULL;
+	int cCandidates, iCandidate, iCreated;
 	TraceResult tr;
 	float flAdjustedDamage, falloff;
 	Vector vecSpot;
@@ -1050,9 +1139,39 @@ void RadiusDamage(Vector vecSrc, entvars_t* pevInflictor, entvars_t* pevAttacker
 	if (!pevAttacker)
 		pevAttacker = pevInflictor;
 
+	cCandidates = UTIL_EdictsInSphere(pCandidates, RADIUS_DAMAGE_CANDIDATES, vecSrc, flRadius);
+	iCandidate = 0;
+	iCreated = g_iEntitiesCreated;
+
 	// iterate on all entities in the vicinity.
-	while ((pEntity = UTIL_FindEntityInSphere(pEntity, vecSrc, flRadius)) != NULL)
+	while (true)
 	{
+		if (iCreated == g_iEntitiesCreated && iCandidate < cCandidates)
+		{
+			pentLast = pCandidates[iCandidate++];
+
+			// removed or moved off by one hurt before it
+			if (0 != pentLast->free || 0 == pentLast->v.classname || !UTIL_BoxInSphere(pentLast->v.absmin, pentLast->v.absmax, vecSrc, flRadius))
+				continue;
+		}
+		else if (iCreated == g_iEntitiesCreated && cCandidates < RADIUS_DAMAGE_CANDIDATES)
+		{
+			break;
+		}
+		else
+		{
+			// something was spawned, or there were more than the list holds
+			pentLast = FIND_ENTITY_IN_SPHERE(pentLast, vecSrc, flRadius);
+
+			if (FNullEnt(pentLast))
+				break;
+		}
+
+		pEntity = CBaseEntity::Instance(pentLast);
+
+		if (!pEntity)
+			break;
+
 		if (pEntity->pev->takedamage != DAMAGE_NO)
 		{
 			// UNDONE: this should check a damage mask, not an ignore
@@ -1217,6 +1336,7 @@ bool CBaseMonster::FInViewCone(Vector* pOrigin)
 //=========================================================
 bool CBaseEntity::FVisible(CBaseEntity* pEntity)
 {
+	CTraceCaller traceCaller("FVisible");
 	TraceResult tr;
 	Vector vecLookerOrigin;
 	Vector vecTargetOrigin;
@@ -1249,6 +1369,7 @@ bool CBaseEntity::FVisible(CBaseEntity* pEntity)
 //=========================================================
 bool CBaseEntity::FVisible(const Vector& vecOrigin)
 {
+	CTraceCaller traceCaller("FVisible");
 	TraceResult tr;
 	Vector vecLookerOrigin;
 
@@ -1366,6 +1487,7 @@ This version is used by Monsters.
 */
 void CBaseEntity::FireBullets(unsigned int cShots, Vector vecSrc, Vector vecDirShooting, Vector vecSpread, float flDistance, int iBulletType, int iTracerFreq, int iDamage, entvars_t* pevAttacker)
 {
+	CTraceCaller traceCaller("FireBullets");
 	static int tracerCount;
 	bool tracer;
 	TraceResult tr;
@@ -1510,6 +1632,7 @@ This version is used by Players, uses the random seed generator to sync client a
 */
 Vector CBaseEntity::FireBulletsPlayer(unsigned int cShots, Vector vecSrc, Vector vecDirShooting, Vector vecSpread, float flDistance, int iBulletType, int iTracerFreq, int iDamage, entvars_t* pevAttacker, int shared_rand)
 {
+	CTraceCaller traceCaller("FireBulletsPlayer");
 	static int tracerCount;
 	TraceResult tr;
 	Vector vecRight = gpGlobals->v_right;
@@ -1522,6 +1645,9 @@ Vector CBaseEntity::FireBulletsPlayer(unsigned int cShots, Vector vecSrc, Vector
 	ClearMultiDamage();
 	gMultiDamage.type = DMG_BULLET | DMG_NEVERGIB;
 
+	// Trace against monsters where the shooter saw them
+	const bool rewound = LagComp_Rewind(ENT(pevAttacker), vecSrc, vecDirShooting, vecSpread, flDistance);
+
 	for (unsigned int iShot = 1; iShot <= cShots; iShot++)
 	{
 		//Use player's random seed.
@@ -1586,6 +1712,10 @@ Vector CBaseEntity::FireBulletsPlayer(unsigned int cShots, Vector vecSrc, Vector
 		// make bullet trails
 		UTIL_BubbleTrail(vecSrc, tr.vecEndPos, (flDistance * tr.flFraction) / 64.0);
 	}
+
+	if (rewound)
+		LagComp_Restore();
+
 	ApplyMultiDamage(pev, pevAttacker);
 
 	return Vector(x * vecSpread.x, y * vecSpread.y, 0.0);
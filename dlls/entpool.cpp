@@ -0,0 +1,160 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// entpool.cpp - recycled entity memory
+//
+// Blocks are rounded up to ENTPOOL_GRANULARITY and filed
+// by that size, so any entity class of a size can take a
+// block another one freed. A freed block holds the link
+// to the next free one of its size. Entities bigger than
+// ENTPOOL_MAX_SIZE, and anything freed once the pool is
+// holding ENTPOOL_MAX_BYTES, go straight to the allocator.
+//
+// The edicts themselves belong to the engine and can't be
+// kept back; CGib::CullGibs keeps gibs from using them up.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "monsters.h"
+#include "game.h"
+#include "entpool.h"
+
+#define ENTPOOL_GRANULARITY 16
+#define ENTPOOL_MAX_SIZE 4096
+#define ENTPOOL_SIZES (ENTPOOL_MAX_SIZE / ENTPOOL_GRANULARITY)
+#define ENTPOOL_MAX_BYTES (1024 * 1024)
+
+typedef struct freeblock_s
+{
+	struct freeblock_s* pNext;
+} freeblock_t;
+
+typedef struct
+{
+	freeblock_t* pFree;
+	int cFree;
+	int allocs;
+	int reused;
+} entpoolsize_t;
+
+static entpoolsize_t g_EntPool[ENTPOOL_SIZES];
+static int g_cEntPoolBytes; // held in the free lists
+static int g_cEntPoolReleased;
+
+static int EntPool_Size(size_t size)
+{
+	return (int)((size + ENTPOOL_GRANULARITY - 1) / ENTPOOL_GRANULARITY);
+}
+
+//=========================================================
+// EntPool_Alloc
+//=========================================================
+void* EntPool_Alloc(size_t size)
+{
+	const int iSize = EntPool_Size(size);
+
+	if (iSize < 1 || iSize > ENTPOOL_SIZES)
+		return ::operator new(size);
+
+	entpoolsize_t* pPool = &g_EntPool[iSize - 1];
+
+	pPool->allocs++;
+
+	if (!pPool->pFree)
+		return ::operator new(iSize * ENTPOOL_GRANULARITY);
+
+	freeblock_t* pBlock = pPool->pFree;
+
+	pPool->pFree = pBlock->pNext;
+	pPool->cFree--;
+	pPool->reused++;
+	g_cEntPoolBytes -= iSize * ENTPOOL_GRANULARITY;
+
+	return pBlock;
+}
+
+//=========================================================
+// EntPool_Free - size has to be the one it was allocated
+// with, which the sized operator delete gets from the
+// virtual destructor.
+//=========================================================
+void EntPool_Free(void* pMem, size_t size)
+{
+	const int iSize = EntPool_Size(size);
+
+	if (!pMem)
+		return;
+
+	if (iSize < 1 || iSize > ENTPOOL_SIZES || g_cEntPoolBytes + iSize * ENTPOOL_GRANULARITY > ENTPOOL_MAX_BYTES)
+	{
+		g_cEntPoolReleased++;
+		::operator delete(pMem);
+		return;
+	}
+
+	entpoolsize_t* pPool = &g_EntPool[iSize - 1];
+	freeblock_t* pBlock = (freeblock_t*)pMem;
+
+	pBlock->pNext = pPool->pFree;
+	pPool->pFree = pBlock;
+	pPool->cFree++;
+	g_cEntPoolBytes += iSize * ENTPOOL_GRANULARITY;
+}
+
+//=========================================================
+// EntPool_Stats - "entpool_stats [reset]" server command.
+//=========================================================
+static void EntPool_Stats()
+{
+	int i;
+	int allocs = 0, reused = 0;
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("entpool_stats: %d bytes held, %d blocks released to the allocator\n", g_cEntPoolBytes, g_cEntPoolReleased));
+	g_engfuncs.pfnServerPrint("   size   allocs   reused     free\n");
+
+	for (i = 0; i < ENTPOOL_SIZES; i++)
+	{
+		const entpoolsize_t* p = &g_EntPool[i];
+
+		if (0 == p->allocs && 0 == p->cFree)
+			continue;
+
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %5d %8d %8d %8d\n", (i + 1) * ENTPOOL_GRANULARITY, p->allocs, p->reused, p->cFree));
+		allocs += p->allocs;
+		reused += p->reused;
+	}
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  total %8d %8d (%.1f%%)\n", allocs, reused, 0 != allocs ? 100.0f * reused / allocs : 0.0f));
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  gibs: %d in the world, sv_maxgibs %g, %d culled\n", CGib::m_cGibs, sv_maxgibs.value, CGib::m_cCulledGibs));
+
+	if (CMD_ARGC() > 1 && 0 == stricmp(CMD_ARGV(1), "reset"))
+	{
+		for (i = 0; i < ENTPOOL_SIZES; i++)
+		{
+			g_EntPool[i].allocs = 0;
+			g_EntPool[i].reused = 0;
+		}
+
+		g_cEntPoolReleased = 0;
+		CGib::m_cCulledGibs = 0;
+	}
+}
+
+void EntPool_Init()
+{
+	g_engfuncs.pfnAddServerCommand("entpool_stats", EntPool_Stats);
+}
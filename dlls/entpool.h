@@ -0,0 +1,30 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+
+#pragma once
+
+//=========================================================
+// entpool.h - freed entities' memory kept for the next
+// entity of the same size, so the gibs, grenades, sprites
+// and beams that come and go all through a fight don't go
+// back to the allocator every time.
+//=========================================================
+
+void EntPool_Init();
+
+// what CBaseEntity's operator new and delete use
+void* EntPool_Alloc(size_t size);
+void EntPool_Free(void* pMem, size_t size);
@@ -15,7 +15,16 @@
 #include "extdll.h"
 #include "eiface.h"
 #include "util.h"
+#include "cbase.h"
 #include "game.h"
+#include "soundent.h"
+#include "hudqueue.h"
+#include "netprof.h"
+#include "lagcomp.h"
+#include "ailod.h"
+#include "movecache.h"
+#include "tracecache.h"
+#include "schedprof.h"
 #include "filesystem_utils.h"
 
 cvar_t displaysoundlist = {"displaysoundlist", "0"};
@@ -44,6 +53,46 @@ cvar_t allow_spectators = {"allow_spectators", "0.0", FCVAR_SERVER}; // 0 preven
 
 cvar_t mp_chattime = {"mp_chattime", "10", FCVAR_SERVER};
 
+// AddToFullPack distance culling, see client.cpp
+cvar_t sv_cull_distance = {"sv_cull_distance", "0"}; // 0 disables culling
+cvar_t sv_cull_priority = {"sv_cull_priority", "2"}; // lowest priority that may be culled, 1 monsters, 2 cosmetic
+cvar_t sv_cull_load = {"sv_cull_load", "0"};		  // only cull once more than this many entities are sendable
+
+cvar_t sv_hudbudget = {"sv_hudbudget", "1024"}; // HUD message bytes per client per frame, 0 is unlimited
+
+// Network profiler, see netprof.cpp
+cvar_t netprof = {"netprof", "0"};
+cvar_t netprof_window = {"netprof_window", "10"}; // seconds per window
+cvar_t netprof_csv = {"netprof_csv", "0"};		  // append each window to netprof.csv
+
+// Rewind monsters for player hitscan in multiplayer, see lagcomp.cpp
+cvar_t sv_unlag_monsters = {"sv_unlag_monsters", "1"};
+
+// AI level of detail, see ailod.cpp
+cvar_t ai_lod = {"ai_lod", "1"};
+cvar_t ai_lod_near = {"ai_lod_near", "1024"}; // closer than this to a player and in its PVS is full rate
+cvar_t ai_lod_far = {"ai_lod_far", "3072"};
+cvar_t ai_budget = {"ai_budget", "0"}; // milliseconds of AI per frame before far monsters wait, 0 is unlimited
+
+// CheckLocalMove results cache and coarse steps, see movecache.cpp
+cvar_t ai_movecache = {"ai_movecache", "1"};
+cvar_t ai_movesparse = {"ai_movesparse", "1"};
+
+// Node path repair and node pair moves for RouteSimplify, see routecache.cpp
+cvar_t ai_routerepair = {"ai_routerepair", "1"};
+
+// Classname and targetname lookups through an index, see nameindex.cpp
+cvar_t sv_nameindex = {"sv_nameindex", "1"};
+
+// Reuse identical traces within a frame, see tracecache.cpp
+cvar_t sv_tracecache = {"sv_tracecache", "0"};
+
+// Most gibs in the world at once, see CGib::CullGibs
+cvar_t sv_maxgibs = {"sv_maxgibs", "128"};
+
+// Schedule and task profiling, see schedprof.cpp
+cvar_t ai_schedprof = {"ai_schedprof", "0"};
+
 //CVARS FOR SKILL LEVEL SETTINGS
 // Agrunt
 cvar_t sk_agrunt_health1 = {"sk_agrunt_health1", "0"};
@@ -470,6 +519,7 @@ void GameDLLInit()
 	}
 
 	CVAR_REGISTER(&displaysoundlist);
+	g_engfuncs.pfnAddServerCommand("soundent_stats", SoundEnt_Stats);
 	CVAR_REGISTER(&allow_spectators);
 
 	CVAR_REGISTER(&teamplay);
@@ -493,6 +543,46 @@ void GameDLLInit()
 
 	CVAR_REGISTER(&mp_chattime);
 
+	CVAR_REGISTER(&sv_cull_distance);
+	CVAR_REGISTER(&sv_cull_priority);
+	CVAR_REGISTER(&sv_cull_load);
+
+	CVAR_REGISTER(&sv_hudbudget);
+	g_engfuncs.pfnAddServerCommand("hudqueue_stats", HudQueue_Stats);
+
+	CVAR_REGISTER(&netprof);
+	CVAR_REGISTER(&netprof_window);
+	CVAR_REGISTER(&netprof_csv);
+	NetProf_Init();
+
+	CVAR_REGISTER(&sv_unlag_monsters);
+	LagComp_Init();
+
+	CVAR_REGISTER(&ai_lod);
+	CVAR_REGISTER(&ai_lod_near);
+	CVAR_REGISTER(&ai_lod_far);
+	CVAR_REGISTER(&ai_budget);
+	AILOD_Init();
+
+	CVAR_REGISTER(&ai_movecache);
+	CVAR_REGISTER(&ai_movesparse);
+	MoveCache_Init();
+
+	CVAR_REGISTER(&ai_routerepair);
+	RouteCache_Init();
+
+	CVAR_REGISTER(&sv_nameindex);
+	NameIndex_Init();
+
+	CVAR_REGISTER(&sv_tracecache);
+	TraceCache_Init();
+
+	CVAR_REGISTER(&sv_maxgibs);
+	EntPool_Init();
+
+	CVAR_REGISTER(&ai_schedprof);
+	SchedProf_Init();
+
 	// REGISTER CVARS FOR SKILL LEVEL STUFF
 	// Agrunt
 	CVAR_REGISTER(&sk_agrunt_health1); // {"sk_agrunt_health1","0"};
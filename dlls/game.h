@@ -41,6 +41,28 @@ extern cvar_t allowmonsters;
 extern cvar_t allow_spectators;
 extern cvar_t mp_chattime;
 
+extern cvar_t sv_cull_distance;
+extern cvar_t sv_cull_priority;
+extern cvar_t sv_cull_load;
+
+extern cvar_t sv_hudbudget;
+
+extern cvar_t netprof;
+extern cvar_t netprof_window;
+extern cvar_t netprof_csv;
+extern cvar_t sv_unlag_monsters;
+extern cvar_t ai_lod;
+extern cvar_t ai_lod_near;
+extern cvar_t ai_lod_far;
+extern cvar_t ai_budget;
+extern cvar_t ai_movecache;
+extern cvar_t ai_movesparse;
+extern cvar_t ai_routerepair;
+extern cvar_t sv_nameindex;
+extern cvar_t sv_tracecache;
+extern cvar_t sv_maxgibs;
+extern cvar_t ai_schedprof;
+
 // Engine Cvars
 inline cvar_t* g_psv_gravity;
 inline cvar_t* g_psv_aim;
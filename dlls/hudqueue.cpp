@@ -0,0 +1,249 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// hudqueue.cpp - budgeted, coalescing HUD message queue
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "hudqueue.h"
+
+#define HUDMSG_SENT -1 // priority of a message that went out during a flush
+
+// Message id and length byte
+#define HUDMSG_HEADER_SIZE 2
+
+//=========================================================
+// Begin - starts building a message, finished by End
+//=========================================================
+void CHudMessageQueue::Begin(entvars_t* pev, int msgType, int key, int priority)
+{
+	m_pev = pev;
+
+	m_Building.msgType = msgType;
+	m_Building.key = key;
+	m_Building.priority = priority;
+	m_Building.size = HUDMSG_HEADER_SIZE;
+	m_Building.numArgs = 0;
+}
+
+CHudMessageQueue::hudarg_t* CHudMessageQueue::AddArg(int type, int size)
+{
+	if (m_Building.numArgs >= MAX_HUDQUEUE_ARGS)
+	{
+		ALERT(at_error, "CHudMessageQueue: too many arguments for message %d\n", m_Building.msgType);
+		return NULL;
+	}
+
+	hudarg_t* pArg = &m_Building.args[m_Building.numArgs++];
+	pArg->type = type;
+	m_Building.size += size;
+	return pArg;
+}
+
+void CHudMessageQueue::WriteByte(int iValue)
+{
+	hudarg_t* pArg = AddArg(ARG_BYTE, 1);
+
+	if (pArg)
+		pArg->iValue = iValue;
+}
+
+void CHudMessageQueue::WriteShort(int iValue)
+{
+	hudarg_t* pArg = AddArg(ARG_SHORT, 2);
+
+	if (pArg)
+		pArg->iValue = iValue;
+}
+
+void CHudMessageQueue::WriteLong(int iValue)
+{
+	hudarg_t* pArg = AddArg(ARG_LONG, 4);
+
+	if (pArg)
+		pArg->iValue = iValue;
+}
+
+void CHudMessageQueue::WriteCoord(float flValue)
+{
+	hudarg_t* pArg = AddArg(ARG_COORD, 2);
+
+	if (pArg)
+		pArg->flValue = flValue;
+}
+
+void CHudMessageQueue::WriteString(const char* pszValue)
+{
+	hudarg_t* pArg = AddArg(ARG_STRING, strlen(pszValue) + 1);
+
+	if (pArg)
+		pArg->pszValue = pszValue;
+}
+
+//=========================================================
+// End - queues the message, dropping any queued message
+// with the same key since this one carries the newer value
+//=========================================================
+void CHudMessageQueue::End()
+{
+	int i;
+
+	if (m_Building.priority == HUDMSG_IMMEDIATE)
+	{
+		// Everything queued so far has to arrive first
+		Flush(0);
+		Send(&m_Building);
+		return;
+	}
+
+	if (m_Building.key != HUDQUEUE_NOKEY)
+	{
+		for (i = 0; i < m_iCount; i++)
+		{
+			if (m_Messages[i].key == m_Building.key)
+			{
+				m_iBytesSaved += m_Messages[i].size;
+				memmove(&m_Messages[i], &m_Messages[i + 1], (m_iCount - i - 1) * sizeof(hudmessage_t));
+				m_iCount--;
+				break;
+			}
+		}
+	}
+
+	if (m_iCount == MAX_HUDQUEUE_MESSAGES)
+	{
+		// Out of room, the oldest message goes out now
+		Send(&m_Messages[0]);
+		memmove(&m_Messages[0], &m_Messages[1], (m_iCount - 1) * sizeof(hudmessage_t));
+		m_iCount--;
+	}
+
+	m_Messages[m_iCount++] = m_Building;
+}
+
+void CHudMessageQueue::Send(const hudmessage_t* pMsg)
+{
+	int i;
+
+	MESSAGE_BEGIN(MSG_ONE, pMsg->msgType, NULL, m_pev);
+	for (i = 0; i < pMsg->numArgs; i++)
+	{
+		const hudarg_t* pArg = &pMsg->args[i];
+
+		switch (pArg->type)
+		{
+		case ARG_BYTE:
+			WRITE_BYTE(pArg->iValue);
+			break;
+		case ARG_SHORT:
+			WRITE_SHORT(pArg->iValue);
+			break;
+		case ARG_LONG:
+			WRITE_LONG(pArg->iValue);
+			break;
+		case ARG_COORD:
+			WRITE_COORD(pArg->flValue);
+			break;
+		case ARG_STRING:
+			WRITE_STRING(pArg->pszValue);
+			break;
+		}
+	}
+	MESSAGE_END();
+
+	m_iBytesSent += pMsg->size;
+}
+
+//=========================================================
+// Flush - sends queued messages, highest priority first,
+// until budget bytes have been written. A budget of 0
+// sends everything.
+//=========================================================
+void CHudMessageQueue::Flush(int budget)
+{
+	int i, priority, count;
+	int sent = 0;
+	bool full = false;
+
+	for (priority = HUDMSG_CONTROL; priority < HUDMSG_PRIORITIES && !full; priority++)
+	{
+		for (i = 0; i < m_iCount; i++)
+		{
+			hudmessage_t* pMsg = &m_Messages[i];
+
+			if (pMsg->priority != priority)
+				continue;
+
+			// Always let one message through so a tiny budget can't stall the queue
+			if (budget > 0 && sent > 0 && sent + pMsg->size > budget)
+			{
+				full = true;
+				break;
+			}
+
+			Send(pMsg);
+			sent += pMsg->size;
+			pMsg->priority = HUDMSG_SENT;
+		}
+	}
+
+	count = 0;
+	for (i = 0; i < m_iCount; i++)
+	{
+		if (m_Messages[i].priority == HUDMSG_SENT)
+			continue;
+
+		if (count != i)
+			m_Messages[count] = m_Messages[i];
+		count++;
+	}
+
+	m_iCount = count;
+	m_iDeferred += count;
+}
+
+void CHudMessageQueue::Clear()
+{
+	m_iCount = 0;
+	m_iBytesSent = 0;
+	m_iBytesSaved = 0;
+	m_iDeferred = 0;
+}
+
+//=========================================================
+// HudQueue_Stats - "hudqueue_stats" server command
+//=========================================================
+void HudQueue_Stats()
+{
+	int i;
+
+	g_engfuncs.pfnServerPrint("  # name                     sent    saved deferred queued\n");
+
+	for (i = 1; i <= gpGlobals->maxClients; i++)
+	{
+		CBasePlayer* pPlayer = (CBasePlayer*)UTIL_PlayerByIndex(i);
+
+		if (!pPlayer)
+			continue;
+
+		const CHudMessageQueue& queue = pPlayer->m_HudQueue;
+
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("%3d %-20.20s %8d %8d %8d %6d\n", i, STRING(pPlayer->pev->netname),
+			queue.m_iBytesSent, queue.m_iBytesSaved, queue.m_iDeferred, queue.QueuedMessages()));
+	}
+}
@@ -0,0 +1,108 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+//=========================================================
+// hudqueue.h - per player queue for the HUD state messages
+// sent from UpdateClientData. Messages with the same key
+// replace each other, so only the last value goes out, and
+// each frame only sv_hudbudget bytes are written, highest
+// priority first.
+//=========================================================
+
+#define MAX_HUDQUEUE_MESSAGES 128
+#define MAX_HUDQUEUE_ARGS 10
+
+#define HUDQUEUE_NOKEY -1 // never replaced by a later message, used for events like damage
+
+// Messages in different classes must not depend on each other's order.
+// Within a class they go out in the order they were queued.
+enum hudpriority_e
+{
+	HUDMSG_IMMEDIATE = 0, // sends everything queued, then this message, ignoring the budget
+	HUDMSG_CONTROL,		  // hud visibility and fov
+	HUDMSG_VITAL,		  // health, armor, damage, flashlight and train
+	HUDMSG_WEAPONS,		  // weapon list, weapon bits, ammo and current weapon
+	HUDMSG_PRIORITIES
+};
+
+class CHudMessageQueue
+{
+public:
+	// Key should be unique per message type and slot, see HudMessageKey
+	void Begin(entvars_t* pev, int msgType, int key, int priority);
+	void WriteByte(int iValue);
+	void WriteShort(int iValue);
+	void WriteLong(int iValue);
+	void WriteCoord(float flValue);
+	void WriteString(const char* pszValue); // must stay valid until the message is sent
+	void End();
+
+	void Flush(int budget);
+	void Clear();
+
+	int QueuedMessages() const { return m_iCount; }
+
+	int m_iBytesSent;  // bytes written to the client
+	int m_iBytesSaved; // bytes of messages that were replaced before they were sent
+	int m_iDeferred;   // message frames spent waiting for budget
+
+private:
+	enum
+	{
+		ARG_BYTE,
+		ARG_SHORT,
+		ARG_LONG,
+		ARG_COORD,
+		ARG_STRING,
+	};
+
+	typedef struct
+	{
+		int type;
+		union
+		{
+			int iValue;
+			float flValue;
+			const char* pszValue;
+		};
+	} hudarg_t;
+
+	typedef struct
+	{
+		int msgType;
+		int key;
+		int priority;
+		int size;
+		int numArgs;
+		hudarg_t args[MAX_HUDQUEUE_ARGS];
+	} hudmessage_t;
+
+	hudarg_t* AddArg(int type, int size);
+	void Send(const hudmessage_t* pMsg);
+
+	entvars_t* m_pev;
+	hudmessage_t m_Building;
+	hudmessage_t m_Messages[MAX_HUDQUEUE_MESSAGES];
+	int m_iCount;
+};
+
+inline int HudMessageKey(int msgType, int slot = 0)
+{
+	return (msgType << 8) | (slot & 0xFF);
+}
+
+void HudQueue_Stats();
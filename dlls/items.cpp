@@ -79,6 +79,7 @@ void CWorldItem::Spawn()
 	{
 		pEntity->pev->target = pev->target;
 		pEntity->pev->targetname = pev->targetname;
+		NameIndex_Changed();
 		pEntity->pev->spawnflags = pev->spawnflags;
 	}
 
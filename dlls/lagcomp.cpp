@@ -0,0 +1,484 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// lagcomp.cpp - monster lag compensation
+//
+// Every frame the state of each solid monster is written to
+// a ring of LAGCOMP_HISTORY frames. Each monster owns a
+// column for as long as it lives, and a frame stores each
+// field as its own array over the columns, so a rewind only
+// walks the arrays it needs.
+//
+// A rewind picks the two frames around the time the
+// shooter saw, skips monsters that the shot can't reach,
+// and moves the rest to the interpolated origin, angles and
+// animation frame so the studio hitbox trace matches the
+// client's view.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "gamerules.h"
+#include "game.h"
+#include "weapons.h"
+#include "cdll_dll.h"
+#include "perf_counter.h"
+#include "lagcomp.h"
+
+#define LAGCOMP_EMPTY -1 // serial of an unused column
+
+typedef struct
+{
+	float time;
+	int serial[LAGCOMP_MAX_ENTITIES];
+	float origin[3][LAGCOMP_MAX_ENTITIES];
+	float angles[3][LAGCOMP_MAX_ENTITIES];
+	float mins[3][LAGCOMP_MAX_ENTITIES];
+	float maxs[3][LAGCOMP_MAX_ENTITIES];
+	float frame[LAGCOMP_MAX_ENTITIES];
+	int sequence[LAGCOMP_MAX_ENTITIES];
+} lagframe_t;
+
+// What a rewind changed, so it can be put back
+typedef struct
+{
+	int entity;
+	int serial;
+	Vector origin, rewoundOrigin;
+	Vector angles, rewoundAngles;
+	Vector mins, maxs, rewoundMins, rewoundMaxs;
+	float frame, rewoundFrame;
+	int sequence, rewoundSequence;
+} lagrestore_t;
+
+static lagframe_t g_LagFrames[LAGCOMP_HISTORY];
+static int g_iLagNewest = -1; // most recent frame
+static int g_iLagFrames = 0;  // valid frames in the ring
+static float g_flLagLastTime = -1;
+
+static int g_LagColumnEntity[LAGCOMP_MAX_ENTITIES]; // edict index, 0 if free
+static int g_LagColumnSerial[LAGCOMP_MAX_ENTITIES];
+static short* g_pLagColumn = NULL; // column of each edict, -1 if none
+static int g_iLagMaxEntities = 0;
+
+static lagrestore_t g_LagRestore[LAGCOMP_MAX_ENTITIES];
+static int g_iLagRestore = 0;
+static bool g_fLagRewound = false;
+
+static int g_LagClientLerp[MAX_PLAYERS + 1]; // client interpolation in msec
+
+static cvar_t* g_psv_maxunlag;
+
+static bool LagComp_Tracked(edict_t* ent)
+{
+	if (0 != ent->free || NULL == ent->pvPrivateData)
+		return false;
+
+	if ((ent->v.flags & FL_MONSTER) == 0 || (ent->v.flags & FL_CLIENT) != 0)
+		return false;
+
+	return ent->v.solid != SOLID_NOT && 0 != ent->v.modelindex;
+}
+
+void LagComp_Reset()
+{
+	int i;
+
+	g_iLagNewest = -1;
+	g_iLagFrames = 0;
+	g_flLagLastTime = -1;
+	g_iLagRestore = 0;
+	g_fLagRewound = false;
+
+	for (i = 0; i < LAGCOMP_MAX_ENTITIES; i++)
+		g_LagColumnEntity[i] = 0;
+
+	if (g_pLagColumn)
+		memset(g_pLagColumn, -1, g_iLagMaxEntities * sizeof(g_pLagColumn[0]));
+}
+
+static void LagComp_FreeColumn(int e)
+{
+	g_LagColumnEntity[g_pLagColumn[e]] = 0;
+	g_pLagColumn[e] = -1;
+}
+
+static int LagComp_AllocColumn(int e, int serial)
+{
+	int c;
+
+	for (c = 0; c < LAGCOMP_MAX_ENTITIES; c++)
+	{
+		if (0 == g_LagColumnEntity[c])
+		{
+			g_LagColumnEntity[c] = e;
+			g_LagColumnSerial[c] = serial;
+			g_pLagColumn[e] = c;
+			return c;
+		}
+	}
+
+	return -1;
+}
+
+//=========================================================
+// LagComp_Record - stores the state clients were sent at
+// the end of the last frame
+//=========================================================
+void LagComp_Record()
+{
+	int e, c;
+
+	if (gpGlobals->maxEntities != g_iLagMaxEntities)
+	{
+		delete[] g_pLagColumn;
+		g_iLagMaxEntities = gpGlobals->maxEntities;
+		g_pLagColumn = new short[g_iLagMaxEntities];
+		LagComp_Reset();
+	}
+
+	// The previous frame's entities carry the previous frame's time
+	const float time = g_flLagLastTime;
+	g_flLagLastTime = gpGlobals->time;
+
+	if (time < 0 || (g_iLagFrames > 0 && time <= g_LagFrames[g_iLagNewest].time))
+		return;
+
+	g_iLagNewest = (g_iLagNewest + 1) % LAGCOMP_HISTORY;
+	if (g_iLagFrames < LAGCOMP_HISTORY)
+		g_iLagFrames++;
+
+	lagframe_t* f = &g_LagFrames[g_iLagNewest];
+	f->time = time;
+	memset(f->serial, LAGCOMP_EMPTY, sizeof(f->serial));
+
+	edict_t* pEdicts = INDEXENT(0);
+
+	for (e = gpGlobals->maxClients + 1; e < g_iLagMaxEntities; e++)
+	{
+		edict_t* ent = pEdicts + e;
+
+		c = g_pLagColumn[e];
+
+		if (!LagComp_Tracked(ent))
+		{
+			if (c >= 0)
+				LagComp_FreeColumn(e);
+			continue;
+		}
+
+		// A new entity in a reused edict starts without history
+		if (c >= 0 && g_LagColumnSerial[c] != ent->serialnumber)
+		{
+			LagComp_FreeColumn(e);
+			c = -1;
+		}
+
+		if (c < 0)
+		{
+			c = LagComp_AllocColumn(e, ent->serialnumber);
+			if (c < 0)
+				continue;
+		}
+
+		f->serial[c] = ent->serialnumber;
+		f->origin[0][c] = ent->v.origin.x;
+		f->origin[1][c] = ent->v.origin.y;
+		f->origin[2][c] = ent->v.origin.z;
+		f->angles[0][c] = ent->v.angles.x;
+		f->angles[1][c] = ent->v.angles.y;
+		f->angles[2][c] = ent->v.angles.z;
+		f->mins[0][c] = ent->v.mins.x;
+		f->mins[1][c] = ent->v.mins.y;
+		f->mins[2][c] = ent->v.mins.z;
+		f->maxs[0][c] = ent->v.maxs.x;
+		f->maxs[1][c] = ent->v.maxs.y;
+		f->maxs[2][c] = ent->v.maxs.z;
+		f->frame[c] = ent->v.frame;
+		f->sequence[c] = ent->v.sequence;
+	}
+}
+
+void LagComp_SetClientLerp(edict_t* pClient, int lerp_msec)
+{
+	int index = ENTINDEX(pClient);
+
+	if (index >= 1 && index <= MAX_PLAYERS)
+		g_LagClientLerp[index] = lerp_msec;
+}
+
+static float LagComp_LerpAngle(float from, float to, float frac)
+{
+	float delta = to - from;
+
+	if (delta > 180)
+		delta -= 360;
+	else if (delta < -180)
+		delta += 360;
+
+	return from + delta * frac;
+}
+
+// Conservative test of the box against the segment, grown by how far the spread can push a pellet
+static bool LagComp_ShotCanHit(const Vector& absmin, const Vector& absmax, const Vector& vecSrc, const Vector& vecDir, float flDistance, float flSlop)
+{
+	float enter = 0, leave = flDistance;
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		const float lo = absmin[i] - flSlop;
+		const float hi = absmax[i] + flSlop;
+
+		if (fabs(vecDir[i]) < 1e-6)
+		{
+			if (vecSrc[i] < lo || vecSrc[i] > hi)
+				return false;
+			continue;
+		}
+
+		float t1 = (lo - vecSrc[i]) / vecDir[i];
+		float t2 = (hi - vecSrc[i]) / vecDir[i];
+		if (t1 > t2)
+		{
+			float t = t1;
+			t1 = t2;
+			t2 = t;
+		}
+
+		enter = V_max(enter, t1);
+		leave = V_min(leave, t2);
+		if (enter > leave)
+			return false;
+	}
+
+	return true;
+}
+
+//=========================================================
+// LagComp_Rewind
+//=========================================================
+bool LagComp_Rewind(edict_t* pShooter, const Vector& vecSrc, const Vector& vecDir, const Vector& vecSpread, float flDistance)
+{
+	int c, i, ping, loss;
+
+	if (g_fLagRewound || g_iLagFrames < 2 || 0 == sv_unlag_monsters.value || !g_pGameRules->IsMultiplayer())
+		return false;
+
+	const int index = ENTINDEX(pShooter);
+	if (index < 1 || index > MAX_PLAYERS || (pShooter->v.flags & FL_FAKECLIENT) != 0)
+		return false;
+
+	g_engfuncs.pfnGetPlayerStats(pShooter, &ping, &loss);
+
+	float latency = ping / 1000.0 + g_LagClientLerp[index] / 1000.0;
+	const float maxunlag = g_psv_maxunlag ? g_psv_maxunlag->value : 0.5;
+	latency = V_min(latency, maxunlag);
+
+	const float target = gpGlobals->time - latency;
+
+	// Find the frames around the target time, newest first
+	const lagframe_t* newer = &g_LagFrames[g_iLagNewest];
+	const lagframe_t* older = newer;
+
+	if (target >= newer->time)
+		return false;
+
+	for (i = 1; i < g_iLagFrames; i++)
+	{
+		older = &g_LagFrames[(g_iLagNewest - i + LAGCOMP_HISTORY) % LAGCOMP_HISTORY];
+		if (older->time <= target)
+			break;
+		newer = older;
+	}
+
+	float frac = 0;
+	if (newer != older && newer->time > older->time)
+		frac = clamp((target - older->time) / (newer->time - older->time), 0.0f, 1.0f);
+
+	const float flSlop = (fabs(vecSpread.x) + fabs(vecSpread.y)) * flDistance;
+	const lagframe_t* nearest = frac >= 0.5 ? newer : older;
+	edict_t* pEdicts = INDEXENT(0);
+
+	g_iLagRestore = 0;
+
+	for (c = 0; c < LAGCOMP_MAX_ENTITIES; c++)
+	{
+		const int e = g_LagColumnEntity[c];
+
+		if (0 == e)
+			continue;
+
+		const int serial = g_LagColumnSerial[c];
+		if (older->serial[c] != serial || newer->serial[c] != serial)
+			continue;
+
+		edict_t* ent = pEdicts + e;
+		if (!LagComp_Tracked(ent) || ent->serialnumber != serial)
+			continue;
+
+		Vector origin, angles, mins, maxs;
+
+		for (i = 0; i < 3; i++)
+		{
+			origin[i] = older->origin[i][c] + (newer->origin[i][c] - older->origin[i][c]) * frac;
+			angles[i] = LagComp_LerpAngle(older->angles[i][c], newer->angles[i][c], frac);
+			mins[i] = nearest->mins[i][c];
+			maxs[i] = nearest->maxs[i][c];
+		}
+
+		// Only blend frames within one sequence, and not across a loop
+		float frame = nearest->frame[c];
+		const int sequence = nearest->sequence[c];
+		if (older->sequence[c] == newer->sequence[c] && fabs(newer->frame[c] - older->frame[c]) < 128)
+			frame = older->frame[c] + (newer->frame[c] - older->frame[c]) * frac;
+
+		if (origin == ent->v.origin && angles == ent->v.angles && frame == ent->v.frame && sequence == ent->v.sequence)
+			continue;
+
+		// Either position has to be reachable by the shot
+		const Vector absmin(V_min(ent->v.absmin.x, origin.x + mins.x), V_min(ent->v.absmin.y, origin.y + mins.y), V_min(ent->v.absmin.z, origin.z + mins.z));
+		const Vector absmax(V_max(ent->v.absmax.x, origin.x + maxs.x), V_max(ent->v.absmax.y, origin.y + maxs.y), V_max(ent->v.absmax.z, origin.z + maxs.z));
+
+		if (!LagComp_ShotCanHit(absmin, absmax, vecSrc, vecDir, flDistance, flSlop))
+			continue;
+
+		lagrestore_t* r = &g_LagRestore[g_iLagRestore++];
+		r->entity = e;
+		r->serial = serial;
+		r->origin = ent->v.origin;
+		r->angles = ent->v.angles;
+		r->mins = ent->v.mins;
+		r->maxs = ent->v.maxs;
+		r->frame = ent->v.frame;
+		r->sequence = ent->v.sequence;
+		r->rewoundOrigin = origin;
+		r->rewoundAngles = angles;
+		r->rewoundMins = mins;
+		r->rewoundMaxs = maxs;
+		r->rewoundFrame = frame;
+		r->rewoundSequence = sequence;
+
+		ent->v.angles = angles;
+		ent->v.frame = frame;
+		ent->v.sequence = sequence;
+		if (mins != ent->v.mins || maxs != ent->v.maxs)
+			UTIL_SetSize(&ent->v, mins, maxs);
+		UTIL_SetOrigin(&ent->v, origin);
+	}
+
+	g_fLagRewound = g_iLagRestore > 0;
+	return g_fLagRewound;
+}
+
+//=========================================================
+// LagComp_Restore - puts back whatever the shot's damage
+// didn't change in the meantime
+//=========================================================
+void LagComp_Restore()
+{
+	int i;
+	edict_t* pEdicts = INDEXENT(0);
+
+	for (i = 0; i < g_iLagRestore; i++)
+	{
+		const lagrestore_t* r = &g_LagRestore[i];
+		edict_t* ent = pEdicts + r->entity;
+
+		if (0 != ent->free || ent->serialnumber != r->serial)
+			continue;
+
+		if (ent->v.angles == r->rewoundAngles)
+			ent->v.angles = r->angles;
+		if (ent->v.frame == r->rewoundFrame)
+			ent->v.frame = r->frame;
+		if (ent->v.sequence == r->rewoundSequence)
+			ent->v.sequence = r->sequence;
+		if (ent->v.mins == r->rewoundMins && ent->v.maxs == r->rewoundMaxs && (r->mins != r->rewoundMins || r->maxs != r->rewoundMaxs))
+			UTIL_SetSize(&ent->v, r->mins, r->maxs);
+		if (ent->v.origin == r->rewoundOrigin)
+			UTIL_SetOrigin(&ent->v, r->origin);
+	}
+
+	g_iLagRestore = 0;
+	g_fLagRewound = false;
+}
+
+//=========================================================
+// LagComp_Bench - "lagcomp_bench [shots]" server command.
+// Times a rewind and restore along the first player's
+// aim, against whatever monsters are on the map.
+//=========================================================
+static void LagComp_Bench()
+{
+	CPerformanceCounter timer;
+	int i, moved, shots;
+
+	CBaseEntity* pPlayer = UTIL_PlayerByIndex(1);
+	if (!pPlayer)
+	{
+		g_engfuncs.pfnServerPrint("lagcomp_bench: needs a player in slot 1\n");
+		return;
+	}
+
+	shots = CMD_ARGC() > 1 ? atoi(CMD_ARGV(1)) : 1000;
+	shots = V_max(shots, 1);
+
+	UTIL_MakeVectors(pPlayer->pev->v_angle);
+	const Vector vecSrc = pPlayer->pev->origin + pPlayer->pev->view_ofs;
+	const Vector vecDir = gpGlobals->v_forward;
+
+	if (!g_pGameRules->IsMultiplayer())
+	{
+		g_engfuncs.pfnServerPrint("lagcomp_bench: rewind only runs in multiplayer\n");
+		return;
+	}
+
+	// Force the rewind on so the cost can be measured before enabling it
+	const float unlag = sv_unlag_monsters.value;
+	sv_unlag_monsters.value = 1;
+
+	moved = 0;
+	const double start = timer.GetCurTime();
+	for (i = 0; i < shots; i++)
+	{
+		if (LagComp_Rewind(pPlayer->edict(), vecSrc, vecDir, VECTOR_CONE_10DEGREES, 8192))
+		{
+			moved += g_iLagRestore;
+			LagComp_Restore();
+		}
+	}
+	const double elapsed = timer.GetCurTime() - start;
+
+	sv_unlag_monsters.value = unlag;
+
+	int tracked = 0;
+	for (i = 0; i < LAGCOMP_MAX_ENTITIES; i++)
+	{
+		if (0 != g_LagColumnEntity[i])
+			tracked++;
+	}
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("lagcomp_bench: %d shots, %d monsters tracked, %.1f moved per shot, %.2f usec per shot\n",
+		shots, tracked, (float)moved / shots, elapsed * 1000000.0 / shots));
+}
+
+void LagComp_Init()
+{
+	g_psv_maxunlag = CVAR_GET_POINTER("sv_maxunlag");
+	g_engfuncs.pfnAddServerCommand("lagcomp_bench", LagComp_Bench);
+}
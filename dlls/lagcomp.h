@@ -0,0 +1,36 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+//=========================================================
+// lagcomp.h - monster lag compensation. The engine only
+// moves players back in time for a shooter (sv_unlag), so
+// the game keeps its own history of monster positions and
+// animation and rewinds monsters for player hitscan shots.
+//=========================================================
+
+#define LAGCOMP_MAX_ENTITIES 256 // monsters tracked at once
+#define LAGCOMP_HISTORY 64		 // server frames kept, must cover sv_maxunlag
+
+void LagComp_Init();
+void LagComp_Reset();
+void LagComp_Record(); // once per frame, before any entity thinks
+void LagComp_SetClientLerp(edict_t* pClient, int lerp_msec);
+
+// Moves every monster that could be hit by the shot back to where the shooter saw it.
+// Returns false if nothing was moved, otherwise LagComp_Restore must be called.
+bool LagComp_Rewind(edict_t* pShooter, const Vector& vecSrc, const Vector& vecDir, const Vector& vecSpread, float flDistance);
+void LagComp_Restore();
@@ -221,6 +221,7 @@ void CMonsterMaker::MakeMonster()
 	{
 		// if I have a netname (overloaded), give the child monster that name as a targetname
 		pevCreate->targetname = pev->netname;
+		NameIndex_Changed();
 	}
 
 	m_cLiveChildren++; // count this monster
@@ -33,6 +33,12 @@
 #include "decals.h"
 #include "soundent.h"
 #include "gamerules.h"
+#include "ailod.h"
+#include "movecache.h"
+#include "game.h"
+#include "tracecache.h"
+#include "schedprof.h"
+#include "routecache.h"
 
 #define MONSTER_CUT_CORNER_DIST 8 // 8 means the monster's bounding box is contained without the box of the node in WC
 
@@ -194,6 +200,8 @@ void CBaseMonster::Listen()
 	int iMySounds;
 	float hearingSensitivity;
 	CSound* pCurrentSound;
+	int iNearSounds[MAX_WORLD_SOUNDS_LIMIT];
+	int cNearSounds;
 
 	m_iAudibleList = SOUNDLIST_EMPTY;
 	ClearConditions(bits_COND_HEAR_SOUND | bits_COND_SMELL | bits_COND_SMELL_FOOD);
@@ -208,19 +216,21 @@ void CBaseMonster::Listen()
 		iMySounds &= m_pSchedule->iSoundMask;
 	}
 
-	iSound = CSoundEnt::ActiveList();
-
 	// UNDONE: Clear these here?
 	ClearConditions(bits_COND_HEAR_SOUND | bits_COND_SMELL_FOOD | bits_COND_SMELL);
 	hearingSensitivity = HearingSensitivity();
 
-	while (iSound != SOUNDLIST_EMPTY)
+	const Vector vecEar = EarPosition();
+	cNearSounds = CSoundEnt::SoundsNear(vecEar, hearingSensitivity, iNearSounds, ARRAYSIZE(iNearSounds));
+
+	for (int i = 0; i < cNearSounds; i++)
 	{
+		iSound = iNearSounds[i];
 		pCurrentSound = CSoundEnt::SoundPointerForIndex(iSound);
 
 		if (nullptr != pCurrentSound &&
 			(pCurrentSound->m_iType & iMySounds) != 0 &&
-			(pCurrentSound->m_vecOrigin - EarPosition()).Length() <= pCurrentSound->m_iVolume * hearingSensitivity)
+			(pCurrentSound->m_vecOrigin - vecEar).Length() <= pCurrentSound->m_iVolume * hearingSensitivity)
 
 		//if ( ( g_pSoundEnt->m_SoundPool[ iSound ].m_iType & iMySounds ) && ( g_pSoundEnt->m_SoundPool[ iSound ].m_vecOrigin - EarPosition()).Length () <= g_pSoundEnt->m_SoundPool[ iSound ].m_iVolume * hearingSensitivity )
 		{
@@ -256,9 +266,6 @@ void CBaseMonster::Listen()
 
 			m_iAudibleList = iSound;
 		}
-
-		//		iSound = g_pSoundEnt->m_SoundPool[ iSound ].m_iNext;
-		iSound = pCurrentSound->m_iNext;
 	}
 }
 
@@ -512,10 +519,20 @@ CSound* CBaseMonster::PBestScent()
 //=========================================================
 void CBaseMonster::MonsterThink()
 {
-	pev->nextthink = gpGlobals->time + 0.1; // keep monster thinking.
+	const int lod = AILOD_Level(this);
+
+	// out of AI time this frame, try again on the next one
+	if (AILOD_Defer(lod))
+	{
+		pev->nextthink = gpGlobals->time + V_max(gpGlobals->frametime, 0.01f);
+		return;
+	}
 
+	pev->nextthink = AILOD_NextThink(this, lod); // keep monster thinking.
 
+	const double start = AILOD_Begin();
 	RunAI();
+	AILOD_End(lod, start);
 
 	float flInterval = StudioFrameAdvance(); // animate
 											 // start or end a fidget
@@ -611,6 +628,7 @@ void CBaseMonster::RouteNew()
 {
 	m_Route[0].iType = 0;
 	m_iRouteIndex = 0;
+	m_NodePath.fFresh = false;
 }
 
 //=========================================================
@@ -811,6 +829,39 @@ bool ShouldSimplify(int routeType)
 	return true;
 }
 
+//=========================================================
+// RouteNode - the node a waypoint of a route FGetNodeRoute
+// just built is at, or -1.
+//=========================================================
+int CBaseMonster::RouteNode(int iRoute)
+{
+	if (!m_NodePath.fFresh || m_iRouteIndex != 0 || iRoute >= m_NodePath.cNodes)
+		return -1;
+
+	return m_NodePath.iNodes[iRoute];
+}
+
+//=========================================================
+// CheckRouteLocalMove - CheckLocalMove from vecStart to a
+// waypoint, through the node pair cache if both are nodes.
+//=========================================================
+int CBaseMonster::CheckRouteLocalMove(const Vector& vecStart, int iStartNode, int iRoute, CBaseEntity* pTargetEnt)
+{
+	const int iNode = RouteNode(iRoute);
+	int iReturn;
+
+	if (iStartNode == -1 || iNode == -1)
+		return CheckLocalMove(vecStart, m_Route[iRoute].vecLocation, pTargetEnt, NULL);
+
+	if (!RouteCache_PairLookup(this, iStartNode, iNode, pTargetEnt, &iReturn))
+	{
+		iReturn = CheckLocalMove(vecStart, m_Route[iRoute].vecLocation, pTargetEnt, NULL);
+		RouteCache_PairStore(this, iStartNode, iNode, pTargetEnt, iReturn);
+	}
+
+	return iReturn;
+}
+
 //=========================================================
 // RouteSimplify
 //
@@ -822,6 +873,7 @@ void CBaseMonster::RouteSimplify(CBaseEntity* pTargetEnt)
 {
 	// BUGBUG: this doesn't work 100% yet
 	int i, count, outCount;
+	int iStartNode, iOutNode; // the nodes vecStart and the last point out are at, or -1
 	Vector vecStart;
 	WayPoint_t outRoute[ROUTE_SIZE * 2]; // Any points except the ends can turn into 2 points in the simplified route
 
@@ -845,15 +897,18 @@ void CBaseMonster::RouteSimplify(CBaseEntity* pTargetEnt)
 
 	outCount = 0;
 	vecStart = pev->origin;
+	iStartNode = -1;
 	for (i = 0; i < count - 1; i++)
 	{
+		iOutNode = RouteNode(m_iRouteIndex + i);
+
 		// Don't eliminate path_corners
 		if (!ShouldSimplify(m_Route[m_iRouteIndex + i].iType))
 		{
 			outRoute[outCount] = m_Route[m_iRouteIndex + i];
 			outCount++;
 		}
-		else if (CheckLocalMove(vecStart, m_Route[m_iRouteIndex + i + 1].vecLocation, pTargetEnt, NULL) == LOCALMOVE_VALID)
+		else if (CheckRouteLocalMove(vecStart, iStartNode, m_iRouteIndex + i + 1, pTargetEnt) == LOCALMOVE_VALID)
 		{
 			// Skip vert
 			continue;
@@ -873,9 +928,11 @@ void CBaseMonster::RouteSimplify(CBaseEntity* pTargetEnt)
 			{
 				outRoute[outCount].iType = iType;
 				outRoute[outCount].vecLocation = vecTest;
+				iOutNode = -1;
 			}
 			else if (CheckLocalMove(vecSplit, vecTest, pTargetEnt, NULL) == LOCALMOVE_VALID)
 			{
+				iOutNode = -1;
 				outRoute[outCount].iType = iType;
 				outRoute[outCount].vecLocation = vecSplit;
 				outRoute[outCount + 1].iType = iType;
@@ -889,6 +946,7 @@ void CBaseMonster::RouteSimplify(CBaseEntity* pTargetEnt)
 		}
 		// Get last point
 		vecStart = outRoute[outCount].vecLocation;
+		iStartNode = iOutNode;
 		outCount++;
 	}
 	ASSERT(i < count);
@@ -910,6 +968,8 @@ void CBaseMonster::RouteSimplify(CBaseEntity* pTargetEnt)
 	if (i < ROUTE_SIZE)
 		m_Route[i].iType = 0;
 
+	m_NodePath.fFresh = false;
+
 // Debug, test movement code
 #if 0
 //	if ( CVAR_GET_FLOAT( "simplify" ) != 0 )
@@ -1289,6 +1349,7 @@ void CBaseMonster::SetSequenceByName(const char* szSequence)
 // DON"T USE SETORIGIN!
 //=========================================================
 #define LOCAL_STEP_SIZE 16
+#define LOCAL_SPARSE_STEP_SIZE (LOCAL_STEP_SIZE * 2)
 int CBaseMonster::CheckLocalMove(const Vector& vecStart, const Vector& vecEnd, CBaseEntity* pTarget, float* pflDist)
 {
 	Vector vecStartPos; // record monster's position before trying the move
@@ -1296,78 +1357,158 @@ int CBaseMonster::CheckLocalMove(const Vector& vecStart, const Vector& vecEnd, C
 	float flDist;
 	float flStep, stepSize;
 	int iReturn;
+	localmove_t move;
 
-	vecStartPos = pev->origin;
+	if (!MoveCache_Lookup(this, vecStart, vecEnd, &move))
+	{
+		vecStartPos = pev->origin;
 
 
-	flYaw = UTIL_VecToYaw(vecEnd - vecStart); // build a yaw that points to the goal.
-	flDist = (vecEnd - vecStart).Length2D();  // get the distance.
-	iReturn = LOCALMOVE_VALID;				  // assume everything will be ok.
+		flYaw = UTIL_VecToYaw(vecEnd - vecStart); // build a yaw that points to the goal.
+		flDist = (vecEnd - vecStart).Length2D();  // get the distance.
 
-	// move the monster to the start of the local move that's to be checked.
-	UTIL_SetOrigin(pev, vecStart); // !!!BUGBUG - won't this fire triggers? - nope, SetOrigin doesn't fire
+		// move the monster to the start of the local move that's to be checked.
+		UTIL_SetOrigin(pev, vecStart); // !!!BUGBUG - won't this fire triggers? - nope, SetOrigin doesn't fire
 
-	if ((pev->flags & (FL_FLY | FL_SWIM)) == 0)
-	{
-		DROP_TO_FLOOR(ENT(pev)); //make sure monster is on the floor!
-	}
+		if ((pev->flags & (FL_FLY | FL_SWIM)) == 0)
+		{
+			DROP_TO_FLOOR(ENT(pev)); //make sure monster is on the floor!
+		}
 
-	//pev->origin.z = vecStartPos.z;//!!!HACKHACK
+		//pev->origin.z = vecStartPos.z;//!!!HACKHACK
 
-	//	pev->origin = vecStart;
+		//	pev->origin = vecStart;
 
-	/*
-	if ( flDist > 1024 )
-	{
-		// !!!PERFORMANCE - this operation may be too CPU intensive to try checks this large.
-		// We don't lose much here, because a distance this great is very likely
-		// to have something in the way.
+		/*
+		if ( flDist > 1024 )
+		{
+			// !!!PERFORMANCE - this operation may be too CPU intensive to try checks this large.
+			// We don't lose much here, because a distance this great is very likely
+			// to have something in the way.
 
-		// since we've actually moved the monster during the check, undo the move.
-		pev->origin = vecStartPos;
-		return false;
-	}
-*/
-	// this loop takes single steps to the goal.
-	for (flStep = 0; flStep < flDist; flStep += LOCAL_STEP_SIZE)
-	{
-		stepSize = LOCAL_STEP_SIZE;
+			// since we've actually moved the monster during the check, undo the move.
+			pev->origin = vecStartPos;
+			return false;
+		}
+	*/
+
+		// as far as a hull trace at this height gets, nothing needs the fine steps. Walkers
+		// on uneven floor still take them once they are near whatever stopped the trace.
+		float flClear = 0;
+
+		move.blocked = false;
+		move.blockDist = 0;
+		move.pBlocker = NULL;
+		move.steps = 0;
+		move.selfOnly = false;
+
+		if (0 != ai_movesparse.value && (pev->flags & (FL_FLY | FL_SWIM)) == 0)
+		{
+			edict_t* pSavedTraceEnt = gpGlobals->trace_ent;
+			TraceResult tr;
+
+			TRACE_MONSTER_HULL(edict(), pev->origin, Vector(vecEnd.x, vecEnd.y, pev->origin.z), dont_ignore_monsters, edict(), &tr);
+
+			if (0 == tr.fStartSolid && 0 == tr.fAllSolid)
+				flClear = tr.flFraction * flDist - LOCAL_STEP_SIZE;
+
+			// another monster is in the way at this height, a clear walk is only clear for this one
+			if (tr.pHit && tr.pHit != INDEXENT(0) && tr.pHit->v.solid != SOLID_BSP)
+				move.selfOnly = true;
 
-		if ((flStep + LOCAL_STEP_SIZE) >= (flDist - 1))
-			stepSize = (flDist - flStep) - 1;
+			gpGlobals->trace_ent = pSavedTraceEnt;
+		}
+
+		// this loop takes single steps to the goal.
+		for (flStep = 0; flStep < flDist; flStep += stepSize)
+		{
+			const bool fSparse = flStep + LOCAL_SPARSE_STEP_SIZE <= flClear;
+
+			stepSize = fSparse ? LOCAL_SPARSE_STEP_SIZE : LOCAL_STEP_SIZE;
 
-		//		UTIL_ParticleEffect ( pev->origin, g_vecZero, 255, 25 );
+			if ((flStep + stepSize) >= (flDist - 1))
+				stepSize = (flDist - flStep) - 1;
 
-		if (!WALK_MOVE(ENT(pev), flYaw, stepSize, WALKMOVE_CHECKONLY))
-		{ // can't take the next step, fail!
+			//			UTIL_ParticleEffect ( pev->origin, g_vecZero, 255, 25 );
 
-			if (pflDist != NULL)
+			move.steps++;
+
+			if (!WALK_MOVE(ENT(pev), flYaw, stepSize, WALKMOVE_CHECKONLY))
 			{
-				*pflDist = flStep;
+				if (fSparse)
+				{
+					// walk the same stretch again in single steps from here on
+					flClear = 0;
+					stepSize = 0;
+					continue;
+				}
+
+				// can't take the next step, fail!
+				move.blocked = true;
+				move.blockDist = flStep;
+				move.pBlocker = gpGlobals->trace_ent;
+				break;
 			}
-			if (pTarget && pTarget->edict() == gpGlobals->trace_ent)
+		}
+
+		move.endZ = pev->origin.z;
+
+		// the walk didn't bump into the monster itself where it really stands, anyone else would have
+		if (!move.blocked)
+		{
+			Vector mins, maxs;
+
+			for (int i = 0; i < 3; i++)
 			{
-				// if this step hits target ent, the move is legal.
-				iReturn = LOCALMOVE_VALID;
-				break;
+				mins[i] = V_min(V_min(vecStart[i], vecEnd[i]), pev->origin[i]) + pev->mins[i];
+				maxs[i] = V_max(V_max(vecStart[i], vecEnd[i]), pev->origin[i]) + pev->maxs[i];
 			}
-			else
+
+			// steps up and down can take the walk above or below the line
+			mins.z -= 18;
+			maxs.z += 18;
+
+			if (mins.x <= vecStartPos.x + pev->maxs.x && mins.y <= vecStartPos.y + pev->maxs.y && mins.z <= vecStartPos.z + pev->maxs.z &&
+				maxs.x >= vecStartPos.x + pev->mins.x && maxs.y >= vecStartPos.y + pev->mins.y && maxs.z >= vecStartPos.z + pev->mins.z)
 			{
-				// If we're going toward an entity, and we're almost getting there, it's OK.
-				//				if ( pTarget && fabs( flDist - iStep ) < LOCAL_STEP_SIZE )
-				//					fReturn = true;
-				//				else
-				iReturn = LOCALMOVE_INVALID;
-				break;
+				move.selfOnly = true;
 			}
 		}
+
+		// since we've actually moved the monster during the check, undo the move.
+		UTIL_SetOrigin(pev, vecStartPos);
+
+		MoveCache_Store(this, vecStart, vecEnd, &move);
+		MoveCache_CountSteps(move.steps, move.blocked ? (int)(move.blockDist / LOCAL_STEP_SIZE) + 1 : (int)ceil(flDist / LOCAL_STEP_SIZE));
+	}
+	else if (move.blocked)
+	{
+		gpGlobals->trace_ent = move.pBlocker;
+	}
+
+	iReturn = LOCALMOVE_VALID; // assume everything will be ok.
+
+	if (move.blocked)
+	{
+		if (pflDist != NULL)
+		{
+			*pflDist = move.blockDist;
+		}
+
+		// if this step hits target ent, the move is legal.
+		// If we're going toward an entity, and we're almost getting there, it's OK.
+		//				if ( pTarget && fabs( flDist - iStep ) < LOCAL_STEP_SIZE )
+		//					fReturn = true;
+		//				else
+		if (!pTarget || pTarget->edict() != move.pBlocker)
+			iReturn = LOCALMOVE_INVALID;
 	}
 
 	if (iReturn == LOCALMOVE_VALID && (pev->flags & (FL_FLY | FL_SWIM)) == 0 && (!pTarget || (pTarget->pev->flags & FL_ONGROUND) != 0))
 	{
 		// The monster can move to a spot UNDER the target, but not to it. Don't try to triangulate, go directly to the node graph.
 		// UNDONE: Magic # 64 -- this used to be pev->size.z but that won't work for small creatures like the headcrab
-		if (fabs(vecEnd.z - pev->origin.z) > 64)
+		if (fabs(vecEnd.z - move.endZ) > 64)
 		{
 			iReturn = LOCALMOVE_INVALID_DONT_TRIANGULATE;
 		}
@@ -1384,9 +1525,6 @@ int CBaseMonster::CheckLocalMove(const Vector& vecStart, const Vector& vecEnd, C
 	WRITE_COORD(MSG_BROADCAST, vecStart.z);
 	*/
 
-	// since we've actually moved the monster during the check, undo the move.
-	UTIL_SetOrigin(pev, vecStartPos);
-
 	return iReturn;
 }
 
@@ -1528,6 +1666,8 @@ bool CBaseMonster::BuildRoute(const Vector& vecGoal, int iMoveFlag, CBaseEntity*
 	Vector vecApex;
 	int iLocalMove;
 
+	g_cSchedProfRoutes++;
+
 	RouteNew();
 	m_movementGoal = RouteClassify(iMoveFlag);
 
@@ -1602,6 +1742,8 @@ void CBaseMonster::InsertWaypoint(Vector vecLocation, int afMoveFlags)
 	for (i = ROUTE_SIZE - 1; i > 0; i--)
 		m_Route[i] = m_Route[i - 1];
 
+	m_NodePath.fFresh = false;
+
 	m_Route[m_iRouteIndex].vecLocation = vecLocation;
 	m_Route[m_iRouteIndex].iType = type;
 }
@@ -2223,6 +2365,7 @@ int CBaseMonster::IRelationship(CBaseEntity* pTarget)
 
 bool CBaseMonster::FindCover(Vector vecThreat, Vector vecViewOffset, float flMinDist, float flMaxDist)
 {
+	CTraceCaller traceCaller("FindCover");
 	int i;
 	int iMyHullIndex;
 	int iMyNode;
@@ -2760,8 +2903,14 @@ bool CBaseMonster::FGetNodeRoute(Vector vecDest)
 	int iPath[MAX_PATH_SIZE];
 	int iSrcNode, iDestNode;
 	int iResult;
-	int i;
-	int iNumToCopy;
+
+	int iNodeHull = WorldGraph.HullIndex(this); // make this a monster virtual function
+
+	// the goal has only moved a little since the last path, so what's left of that one still does
+	if (RouteCache_Repair(this, vecDest, iNodeHull, iPath, &iResult))
+		return FCopyNodeRoute(vecDest, iPath, iResult);
+
+	m_NodePath.cNodes = 0;
 
 	iSrcNode = WorldGraph.FindNearestNode(pev->origin, this);
 	iDestNode = WorldGraph.FindNearestNode(vecDest, this);
@@ -2781,7 +2930,6 @@ bool CBaseMonster::FGetNodeRoute(Vector vecDest)
 
 	// valid src and dest nodes were found, so it's safe to proceed with
 	// find shortest path
-	int iNodeHull = WorldGraph.HullIndex(this); // make this a monster virtual function
 	iResult = WorldGraph.FindShortestPath(iPath, iSrcNode, iDestNode, iNodeHull, m_afCapability);
 
 	if (0 == iResult)
@@ -2806,6 +2954,19 @@ bool CBaseMonster::FGetNodeRoute(Vector vecDest)
 #endif
 	}
 
+	RouteCache_Store(this, vecDest, iNodeHull, iPath, iResult);
+
+	return FCopyNodeRoute(vecDest, iPath, iResult);
+}
+
+//=========================================================
+// FCopyNodeRoute - fills the route from a node path.
+//=========================================================
+bool CBaseMonster::FCopyNodeRoute(const Vector& vecDest, const int* iPath, int iResult)
+{
+	int i;
+	int iNumToCopy;
+
 	// there's a valid path within iPath now, so now we will fill the route array
 	// up with as many of the waypoints as it will hold.
 
@@ -2832,6 +2993,8 @@ bool CBaseMonster::FGetNodeRoute(Vector vecDest)
 		m_Route[iNumToCopy].iType |= bits_MF_IS_GOAL;
 	}
 
+	m_NodePath.fFresh = true;
+
 	return true;
 }
 
@@ -3127,6 +3290,7 @@ bool CBaseMonster::CanPlaySequence(bool fDisregardMonsterState, int interruptLev
 
 bool CBaseMonster::FindLateralCover(const Vector& vecThreat, const Vector& vecViewOffset)
 {
+	CTraceCaller traceCaller("FindLateralCover");
 	TraceResult tr;
 	Vector vecBestOnLeft;
 	Vector vecBestOnRight;
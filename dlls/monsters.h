@@ -150,6 +150,9 @@ enum
 class CGib : public CBaseEntity
 {
 public:
+	CGib();
+	~CGib() override;
+
 	void Spawn(const char* szGibModel);
 	void EXPORT BounceGibTouch(CBaseEntity* pOther);
 	void EXPORT StickyGibTouch(CBaseEntity* pOther);
@@ -160,11 +163,19 @@ public:
 	static void SpawnHeadGib(entvars_t* pevVictim);
 	static void SpawnRandomGibs(entvars_t* pevVictim, int cGibs, bool human);
 	static void SpawnStickyGibs(entvars_t* pevVictim, Vector vecOrigin, int cGibs);
+	static void CullGibs(); // removes the oldest past sv_maxgibs, and more while edicts are running out
 
 	int m_bloodColor;
 	int m_cBloodDecals;
 	int m_material;
 	float m_lifeTime;
+
+	// every gib, oldest first
+	CGib* m_pNextGib;
+	CGib* m_pPrevGib;
+
+	static inline int m_cGibs;
+	static inline int m_cCulledGibs;
 };
 
 
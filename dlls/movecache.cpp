@@ -0,0 +1,227 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// movecache.cpp - recent CheckLocalMove results
+//
+// The table is direct mapped on a hash of the key. An
+// entry is trusted for MOVECACHE_TIME seconds, and only
+// while no brush entity has moved, changed its angles or
+// changed its solidity since it was stored; every frame
+// those are hashed and any change starts a new generation.
+//
+// Moves blocked by a monster, a player or anything else
+// that isn't a brush aren't stored, those move on their
+// own and the caller has to see them as they are now.
+// Clear moves through the asker's own body, which any
+// other monster would have bumped into, are only given
+// back to the monster that asked.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "monsters.h"
+#include "game.h"
+#include "movecache.h"
+
+#define MOVECACHE_SLOTS 4096 // must be a power of two
+#define MOVECACHE_TIME 1.0	 // monsters and players don't bump the generation
+#define MOVECACHE_GRID 4.0	 // units the start and end are rounded to
+
+typedef struct
+{
+	int start[3];
+	int end[3];
+	int mins[3];
+	int maxs[3];
+	int flags;
+} movekey_t;
+
+typedef struct
+{
+	movekey_t key;
+	int generation; // 0 if the slot is empty
+	float time;
+	int blockerSerial;
+	edict_t* pOwner; // the only monster it's good for, or NULL
+	localmove_t move;
+} moveentry_t;
+
+typedef struct
+{
+	int checks; // that ran the walk
+	int walkMoves;
+	int hits;
+	int savedByCache;  // WALK_MOVE calls the hits would have made
+	int savedBySparse; // WALK_MOVE calls the coarse steps didn't make
+	int generations;
+} movestats_t;
+
+static moveentry_t g_MoveCache[MOVECACHE_SLOTS];
+static int g_iMoveGeneration = 1;
+static unsigned int g_iBrushHash;
+static movestats_t g_MoveStats;
+
+static unsigned int MoveCache_HashBytes(unsigned int hash, const void* data, int size)
+{
+	const byte* p = (const byte*)data;
+
+	for (int i = 0; i < size; i++)
+	{
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void MoveCache_Key(CBaseMonster* pMonster, const Vector& vecStart, const Vector& vecEnd, movekey_t* pkey)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		pkey->start[i] = (int)floor(vecStart[i] / MOVECACHE_GRID);
+		pkey->end[i] = (int)floor(vecEnd[i] / MOVECACHE_GRID);
+		pkey->mins[i] = (int)floor(pMonster->pev->mins[i]);
+		pkey->maxs[i] = (int)floor(pMonster->pev->maxs[i]);
+	}
+
+	pkey->flags = pMonster->pev->flags & (FL_FLY | FL_SWIM | FL_MONSTERCLIP); // all change what WALK_MOVE clips against
+}
+
+//=========================================================
+// MoveCache_Frame
+//=========================================================
+void MoveCache_Frame()
+{
+	if (0 == ai_movecache.value)
+		return;
+
+	unsigned int hash = 2166136261u;
+	edict_t* pEdict = INDEXENT(0);
+
+	for (int i = 1; i < gpGlobals->maxEntities; i++)
+	{
+		const edict_t* ent = pEdict + i;
+
+		if (0 != ent->free || (ent->v.movetype != MOVETYPE_PUSH && ent->v.solid != SOLID_BSP))
+			continue;
+
+		hash = MoveCache_HashBytes(hash, &i, sizeof(i));
+		hash = MoveCache_HashBytes(hash, &ent->v.solid, sizeof(ent->v.solid));
+		hash = MoveCache_HashBytes(hash, &ent->v.origin, sizeof(ent->v.origin));
+		hash = MoveCache_HashBytes(hash, &ent->v.angles, sizeof(ent->v.angles));
+	}
+
+	if (hash != g_iBrushHash)
+	{
+		g_iBrushHash = hash;
+		g_iMoveGeneration++;
+		g_MoveStats.generations++;
+	}
+}
+
+int MoveCache_Generation()
+{
+	return g_iMoveGeneration;
+}
+
+//=========================================================
+// MoveCache_Lookup
+//=========================================================
+bool MoveCache_Lookup(CBaseMonster* pMonster, const Vector& vecStart, const Vector& vecEnd, localmove_t* pmove)
+{
+	if (0 == ai_movecache.value)
+		return false;
+
+	movekey_t key;
+	memset(&key, 0, sizeof(key));
+	MoveCache_Key(pMonster, vecStart, vecEnd, &key);
+
+	const moveentry_t* pentry = &g_MoveCache[MoveCache_HashBytes(2166136261u, &key, sizeof(key)) & (MOVECACHE_SLOTS - 1)];
+
+	if (pentry->generation != g_iMoveGeneration || 0 != memcmp(&pentry->key, &key, sizeof(key)))
+		return false;
+
+	if (gpGlobals->time < pentry->time || gpGlobals->time - pentry->time > MOVECACHE_TIME)
+		return false;
+
+	if (pentry->pOwner && pentry->pOwner != pMonster->edict())
+		return false;
+
+	// the door or breakable that blocked it is gone
+	if (pentry->move.pBlocker && (0 != pentry->move.pBlocker->free || pentry->move.pBlocker->serialnumber != pentry->blockerSerial))
+		return false;
+
+	*pmove = pentry->move;
+
+	g_MoveStats.hits++;
+	g_MoveStats.savedByCache += pentry->move.steps;
+	return true;
+}
+
+//=========================================================
+// MoveCache_Store
+//=========================================================
+void MoveCache_Store(CBaseMonster* pMonster, const Vector& vecStart, const Vector& vecEnd, const localmove_t* pmove)
+{
+	if (0 == ai_movecache.value)
+		return;
+
+	if (pmove->blocked && pmove->pBlocker && pmove->pBlocker != INDEXENT(0) && pmove->pBlocker->v.solid != SOLID_BSP)
+		return;
+
+	movekey_t key;
+	memset(&key, 0, sizeof(key));
+	MoveCache_Key(pMonster, vecStart, vecEnd, &key);
+
+	moveentry_t* pentry = &g_MoveCache[MoveCache_HashBytes(2166136261u, &key, sizeof(key)) & (MOVECACHE_SLOTS - 1)];
+
+	pentry->key = key;
+	pentry->generation = g_iMoveGeneration;
+	pentry->time = gpGlobals->time;
+	pentry->move = *pmove;
+	pentry->blockerSerial = pmove->pBlocker ? pmove->pBlocker->serialnumber : 0;
+	pentry->pOwner = !pmove->blocked && pmove->selfOnly ? pMonster->edict() : NULL;
+}
+
+void MoveCache_CountSteps(int steps, int fineSteps)
+{
+	g_MoveStats.checks++;
+	g_MoveStats.walkMoves += steps;
+	g_MoveStats.savedBySparse += fineSteps - steps;
+}
+
+//=========================================================
+// MoveCache_Stats - "ai_movecache_stats [reset]" server
+// command.
+//=========================================================
+static void MoveCache_Stats()
+{
+	const movestats_t* s = &g_MoveStats;
+	const int lookups = s->checks + s->hits;
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("ai_movecache_stats: %d local moves, %d from the cache (%.1f%%), %d generations\n",
+		lookups, s->hits, 0 != lookups ? 100.0f * s->hits / lookups : 0.0f, s->generations));
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  WALK_MOVE calls: %d made, %d saved by the cache, %d saved by coarse steps\n",
+		s->walkMoves, s->savedByCache, s->savedBySparse));
+
+	if (CMD_ARGC() > 1 && 0 == stricmp(CMD_ARGV(1), "reset"))
+		memset(&g_MoveStats, 0, sizeof(g_MoveStats));
+}
+
+void MoveCache_Init()
+{
+	g_engfuncs.pfnAddServerCommand("ai_movecache_stats", MoveCache_Stats);
+}
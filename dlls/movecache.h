@@ -0,0 +1,46 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+//=========================================================
+// movecache.h - recent CheckLocalMove results. Route
+// building checks the same straight moves over and over,
+// each one a string of WALK_MOVE calls; results are kept
+// for a short while, keyed on the quantised start, end and
+// hull, and dropped whenever a brush entity moves.
+//=========================================================
+
+class CBaseMonster;
+
+typedef struct
+{
+	bool blocked;
+	float blockDist; // how far the walk got before it was blocked
+	float endZ;		 // the monster's height where the walk ended
+	edict_t* pBlocker; // trace_ent of the failed step
+	int steps;		   // WALK_MOVE calls the check took
+	bool selfOnly;	   // clear only for the asker: it went where the asker stands, or near another monster
+} localmove_t;
+
+void MoveCache_Init();
+void MoveCache_Frame(); // from StartFrame, looks for brush entities that moved
+int MoveCache_Generation(); // changes whenever a brush entity has, while ai_movecache is on
+
+bool MoveCache_Lookup(CBaseMonster* pMonster, const Vector& vecStart, const Vector& vecEnd, localmove_t* pmove);
+void MoveCache_Store(CBaseMonster* pMonster, const Vector& vecStart, const Vector& vecEnd, const localmove_t* pmove);
+
+// A check that ran took steps WALK_MOVE calls where 16 unit steps would have taken fineSteps
+void MoveCache_CountSteps(int steps, int fineSteps);
@@ -0,0 +1,224 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// nameindex.cpp - edicts filed by classname and targetname
+//
+// Each field has a table of buckets hashed on the string's
+// contents, since two string_ts can hold the same name.
+// Every bucket is a list of edict indices in ascending
+// order, so a search continues from its start edict the
+// same way the engine's does.
+//
+// The index is brought up to date by comparing every
+// edict's fields against the strings it was filed under.
+// That runs once a frame, and before a search if anything
+// may have created or named an entity since the last time;
+// names that were cleared or freed are caught by the search
+// itself, which checks each edict's current string.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+
+#define NAMEINDEX_BUCKETS 1024 // must be a power of two
+
+typedef struct
+{
+	string_t name[NAMEINDEX_FIELDS]; // what it is filed under, 0 if nothing
+	int next[NAMEINDEX_FIELDS];
+} nameentry_t;
+
+static const char* g_szNameIndexFields[NAMEINDEX_FIELDS] = {"classname", "targetname"};
+
+static nameentry_t* g_pNameEntries;
+static int g_cNameEntries;
+static int g_iNameBuckets[NAMEINDEX_FIELDS][NAMEINDEX_BUCKETS];
+static edict_t* g_pNameEdicts; // edict 0, as of the last update
+
+typedef struct
+{
+	int searches;
+	int visited; // list entries the searches looked at
+	int updates;
+	int refiled;
+} nameindexstats_t;
+
+static nameindexstats_t g_NameIndexStats;
+
+static unsigned int NameIndex_Hash(const char* pszName)
+{
+	unsigned int hash = 2166136261u;
+
+	while ('\0' != *pszName)
+	{
+		hash ^= (byte)*pszName++;
+		hash *= 16777619u;
+	}
+
+	return hash & (NAMEINDEX_BUCKETS - 1);
+}
+
+static string_t NameIndex_Field(const edict_t* pent, int iField)
+{
+	if (0 != pent->free)
+		return 0;
+
+	return iField == NAMEINDEX_CLASSNAME ? pent->v.classname : pent->v.targetname;
+}
+
+static void NameIndex_Unlink(int iEdict, int iField)
+{
+	int* pLink = &g_iNameBuckets[iField][NameIndex_Hash(STRING(g_pNameEntries[iEdict].name[iField]))];
+
+	while (*pLink != -1 && *pLink != iEdict)
+		pLink = &g_pNameEntries[*pLink].next[iField];
+
+	if (*pLink == iEdict)
+		*pLink = g_pNameEntries[iEdict].next[iField];
+
+	g_pNameEntries[iEdict].name[iField] = 0;
+}
+
+static void NameIndex_Link(int iEdict, int iField, string_t name)
+{
+	int* pLink = &g_iNameBuckets[iField][NameIndex_Hash(STRING(name))];
+
+	// keep the bucket in edict order
+	while (*pLink != -1 && *pLink < iEdict)
+		pLink = &g_pNameEntries[*pLink].next[iField];
+
+	g_pNameEntries[iEdict].next[iField] = *pLink;
+	g_pNameEntries[iEdict].name[iField] = name;
+	*pLink = iEdict;
+}
+
+//=========================================================
+// NameIndex_Update - refiles every edict whose classname or
+// targetname isn't the one it was filed under.
+//=========================================================
+static void NameIndex_Update()
+{
+	int i, iField;
+
+	g_pNameEdicts = INDEXENT(0);
+
+	if (g_cNameEntries != gpGlobals->maxEntities)
+	{
+		delete[] g_pNameEntries;
+
+		g_cNameEntries = gpGlobals->maxEntities;
+		g_pNameEntries = new nameentry_t[g_cNameEntries];
+		memset(g_pNameEntries, 0, sizeof(nameentry_t) * g_cNameEntries);
+		memset(g_iNameBuckets, -1, sizeof(g_iNameBuckets));
+	}
+
+	// worldspawn is never returned, the engine starts after it too
+	for (i = 1; i < g_cNameEntries; i++)
+	{
+		const edict_t* pent = g_pNameEdicts + i;
+
+		for (iField = 0; iField < NAMEINDEX_FIELDS; iField++)
+		{
+			const string_t name = NameIndex_Field(pent, iField);
+
+			if (name == g_pNameEntries[i].name[iField])
+				continue;
+
+			if (0 != g_pNameEntries[i].name[iField])
+				NameIndex_Unlink(i, iField);
+
+			if (0 != name)
+				NameIndex_Link(i, iField, name);
+
+			g_NameIndexStats.refiled++;
+		}
+	}
+
+	g_fNameIndexStale = false;
+	g_NameIndexStats.updates++;
+}
+
+//=========================================================
+// NameIndex_Find
+//=========================================================
+edict_t* NameIndex_Find(edict_t* pentStart, int iField, const char* pszName)
+{
+	if (0 == sv_nameindex.value || !pszName)
+		return FIND_ENTITY_BY_STRING(pentStart, g_szNameIndexFields[iField], pszName);
+
+	if (g_fNameIndexStale || !g_pNameEntries)
+		NameIndex_Update();
+
+	const int iStart = pentStart ? pentStart - g_pNameEdicts : 0;
+
+	g_NameIndexStats.searches++;
+
+	for (int i = g_iNameBuckets[iField][NameIndex_Hash(pszName)]; i != -1; i = g_pNameEntries[i].next[iField])
+	{
+		g_NameIndexStats.visited++;
+
+		if (i <= iStart)
+			continue;
+
+		edict_t* pent = g_pNameEdicts + i;
+		const string_t name = NameIndex_Field(pent, iField);
+
+		if (0 != name && 0 == strcmp(STRING(name), pszName))
+			return pent;
+	}
+
+	// not found is worldspawn, as from the engine
+	return g_pNameEdicts;
+}
+
+void NameIndex_Frame()
+{
+	if (0 != sv_nameindex.value)
+		NameIndex_Update();
+}
+
+void NameIndex_Reset()
+{
+	if (g_pNameEntries)
+	{
+		memset(g_pNameEntries, 0, sizeof(nameentry_t) * g_cNameEntries);
+		memset(g_iNameBuckets, -1, sizeof(g_iNameBuckets));
+	}
+
+	g_fNameIndexStale = true;
+}
+
+//=========================================================
+// NameIndex_Stats - "nameindex_stats [reset]" server
+// command.
+//=========================================================
+static void NameIndex_Stats()
+{
+	const nameindexstats_t* s = &g_NameIndexStats;
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("nameindex_stats: %d searches looked at %.1f entries each, %d edicts\n",
+		s->searches, 0 != s->searches ? (float)s->visited / s->searches : 0.0f, g_cNameEntries));
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %d updates refiled %d names\n", s->updates, s->refiled));
+
+	if (CMD_ARGC() > 1 && 0 == stricmp(CMD_ARGV(1), "reset"))
+		memset(&g_NameIndexStats, 0, sizeof(g_NameIndexStats));
+}
+
+void NameIndex_Init()
+{
+	g_engfuncs.pfnAddServerCommand("nameindex_stats", NameIndex_Stats);
+}
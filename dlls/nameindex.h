@@ -0,0 +1,46 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+//=========================================================
+// nameindex.h - edicts filed by classname and targetname,
+// so FIND_ENTITY_BY_CLASSNAME, FIND_ENTITY_BY_TARGETNAME
+// and the UTIL_FindEntityBy* helpers don't have to scan
+// every edict in the engine for each step of a search.
+//=========================================================
+
+enum
+{
+	NAMEINDEX_CLASSNAME = 0,
+	NAMEINDEX_TARGETNAME,
+
+	NAMEINDEX_FIELDS
+};
+
+// set whenever an entity may have been created or named, the next search brings the index up to date first
+inline bool g_fNameIndexStale = true;
+
+inline void NameIndex_Changed()
+{
+	g_fNameIndexStale = true;
+}
+
+void NameIndex_Init();
+void NameIndex_Reset(); // the edicts are about to be reused for another map
+void NameIndex_Frame(); // from StartFrame, catches names changed anywhere else
+
+// Same results, in the same order, as FIND_ENTITY_BY_STRING on the field
+edict_t* NameIndex_Find(edict_t* pentStart, int iField, const char* pszName);
@@ -0,0 +1,560 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// netprof.cpp - network profiler
+//
+// Counts are kept for a rolling window of netprof_window
+// seconds. netprof_dump prints the last complete window,
+// and with netprof_csv set every window is appended to
+// netprof.csv in the game directory.
+//
+// Only messages written by the game dll are seen. Entity
+// deltas are built by the engine, so for those we count
+// the encoder calls and the fields that differ between
+// the old and new state.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "entity_state.h"
+#include "game.h"
+#include "netprof.h"
+
+#define NETPROF_MAX_MESSAGES 256
+#define NETPROF_MAX_DESTS (MSG_SPEC + 1)
+#define NETPROF_MAX_CLASSES 256 // must be a power of two
+
+typedef struct
+{
+	int count;
+	int bytes;
+} netstat_t;
+
+typedef struct
+{
+	string_t classname;
+	int deltas;
+	int fields; // changed fields over all deltas
+} netclass_t;
+
+typedef struct
+{
+	const char* name;
+	int offset;
+	int size;
+} netfield_t;
+
+#define NETFIELD(name) {#name, offsetof(entity_state_t, name), sizeof(((entity_state_t*)0)->name)}
+
+static const netfield_t g_NetFields[] =
+	{
+		NETFIELD(origin),
+		NETFIELD(angles),
+		NETFIELD(modelindex),
+		NETFIELD(sequence),
+		NETFIELD(frame),
+		NETFIELD(colormap),
+		NETFIELD(skin),
+		NETFIELD(solid),
+		NETFIELD(effects),
+		NETFIELD(scale),
+		NETFIELD(eflags),
+		NETFIELD(rendermode),
+		NETFIELD(renderamt),
+		NETFIELD(rendercolor),
+		NETFIELD(renderfx),
+		NETFIELD(movetype),
+		NETFIELD(animtime),
+		NETFIELD(framerate),
+		NETFIELD(body),
+		NETFIELD(controller),
+		NETFIELD(blending),
+		NETFIELD(velocity),
+		NETFIELD(mins),
+		NETFIELD(maxs),
+		NETFIELD(aiment),
+		NETFIELD(owner),
+		NETFIELD(friction),
+		NETFIELD(gravity),
+		NETFIELD(team),
+		NETFIELD(playerclass),
+		NETFIELD(health),
+		NETFIELD(spectator),
+		NETFIELD(weaponmodel),
+		NETFIELD(gaitsequence),
+		NETFIELD(basevelocity),
+		NETFIELD(usehull),
+		NETFIELD(oldbuttons),
+		NETFIELD(onground),
+		NETFIELD(iStepLeft),
+		NETFIELD(flFallVelocity),
+		NETFIELD(fov),
+		NETFIELD(weaponanim),
+		NETFIELD(startpos),
+		NETFIELD(endpos),
+		NETFIELD(impacttime),
+		NETFIELD(starttime),
+		NETFIELD(iuser1),
+		NETFIELD(iuser2),
+		NETFIELD(iuser3),
+		NETFIELD(iuser4),
+		NETFIELD(fuser1),
+		NETFIELD(fuser2),
+		NETFIELD(fuser3),
+		NETFIELD(fuser4),
+		NETFIELD(vuser1),
+		NETFIELD(vuser2),
+		NETFIELD(vuser3),
+		NETFIELD(vuser4),
+};
+
+#define NETPROF_NUM_FIELDS ARRAYSIZE(g_NetFields)
+
+typedef struct
+{
+	float start;
+	float end;
+	netstat_t messages[NETPROF_MAX_MESSAGES];
+	netstat_t dests[NETPROF_MAX_DESTS];
+	netstat_t deltas[NETPROF_DELTA_CUSTOM + 1];
+	netclass_t classes[NETPROF_MAX_CLASSES];
+	int numClasses;
+	int fieldChanges[NETPROF_NUM_FIELDS];
+} netwindow_t;
+
+static const char* g_szDestNames[NETPROF_MAX_DESTS] =
+	{
+		"broadcast",
+		"one",
+		"all",
+		"init",
+		"pvs",
+		"pas",
+		"pvs_r",
+		"pas_r",
+		"one_unreliable",
+		"spec",
+};
+
+static const char* g_szDeltaNames[NETPROF_DELTA_CUSTOM + 1] =
+	{
+		"entity_state_t",
+		"entity_state_player_t",
+		"custom_entity_state_t",
+};
+
+static netwindow_t g_NetWindow;
+static netwindow_t g_NetLastWindow;
+static bool g_fNetLastWindowValid = false;
+
+static char g_szNetMsgNames[NETPROF_MAX_MESSAGES][32];
+static int g_iNetMsgSizes[NETPROF_MAX_MESSAGES];
+
+// The message currently being written
+static int g_iNetMsgType;
+static int g_iNetMsgDest;
+static int g_iNetMsgBytes;
+
+// The real engine functions while the counting versions are installed
+static enginefuncs_t g_NetEngfuncs;
+
+//=========================================================
+// Counting replacements for the engine message functions
+//=========================================================
+static void NetProf_MessageBegin(int msg_dest, int msg_type, const float* pOrigin, edict_t* ed)
+{
+	g_iNetMsgType = msg_type;
+	g_iNetMsgDest = msg_dest;
+
+	// Message id, plus a length byte for variable sized user messages
+	g_iNetMsgBytes = 1;
+	if (msg_type >= 0 && msg_type < NETPROF_MAX_MESSAGES && g_iNetMsgSizes[msg_type] == -1)
+		g_iNetMsgBytes++;
+
+	g_NetEngfuncs.pfnMessageBegin(msg_dest, msg_type, pOrigin, ed);
+}
+
+static void NetProf_MessageEnd()
+{
+	if (g_iNetMsgType >= 0 && g_iNetMsgType < NETPROF_MAX_MESSAGES)
+	{
+		g_NetWindow.messages[g_iNetMsgType].count++;
+		g_NetWindow.messages[g_iNetMsgType].bytes += g_iNetMsgBytes;
+	}
+
+	if (g_iNetMsgDest >= 0 && g_iNetMsgDest < NETPROF_MAX_DESTS)
+	{
+		g_NetWindow.dests[g_iNetMsgDest].count++;
+		g_NetWindow.dests[g_iNetMsgDest].bytes += g_iNetMsgBytes;
+	}
+
+	g_NetEngfuncs.pfnMessageEnd();
+}
+
+static void NetProf_WriteByte(int iValue)
+{
+	g_iNetMsgBytes += 1;
+	g_NetEngfuncs.pfnWriteByte(iValue);
+}
+
+static void NetProf_WriteChar(int iValue)
+{
+	g_iNetMsgBytes += 1;
+	g_NetEngfuncs.pfnWriteChar(iValue);
+}
+
+static void NetProf_WriteShort(int iValue)
+{
+	g_iNetMsgBytes += 2;
+	g_NetEngfuncs.pfnWriteShort(iValue);
+}
+
+static void NetProf_WriteLong(int iValue)
+{
+	g_iNetMsgBytes += 4;
+	g_NetEngfuncs.pfnWriteLong(iValue);
+}
+
+static void NetProf_WriteAngle(float flValue)
+{
+	g_iNetMsgBytes += 1;
+	g_NetEngfuncs.pfnWriteAngle(flValue);
+}
+
+static void NetProf_WriteCoord(float flValue)
+{
+	g_iNetMsgBytes += 2;
+	g_NetEngfuncs.pfnWriteCoord(flValue);
+}
+
+static void NetProf_WriteString(const char* sz)
+{
+	g_iNetMsgBytes += (sz ? strlen(sz) : 0) + 1;
+	g_NetEngfuncs.pfnWriteString(sz);
+}
+
+static void NetProf_WriteEntity(int iValue)
+{
+	g_iNetMsgBytes += 2;
+	g_NetEngfuncs.pfnWriteEntity(iValue);
+}
+
+//=========================================================
+// Always installed, so the dumps can show message names
+//=========================================================
+static int NetProf_RegUserMsg(const char* pszName, int iSize)
+{
+	int id = g_NetEngfuncs.pfnRegUserMsg(pszName, iSize);
+
+	if (id > 0 && id < NETPROF_MAX_MESSAGES)
+	{
+		strncpy(g_szNetMsgNames[id], pszName, sizeof(g_szNetMsgNames[id]) - 1);
+		g_iNetMsgSizes[id] = iSize;
+	}
+
+	return id;
+}
+
+static void NetProf_Install(bool enable)
+{
+	if (enable)
+	{
+		g_engfuncs.pfnMessageBegin = NetProf_MessageBegin;
+		g_engfuncs.pfnMessageEnd = NetProf_MessageEnd;
+		g_engfuncs.pfnWriteByte = NetProf_WriteByte;
+		g_engfuncs.pfnWriteChar = NetProf_WriteChar;
+		g_engfuncs.pfnWriteShort = NetProf_WriteShort;
+		g_engfuncs.pfnWriteLong = NetProf_WriteLong;
+		g_engfuncs.pfnWriteAngle = NetProf_WriteAngle;
+		g_engfuncs.pfnWriteCoord = NetProf_WriteCoord;
+		g_engfuncs.pfnWriteString = NetProf_WriteString;
+		g_engfuncs.pfnWriteEntity = NetProf_WriteEntity;
+	}
+	else
+	{
+		g_engfuncs.pfnMessageBegin = g_NetEngfuncs.pfnMessageBegin;
+		g_engfuncs.pfnMessageEnd = g_NetEngfuncs.pfnMessageEnd;
+		g_engfuncs.pfnWriteByte = g_NetEngfuncs.pfnWriteByte;
+		g_engfuncs.pfnWriteChar = g_NetEngfuncs.pfnWriteChar;
+		g_engfuncs.pfnWriteShort = g_NetEngfuncs.pfnWriteShort;
+		g_engfuncs.pfnWriteLong = g_NetEngfuncs.pfnWriteLong;
+		g_engfuncs.pfnWriteAngle = g_NetEngfuncs.pfnWriteAngle;
+		g_engfuncs.pfnWriteCoord = g_NetEngfuncs.pfnWriteCoord;
+		g_engfuncs.pfnWriteString = g_NetEngfuncs.pfnWriteString;
+		g_engfuncs.pfnWriteEntity = g_NetEngfuncs.pfnWriteEntity;
+	}
+
+	g_fNetProfActive = enable;
+}
+
+//=========================================================
+// NetProf_EntityDelta - called by the delta encoders
+//=========================================================
+void NetProf_EntityDelta(const entity_state_t* from, const entity_state_t* to, int deltaType)
+{
+	int i, changed;
+	string_t classname = 0;
+
+	g_NetWindow.deltas[deltaType].count++;
+
+	changed = 0;
+	for (i = 0; i < (int)NETPROF_NUM_FIELDS; i++)
+	{
+		const netfield_t* pField = &g_NetFields[i];
+
+		if (0 != memcmp((const byte*)from + pField->offset, (const byte*)to + pField->offset, pField->size))
+		{
+			g_NetWindow.fieldChanges[i]++;
+			g_NetWindow.deltas[deltaType].bytes += pField->size;
+			changed++;
+		}
+	}
+
+	edict_t* pEdict = INDEXENT(to->number);
+	if (pEdict)
+		classname = pEdict->v.classname;
+
+	// Open addressing on the string offset, the table is never more than half full
+	for (i = classname & (NETPROF_MAX_CLASSES - 1);; i = (i + 1) & (NETPROF_MAX_CLASSES - 1))
+	{
+		netclass_t* pClass = &g_NetWindow.classes[i];
+
+		if (pClass->deltas == 0)
+		{
+			if (g_NetWindow.numClasses >= NETPROF_MAX_CLASSES / 2)
+				return;
+
+			g_NetWindow.numClasses++;
+			pClass->classname = classname;
+		}
+		else if (pClass->classname != classname)
+		{
+			continue;
+		}
+
+		pClass->deltas++;
+		pClass->fields += changed;
+		return;
+	}
+}
+
+static const char* NetProf_MessageName(int id)
+{
+	static char name[32];
+
+	if ('\0' != g_szNetMsgNames[id][0])
+		return g_szNetMsgNames[id];
+
+	switch (id)
+	{
+	case SVC_TEMPENTITY:
+		return "svc_temp_entity";
+	case SVC_INTERMISSION:
+		return "svc_intermission";
+	case SVC_CDTRACK:
+		return "svc_cdtrack";
+	case SVC_WEAPONANIM:
+		return "svc_weaponanim";
+	case SVC_ROOMTYPE:
+		return "svc_roomtype";
+	case SVC_DIRECTOR:
+		return "svc_director";
+	}
+
+	snprintf(name, sizeof(name), "svc_%d", id);
+	return name;
+}
+
+static const char* NetProf_ClassName(const netclass_t* pClass)
+{
+	return 0 != pClass->classname ? STRING(pClass->classname) : "(none)";
+}
+
+// Sorts indices into a netstat_t array by bytes, largest first
+static int NetProf_SortStats(const netstat_t* stats, int count, int* order)
+{
+	int i, j, n;
+
+	n = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (0 == stats[i].count)
+			continue;
+
+		for (j = n; j > 0 && stats[order[j - 1]].bytes < stats[i].bytes; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+		n++;
+	}
+
+	return n;
+}
+
+//=========================================================
+// NetProf_Dump - "netprof_dump" server command
+//=========================================================
+static void NetProf_Dump()
+{
+	int order[NETPROF_MAX_MESSAGES];
+	int i, n;
+	const netwindow_t* w = &g_NetLastWindow;
+
+	if (!g_fNetLastWindowValid)
+	{
+		g_engfuncs.pfnServerPrint("netprof: no complete window yet, set netprof 1 and wait netprof_window seconds\n");
+		return;
+	}
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("netprof: %.1f - %.1f (%.1f seconds)\n", w->start, w->end, w->end - w->start));
+
+	g_engfuncs.pfnServerPrint("\nmessage                   count    bytes\n");
+	n = NetProf_SortStats(w->messages, NETPROF_MAX_MESSAGES, order);
+	for (i = 0; i < n; i++)
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("%-20.20s %10d %8d\n", NetProf_MessageName(order[i]), w->messages[order[i]].count, w->messages[order[i]].bytes));
+
+	g_engfuncs.pfnServerPrint("\ndestination               count    bytes\n");
+	n = NetProf_SortStats(w->dests, NETPROF_MAX_DESTS, order);
+	for (i = 0; i < n; i++)
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("%-20.20s %10d %8d\n", g_szDestNames[order[i]], w->dests[order[i]].count, w->dests[order[i]].bytes));
+
+	g_engfuncs.pfnServerPrint("\ndelta                    deltas  changed bytes\n");
+	for (i = 0; i <= NETPROF_DELTA_CUSTOM; i++)
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("%-22.22s %8d %8d\n", g_szDeltaNames[i], w->deltas[i].count, w->deltas[i].bytes));
+
+	g_engfuncs.pfnServerPrint("\nclass                    deltas   fields\n");
+	for (i = 0; i < NETPROF_MAX_CLASSES; i++)
+	{
+		if (0 != w->classes[i].deltas)
+			g_engfuncs.pfnServerPrint(UTIL_VarArgs("%-22.22s %8d %8d\n", NetProf_ClassName(&w->classes[i]), w->classes[i].deltas, w->classes[i].fields));
+	}
+
+	g_engfuncs.pfnServerPrint("\nfield                   changes\n");
+	for (i = 0; i < (int)NETPROF_NUM_FIELDS; i++)
+	{
+		if (0 != w->fieldChanges[i])
+			g_engfuncs.pfnServerPrint(UTIL_VarArgs("%-22.22s %8d\n", g_NetFields[i].name, w->fieldChanges[i]));
+	}
+}
+
+//=========================================================
+// NetProf_WriteCSV - appends a finished window as
+// time,kind,name,count,bytes rows
+//=========================================================
+static void NetProf_WriteCSV(const netwindow_t* w)
+{
+	char path[256];
+	char gamedir[128];
+	FILE* fp;
+	int i;
+
+	GET_GAME_DIR(gamedir);
+	snprintf(path, sizeof(path), "%s/netprof.csv", gamedir);
+
+	fp = fopen(path, "a");
+	if (!fp)
+	{
+		ALERT(at_console, "netprof: couldn't open %s\n", path);
+		return;
+	}
+
+	for (i = 0; i < NETPROF_MAX_MESSAGES; i++)
+	{
+		if (0 != w->messages[i].count)
+			fprintf(fp, "%.1f,message,%s,%d,%d\n", w->end, NetProf_MessageName(i), w->messages[i].count, w->messages[i].bytes);
+	}
+
+	for (i = 0; i < NETPROF_MAX_DESTS; i++)
+	{
+		if (0 != w->dests[i].count)
+			fprintf(fp, "%.1f,dest,%s,%d,%d\n", w->end, g_szDestNames[i], w->dests[i].count, w->dests[i].bytes);
+	}
+
+	for (i = 0; i <= NETPROF_DELTA_CUSTOM; i++)
+	{
+		if (0 != w->deltas[i].count)
+			fprintf(fp, "%.1f,delta,%s,%d,%d\n", w->end, g_szDeltaNames[i], w->deltas[i].count, w->deltas[i].bytes);
+	}
+
+	for (i = 0; i < NETPROF_MAX_CLASSES; i++)
+	{
+		if (0 != w->classes[i].deltas)
+			fprintf(fp, "%.1f,class,%s,%d,%d\n", w->end, NetProf_ClassName(&w->classes[i]), w->classes[i].deltas, w->classes[i].fields);
+	}
+
+	for (i = 0; i < (int)NETPROF_NUM_FIELDS; i++)
+	{
+		if (0 != w->fieldChanges[i])
+			fprintf(fp, "%.1f,field,%s,%d,0\n", w->end, g_NetFields[i].name, w->fieldChanges[i]);
+	}
+
+	fclose(fp);
+}
+
+static void NetProf_StartWindow()
+{
+	memset(&g_NetWindow, 0, sizeof(g_NetWindow));
+	g_NetWindow.start = gpGlobals->time;
+}
+
+void NetProf_Init()
+{
+	g_NetEngfuncs = g_engfuncs;
+	g_engfuncs.pfnRegUserMsg = NetProf_RegUserMsg;
+
+	g_engfuncs.pfnAddServerCommand("netprof_dump", NetProf_Dump);
+}
+
+//=========================================================
+// NetProf_Frame - follows the netprof cvar and closes the
+// window once netprof_window seconds have passed
+//=========================================================
+void NetProf_Frame()
+{
+	const bool enable = 0 != netprof.value;
+
+	if (enable != g_fNetProfActive)
+	{
+		NetProf_Install(enable);
+
+		if (enable)
+		{
+			g_fNetLastWindowValid = false;
+			NetProf_StartWindow();
+		}
+	}
+
+	if (!enable)
+		return;
+
+	// A new map restarts the clock
+	if (gpGlobals->time < g_NetWindow.start)
+	{
+		NetProf_StartWindow();
+		return;
+	}
+
+	if (gpGlobals->time - g_NetWindow.start < V_max(1.0f, netprof_window.value))
+		return;
+
+	g_NetWindow.end = gpGlobals->time;
+	g_NetLastWindow = g_NetWindow;
+	g_fNetLastWindowValid = true;
+
+	if (0 != netprof_csv.value)
+		NetProf_WriteCSV(&g_NetLastWindow);
+
+	NetProf_StartWindow();
+}
@@ -0,0 +1,36 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+//=========================================================
+// netprof.h - network profiler. While the netprof cvar is
+// set, the message functions in g_engfuncs are replaced
+// with counting versions, and the delta encoders report
+// which entity_state_t fields changed.
+//=========================================================
+
+enum
+{
+	NETPROF_DELTA_ENTITY = 0,
+	NETPROF_DELTA_PLAYER,
+	NETPROF_DELTA_CUSTOM,
+};
+
+inline bool g_fNetProfActive = false;
+
+void NetProf_Init();  // from GameDLLInit, before any user message is registered
+void NetProf_Frame(); // from StartFrame
+void NetProf_EntityDelta(const struct entity_state_s* from, const struct entity_state_s* to, int deltaType);
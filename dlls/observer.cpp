@@ -187,18 +187,18 @@ void CBasePlayer::Observer_CheckProperties()
 			m_iFOV = target->m_iFOV;
 			m_iClientFOV = m_iFOV;
 			// write fov before wepon data, so zoomed crosshair is set correctly
-			MESSAGE_BEGIN(MSG_ONE, gmsgSetFOV, NULL, pev);
-			WRITE_BYTE(m_iFOV);
-			MESSAGE_END();
+			m_HudQueue.Begin(pev, gmsgSetFOV, HudMessageKey(gmsgSetFOV), HUDMSG_IMMEDIATE);
+			m_HudQueue.WriteByte(m_iFOV);
+			m_HudQueue.End();
 
 
 			m_iObserverWeapon = weapon;
 			//send weapon update
-			MESSAGE_BEGIN(MSG_ONE, gmsgCurWeapon, NULL, pev);
-			WRITE_BYTE(1); // 1 = current weapon, not on target
-			WRITE_BYTE(m_iObserverWeapon);
-			WRITE_BYTE(0); // clip
-			MESSAGE_END();
+			m_HudQueue.Begin(pev, gmsgCurWeapon, HudMessageKey(gmsgCurWeapon, m_iObserverWeapon), HUDMSG_IMMEDIATE);
+			m_HudQueue.WriteByte(1); // 1 = current weapon, not on target
+			m_HudQueue.WriteByte(m_iObserverWeapon);
+			m_HudQueue.WriteByte(0); // clip
+			m_HudQueue.End();
 		}
 	}
 	else
@@ -209,11 +209,11 @@ void CBasePlayer::Observer_CheckProperties()
 		{
 			m_iObserverWeapon = 0;
 
-			MESSAGE_BEGIN(MSG_ONE, gmsgCurWeapon, NULL, pev);
-			WRITE_BYTE(1); // 1 = current weapon
-			WRITE_BYTE(m_iObserverWeapon);
-			WRITE_BYTE(0); // clip
-			MESSAGE_END();
+			m_HudQueue.Begin(pev, gmsgCurWeapon, HudMessageKey(gmsgCurWeapon, m_iObserverWeapon), HUDMSG_IMMEDIATE);
+			m_HudQueue.WriteByte(1); // 1 = current weapon
+			m_HudQueue.WriteByte(m_iObserverWeapon);
+			m_HudQueue.WriteByte(0); // clip
+			m_HudQueue.End();
 		}
 	}
 }
@@ -798,23 +798,23 @@ void CBasePlayer::Killed(entvars_t* pevAttacker, int iGib)
 
 	// send "health" update message to zero
 	m_iClientHealth = 0;
-	MESSAGE_BEGIN(MSG_ONE, gmsgHealth, NULL, pev);
-	WRITE_SHORT(m_iClientHealth);
-	MESSAGE_END();
+	m_HudQueue.Begin(pev, gmsgHealth, HudMessageKey(gmsgHealth), HUDMSG_IMMEDIATE);
+	m_HudQueue.WriteShort(m_iClientHealth);
+	m_HudQueue.End();
 
 	// Tell Ammo Hud that the player is dead
-	MESSAGE_BEGIN(MSG_ONE, gmsgCurWeapon, NULL, pev);
-	WRITE_BYTE(0);
-	WRITE_BYTE(0XFF);
-	WRITE_BYTE(0xFF);
-	MESSAGE_END();
+	m_HudQueue.Begin(pev, gmsgCurWeapon, HudMessageKey(gmsgCurWeapon, 0xFF), HUDMSG_IMMEDIATE);
+	m_HudQueue.WriteByte(0);
+	m_HudQueue.WriteByte(0XFF);
+	m_HudQueue.WriteByte(0xFF);
+	m_HudQueue.End();
 
 	// reset FOV
 	m_iFOV = m_iClientFOV = 0;
 
-	MESSAGE_BEGIN(MSG_ONE, gmsgSetFOV, NULL, pev);
-	WRITE_BYTE(0);
-	MESSAGE_END();
+	m_HudQueue.Begin(pev, gmsgSetFOV, HudMessageKey(gmsgSetFOV), HUDMSG_IMMEDIATE);
+	m_HudQueue.WriteByte(0);
+	m_HudQueue.End();
 
 
 	// UNDONE: Put this in, but add FFADE_PERMANENT and make fade time 8.8 instead of 4.12
@@ -1337,17 +1337,17 @@ void CBasePlayer::StartObserver(Vector vecPosition, Vector vecViewAngle)
 	SetSuitUpdate(NULL, false, 0);
 
 	// Tell Ammo Hud that the player is dead
-	MESSAGE_BEGIN(MSG_ONE, gmsgCurWeapon, NULL, pev);
-	WRITE_BYTE(0);
-	WRITE_BYTE(0XFF);
-	WRITE_BYTE(0xFF);
-	MESSAGE_END();
+	m_HudQueue.Begin(pev, gmsgCurWeapon, HudMessageKey(gmsgCurWeapon, 0xFF), HUDMSG_IMMEDIATE);
+	m_HudQueue.WriteByte(0);
+	m_HudQueue.WriteByte(0XFF);
+	m_HudQueue.WriteByte(0xFF);
+	m_HudQueue.End();
 
 	// reset FOV
 	m_iFOV = m_iClientFOV = 0;
-	MESSAGE_BEGIN(MSG_ONE, gmsgSetFOV, NULL, pev);
-	WRITE_BYTE(0);
-	MESSAGE_END();
+	m_HudQueue.Begin(pev, gmsgSetFOV, HudMessageKey(gmsgSetFOV), HUDMSG_IMMEDIATE);
+	m_HudQueue.WriteByte(0);
+	m_HudQueue.End();
 
 	// Setup flags
 	m_iHideHUD = (HIDEHUD_HEALTH | HIDEHUD_WEAPONS);
@@ -3239,10 +3239,10 @@ void CBasePlayer::FlashlightTurnOn()
 	{
 		EMIT_SOUND_DYN(ENT(pev), CHAN_WEAPON, SOUND_FLASHLIGHT_ON, 1.0, ATTN_NORM, 0, PITCH_NORM);
 		SetBits(pev->effects, EF_DIMLIGHT);
-		MESSAGE_BEGIN(MSG_ONE, gmsgFlashlight, NULL, pev);
-		WRITE_BYTE(1);
-		WRITE_BYTE(m_iFlashBattery);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgFlashlight, HudMessageKey(gmsgFlashlight), HUDMSG_IMMEDIATE);
+		m_HudQueue.WriteByte(1);
+		m_HudQueue.WriteByte(m_iFlashBattery);
+		m_HudQueue.End();
 
 		m_flFlashLightTime = FLASH_DRAIN_TIME + gpGlobals->time;
 	}
@@ -3253,10 +3253,10 @@ void CBasePlayer::FlashlightTurnOff()
 {
 	EMIT_SOUND_DYN(ENT(pev), CHAN_WEAPON, SOUND_FLASHLIGHT_OFF, 1.0, ATTN_NORM, 0, PITCH_NORM);
 	ClearBits(pev->effects, EF_DIMLIGHT);
-	MESSAGE_BEGIN(MSG_ONE, gmsgFlashlight, NULL, pev);
-	WRITE_BYTE(0);
-	WRITE_BYTE(m_iFlashBattery);
-	MESSAGE_END();
+	m_HudQueue.Begin(pev, gmsgFlashlight, HudMessageKey(gmsgFlashlight), HUDMSG_IMMEDIATE);
+	m_HudQueue.WriteByte(0);
+	m_HudQueue.WriteByte(m_iFlashBattery);
+	m_HudQueue.End();
 
 	m_flFlashLightTime = FLASH_CHARGE_TIME + gpGlobals->time;
 }
@@ -3785,10 +3785,10 @@ void CBasePlayer::SendAmmoUpdate()
 			ASSERT(m_rgAmmo[i] < 255);
 
 			// send "Ammo" update message
-			MESSAGE_BEGIN(MSG_ONE, gmsgAmmoX, NULL, pev);
-			WRITE_BYTE(i);
-			WRITE_BYTE(V_max(V_min(m_rgAmmo[i], 254), 0)); // clamp the value to one byte
-			MESSAGE_END();
+			m_HudQueue.Begin(pev, gmsgAmmoX, HudMessageKey(gmsgAmmoX, i), HUDMSG_WEAPONS);
+			m_HudQueue.WriteByte(i);
+			m_HudQueue.WriteByte(V_max(V_min(m_rgAmmo[i], 254), 0)); // clamp the value to one byte
+			m_HudQueue.End();
 		}
 	}
 }
@@ -3813,6 +3813,10 @@ void CBasePlayer::UpdateClientData()
 		m_fInitHUD = false;
 		gInitHUD = false;
 
+		// anything still queued from before the respawn has to reach the client ahead of the
+		// reset, not land on the fresh HUD later
+		m_HudQueue.Flush(0);
+
 		MESSAGE_BEGIN(MSG_ONE, gmsgResetHUD, NULL, pev);
 		WRITE_BYTE(0);
 		MESSAGE_END();
@@ -3840,18 +3844,18 @@ void CBasePlayer::UpdateClientData()
 
 	if (m_iHideHUD != m_iClientHideHUD)
 	{
-		MESSAGE_BEGIN(MSG_ONE, gmsgHideWeapon, NULL, pev);
-		WRITE_BYTE(m_iHideHUD);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgHideWeapon, HudMessageKey(gmsgHideWeapon), HUDMSG_CONTROL);
+		m_HudQueue.WriteByte(m_iHideHUD);
+		m_HudQueue.End();
 
 		m_iClientHideHUD = m_iHideHUD;
 	}
 
 	if (m_iFOV != m_iClientFOV)
 	{
-		MESSAGE_BEGIN(MSG_ONE, gmsgSetFOV, NULL, pev);
-		WRITE_BYTE(m_iFOV);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgSetFOV, HudMessageKey(gmsgSetFOV), HUDMSG_CONTROL);
+		m_HudQueue.WriteByte(m_iFOV);
+		m_HudQueue.End();
 
 		// cache FOV change at end of function, so weapon updates can see that FOV has changed
 	}
@@ -3873,9 +3877,9 @@ void CBasePlayer::UpdateClientData()
 			iHealth = 1;
 
 		// send "health" update message
-		MESSAGE_BEGIN(MSG_ONE, gmsgHealth, NULL, pev);
-		WRITE_SHORT(iHealth);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgHealth, HudMessageKey(gmsgHealth), HUDMSG_VITAL);
+		m_HudQueue.WriteShort(iHealth);
+		m_HudQueue.End();
 
 		m_iClientHealth = pev->health;
 	}
@@ -3887,9 +3891,9 @@ void CBasePlayer::UpdateClientData()
 
 		ASSERT(gmsgBattery > 0);
 		// send "health" update message
-		MESSAGE_BEGIN(MSG_ONE, gmsgBattery, NULL, pev);
-		WRITE_SHORT((int)pev->armorvalue);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgBattery, HudMessageKey(gmsgBattery), HUDMSG_VITAL);
+		m_HudQueue.WriteShort((int)pev->armorvalue);
+		m_HudQueue.End();
 	}
 
 	if (m_WeaponBits != m_ClientWeaponBits)
@@ -3899,10 +3903,10 @@ void CBasePlayer::UpdateClientData()
 		const int lowerBits = m_WeaponBits & 0xFFFFFFFF;
 		const int upperBits = (m_WeaponBits >> 32) & 0xFFFFFFFF;
 
-		MESSAGE_BEGIN(MSG_ONE, gmsgWeapons, nullptr, pev);
-		WRITE_LONG(lowerBits);
-		WRITE_LONG(upperBits);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgWeapons, HudMessageKey(gmsgWeapons), HUDMSG_WEAPONS);
+		m_HudQueue.WriteLong(lowerBits);
+		m_HudQueue.WriteLong(upperBits);
+		m_HudQueue.End();
 	}
 
 	if (0 != pev->dmg_take || 0 != pev->dmg_save || m_bitsHUDDamage != m_bitsDamageType)
@@ -3922,14 +3926,15 @@ void CBasePlayer::UpdateClientData()
 		// only send down damage type that have hud art
 		int visibleDamageBits = m_bitsDamageType & DMG_SHOWNHUD;
 
-		MESSAGE_BEGIN(MSG_ONE, gmsgDamage, NULL, pev);
-		WRITE_BYTE(pev->dmg_save);
-		WRITE_BYTE(pev->dmg_take);
-		WRITE_LONG(visibleDamageBits);
-		WRITE_COORD(damageOrigin.x);
-		WRITE_COORD(damageOrigin.y);
-		WRITE_COORD(damageOrigin.z);
-		MESSAGE_END();
+		// each damage message flashes the screen, so they are never merged
+		m_HudQueue.Begin(pev, gmsgDamage, HUDQUEUE_NOKEY, HUDMSG_VITAL);
+		m_HudQueue.WriteByte(pev->dmg_save);
+		m_HudQueue.WriteByte(pev->dmg_take);
+		m_HudQueue.WriteLong(visibleDamageBits);
+		m_HudQueue.WriteCoord(damageOrigin.x);
+		m_HudQueue.WriteCoord(damageOrigin.y);
+		m_HudQueue.WriteCoord(damageOrigin.z);
+		m_HudQueue.End();
 
 		pev->dmg_take = 0;
 		pev->dmg_save = 0;
@@ -3942,17 +3947,17 @@ void CBasePlayer::UpdateClientData()
 	if (m_bRestored)
 	{
 		//Always tell client about battery state
-		MESSAGE_BEGIN(MSG_ONE, gmsgFlashBattery, NULL, pev);
-		WRITE_BYTE(m_iFlashBattery);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgFlashBattery, HudMessageKey(gmsgFlashBattery), HUDMSG_VITAL);
+		m_HudQueue.WriteByte(m_iFlashBattery);
+		m_HudQueue.End();
 
 		//Tell client the flashlight is on
 		if (FlashlightIsOn())
 		{
-			MESSAGE_BEGIN(MSG_ONE, gmsgFlashlight, NULL, pev);
-			WRITE_BYTE(1);
-			WRITE_BYTE(m_iFlashBattery);
-			MESSAGE_END();
+			m_HudQueue.Begin(pev, gmsgFlashlight, HudMessageKey(gmsgFlashlight), HUDMSG_VITAL);
+			m_HudQueue.WriteByte(1);
+			m_HudQueue.WriteByte(m_iFlashBattery);
+			m_HudQueue.End();
 		}
 	}
 
@@ -3981,9 +3986,9 @@ void CBasePlayer::UpdateClientData()
 				m_flFlashLightTime = 0;
 		}
 
-		MESSAGE_BEGIN(MSG_ONE, gmsgFlashBattery, NULL, pev);
-		WRITE_BYTE(m_iFlashBattery);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgFlashBattery, HudMessageKey(gmsgFlashBattery), HUDMSG_VITAL);
+		m_HudQueue.WriteByte(m_iFlashBattery);
+		m_HudQueue.End();
 	}
 
 
@@ -3991,9 +3996,9 @@ void CBasePlayer::UpdateClientData()
 	{
 		ASSERT(gmsgTrain > 0);
 		// send "health" update message
-		MESSAGE_BEGIN(MSG_ONE, gmsgTrain, NULL, pev);
-		WRITE_BYTE(m_iTrain & 0xF);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgTrain, HudMessageKey(gmsgTrain), HUDMSG_VITAL);
+		m_HudQueue.WriteByte(m_iTrain & 0xF);
+		m_HudQueue.End();
 
 		m_iTrain &= ~TRAIN_NEW;
 	}
@@ -4034,17 +4039,17 @@ void CBasePlayer::UpdateClientData()
 			else
 				pszName = II.pszName;
 
-			MESSAGE_BEGIN(MSG_ONE, gmsgWeaponList, NULL, pev);
-			WRITE_STRING(pszName);				   // string	weapon name
-			WRITE_BYTE(GetAmmoIndex(II.pszAmmo1)); // byte		Ammo Type
-			WRITE_BYTE(II.iMaxAmmo1);			   // byte     Max Ammo 1
-			WRITE_BYTE(GetAmmoIndex(II.pszAmmo2)); // byte		Ammo2 Type
-			WRITE_BYTE(II.iMaxAmmo2);			   // byte     Max Ammo 2
-			WRITE_BYTE(II.iSlot);				   // byte		bucket
-			WRITE_BYTE(II.iPosition);			   // byte		bucket pos
-			WRITE_BYTE(II.iId);					   // byte		id (bit index into m_WeaponBits)
-			WRITE_BYTE(II.iFlags);				   // byte		Flags
-			MESSAGE_END();
+			m_HudQueue.Begin(pev, gmsgWeaponList, HudMessageKey(gmsgWeaponList, II.iId), HUDMSG_WEAPONS);
+			m_HudQueue.WriteString(pszName);					// string	weapon name
+			m_HudQueue.WriteByte(GetAmmoIndex(II.pszAmmo1));	// byte		Ammo Type
+			m_HudQueue.WriteByte(II.iMaxAmmo1);					// byte     Max Ammo 1
+			m_HudQueue.WriteByte(GetAmmoIndex(II.pszAmmo2));	// byte		Ammo2 Type
+			m_HudQueue.WriteByte(II.iMaxAmmo2);					// byte     Max Ammo 2
+			m_HudQueue.WriteByte(II.iSlot);						// byte		bucket
+			m_HudQueue.WriteByte(II.iPosition);					// byte		bucket pos
+			m_HudQueue.WriteByte(II.iId);						// byte		id (bit index into m_WeaponBits)
+			m_HudQueue.WriteByte(II.iFlags);					// byte		Flags
+			m_HudQueue.End();
 		}
 	}
 
@@ -4063,11 +4068,11 @@ void CBasePlayer::UpdateClientData()
 	if (pev->iuser1 == OBS_NONE && !m_pActiveItem && ((m_pClientActiveItem != m_pActiveItem) || fullHUDInitRequired))
 	{
 		//Tell ammo hud that we have no weapon selected
-		MESSAGE_BEGIN(MSG_ONE, gmsgCurWeapon, NULL, pev);
-		WRITE_BYTE(0);
-		WRITE_BYTE(0);
-		WRITE_BYTE(0);
-		MESSAGE_END();
+		m_HudQueue.Begin(pev, gmsgCurWeapon, HudMessageKey(gmsgCurWeapon, 0), HUDMSG_WEAPONS);
+		m_HudQueue.WriteByte(0);
+		m_HudQueue.WriteByte(0);
+		m_HudQueue.WriteByte(0);
+		m_HudQueue.End();
 	}
 
 	// Cache and client weapon change
@@ -4081,6 +4086,9 @@ void CBasePlayer::UpdateClientData()
 		m_flNextSBarUpdateTime = gpGlobals->time + 0.2;
 	}
 
+	// Send what fits in this frame's budget, the rest waits for the next frame
+	m_HudQueue.Flush((int)sv_hudbudget.value);
+
 	//Handled anything that needs resetting
 	m_bRestored = false;
 }
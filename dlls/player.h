@@ -16,6 +16,7 @@
 #pragma once
 
 #include "pm_materials.h"
+#include "hudqueue.h"
 
 
 #define PLAYER_FATAL_FALL_SPEED 1024															  // approx 60 feet
@@ -177,6 +178,7 @@ public:
 	int m_iClientHideHUD;
 	int m_iFOV;		  // field of view
 	int m_iClientFOV; // client's known FOV
+	CHudMessageQueue m_HudQueue; // HUD state messages waiting for bandwidth, not saved
 	// usable player items
 	CBasePlayerItem* m_rgpPlayerItems[MAX_ITEM_TYPES];
 	CBasePlayerItem* m_pActiveItem;
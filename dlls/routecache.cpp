@@ -0,0 +1,320 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// routecache.cpp - node path repair and node pair moves
+//
+// A repaired path is what's left of the old one from the
+// node nearest the monster, with the new goal at its end.
+// Both ends are held to the same line of sight test that
+// FindNearestNode makes; the nodes in between were linked
+// when the path was found. Repairs stop once the path is
+// ROUTECACHE_REPAIR_TIME old or the goal has wandered too
+// far from where it was built for, and the next one is
+// built from scratch.
+//
+// Node pairs are keyed on the monster's size rather than
+// its node hull, CheckLocalMove walks the real bounding
+// box. Blocked pairs are kept for ROUTECACHE_PAIR_TIME
+// seconds, clear ones only as long as the move cache keeps
+// its results, and either only while no brush entity has
+// moved, which is tracked by the move cache; with
+// ai_movecache off they aren't kept at all. Moves stopped
+// by anything other than the world or a brush aren't kept,
+// and neither are clear ones with a monster or a player
+// standing anywhere along them, since a monster's check
+// never sees its own body and the next one to ask might
+// have to walk through it.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "monsters.h"
+#include "nodes.h"
+#include "game.h"
+#include "movecache.h"
+#include "routecache.h"
+
+#define ROUTECACHE_REPAIR_TIME 2.0	// seconds before a path has to be found again
+#define ROUTECACHE_REPAIR_DIST 128	// furthest the goal may move from what the path was built for
+#define ROUTECACHE_PAIR_SLOTS 4096 // must be a power of two
+#define ROUTECACHE_PAIR_TIME 10.0	// blocked by the world or a brush
+#define ROUTECACHE_PAIR_CLEAR_TIME 1.0 // clear, the same as the move cache
+
+typedef struct
+{
+	int from;
+	int to;
+	int mins[3];
+	int maxs[3];
+	int flags;		 // FL_FLY and FL_SWIM
+	int heightCheck; // CheckLocalMove only compares heights if the target is on the ground, or there is none
+} pairkey_t;
+
+typedef struct
+{
+	pairkey_t key;
+	int generation; // 0 if the slot is empty
+	float time;
+	int result;
+} pairentry_t;
+
+typedef struct
+{
+	int builds;
+	int repairs;
+	int repairsFailed;
+	int pairLookups;
+	int pairHits;
+} routestats_t;
+
+static pairentry_t g_RoutePairs[ROUTECACHE_PAIR_SLOTS];
+static routestats_t g_RouteStats;
+
+static const Vector& RouteCache_NodeOrigin(int iNode)
+{
+	return WorldGraph.m_pNodes[iNode].m_vecOriginPeek;
+}
+
+//=========================================================
+// RouteCache_Repair
+//=========================================================
+bool RouteCache_Repair(CBaseMonster* pMonster, const Vector& vecDest, int iHull, int* iPath, int* pcNodes)
+{
+	nodepath_t* path = &pMonster->m_NodePath;
+	TraceResult tr;
+	int i, iNearest;
+	float flNearest;
+
+	if (0 == ai_routerepair.value || 0 == path->cNodes || 0 == WorldGraph.m_fGraphPresent || 0 == WorldGraph.m_fGraphPointersSet)
+		return false;
+
+	if (path->iHull != iHull || path->afCapability != pMonster->m_afCapability)
+		return false;
+
+	if (gpGlobals->time < path->flTime || gpGlobals->time - path->flTime > ROUTECACHE_REPAIR_TIME)
+		return false;
+
+	if ((vecDest - path->vecBuiltGoal).Length() > ROUTECACHE_REPAIR_DIST)
+		return false;
+
+	for (i = 0; i < path->cNodes; i++)
+	{
+		if (path->iNodes[i] < 0 || path->iNodes[i] >= WorldGraph.m_cNodes)
+			return false;
+	}
+
+	// pick the path up again at the node nearest the monster
+	iNearest = 0;
+	flNearest = (pMonster->pev->origin - RouteCache_NodeOrigin(path->iNodes[0])).Length();
+
+	for (i = 1; i < path->cNodes; i++)
+	{
+		const float flDist = (pMonster->pev->origin - RouteCache_NodeOrigin(path->iNodes[i])).Length();
+
+		if (flDist < flNearest)
+		{
+			iNearest = i;
+			flNearest = flDist;
+		}
+	}
+
+	UTIL_TraceLine(pMonster->pev->origin, RouteCache_NodeOrigin(path->iNodes[iNearest]), ignore_monsters, 0, &tr);
+
+	if (tr.flFraction == 1.0)
+		UTIL_TraceLine(vecDest, RouteCache_NodeOrigin(path->iNodes[path->cNodes - 1]), ignore_monsters, 0, &tr);
+
+	if (tr.flFraction != 1.0)
+	{
+		g_RouteStats.repairsFailed++;
+		return false;
+	}
+
+	// what's left is the path now, still as old as when it was found
+	path->cNodes -= iNearest;
+	memmove(path->iNodes, path->iNodes + iNearest, sizeof(path->iNodes[0]) * path->cNodes);
+
+	memcpy(iPath, path->iNodes, sizeof(path->iNodes[0]) * path->cNodes);
+	*pcNodes = path->cNodes;
+
+	g_RouteStats.repairs++;
+	return true;
+}
+
+//=========================================================
+// RouteCache_Store - a path FindShortestPath just found.
+//=========================================================
+void RouteCache_Store(CBaseMonster* pMonster, const Vector& vecDest, int iHull, const int* iPath, int cNodes)
+{
+	nodepath_t* path = &pMonster->m_NodePath;
+
+	path->cNodes = V_min(cNodes, MAX_PATH_SIZE);
+	memcpy(path->iNodes, iPath, sizeof(path->iNodes[0]) * path->cNodes);
+	path->iHull = iHull;
+	path->afCapability = pMonster->m_afCapability;
+	path->vecBuiltGoal = vecDest;
+	path->flTime = gpGlobals->time;
+
+	g_RouteStats.builds++;
+}
+
+static pairentry_t* RouteCache_Pair(CBaseMonster* pMonster, int iFrom, int iTo, CBaseEntity* pTarget, pairkey_t* pkey)
+{
+	memset(pkey, 0, sizeof(*pkey));
+
+	pkey->from = iFrom;
+	pkey->to = iTo;
+
+	for (int i = 0; i < 3; i++)
+	{
+		pkey->mins[i] = (int)floor(pMonster->pev->mins[i]);
+		pkey->maxs[i] = (int)floor(pMonster->pev->maxs[i]);
+	}
+
+	pkey->flags = pMonster->pev->flags & (FL_FLY | FL_SWIM | FL_MONSTERCLIP);
+	pkey->heightCheck = (!pTarget || (pTarget->pev->flags & FL_ONGROUND) != 0) ? 1 : 0;
+
+	const byte* p = (const byte*)pkey;
+	unsigned int hash = 2166136261u;
+
+	for (int i = 0; i < (int)sizeof(*pkey); i++)
+	{
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return &g_RoutePairs[hash & (ROUTECACHE_PAIR_SLOTS - 1)];
+}
+
+//=========================================================
+// RouteCache_PairOccupied - whether anything solid that
+// isn't a brush overlaps the box the monster sweeps going
+// from one node to the other, the monster itself included.
+//=========================================================
+static bool RouteCache_PairOccupied(CBaseMonster* pMonster, int iFrom, int iTo)
+{
+	const Vector& vecFrom = WorldGraph.m_pNodes[iFrom].m_vecOrigin;
+	const Vector& vecTo = WorldGraph.m_pNodes[iTo].m_vecOrigin;
+	Vector mins, maxs;
+	edict_t* pEdict = INDEXENT(0);
+
+	for (int i = 0; i < 3; i++)
+	{
+		mins[i] = V_min(vecFrom[i], vecTo[i]) + pMonster->pev->mins[i];
+		maxs[i] = V_max(vecFrom[i], vecTo[i]) + pMonster->pev->maxs[i];
+	}
+
+	for (int i = 1; i < gpGlobals->maxEntities; i++)
+	{
+		const edict_t* ent = pEdict + i;
+
+		if (0 != ent->free || (ent->v.solid != SOLID_BBOX && ent->v.solid != SOLID_SLIDEBOX))
+			continue;
+
+		if (mins.x > ent->v.absmax.x || mins.y > ent->v.absmax.y || mins.z > ent->v.absmax.z ||
+			maxs.x < ent->v.absmin.x || maxs.y < ent->v.absmin.y || maxs.z < ent->v.absmin.z)
+			continue;
+
+		return true;
+	}
+
+	return false;
+}
+
+//=========================================================
+// RouteCache_PairLookup
+//=========================================================
+bool RouteCache_PairLookup(CBaseMonster* pMonster, int iFrom, int iTo, CBaseEntity* pTarget, int* piResult)
+{
+	if (0 == ai_routerepair.value || 0 == ai_movecache.value)
+		return false;
+
+	pairkey_t key;
+	const pairentry_t* pentry = RouteCache_Pair(pMonster, iFrom, iTo, pTarget, &key);
+
+	g_RouteStats.pairLookups++;
+
+	if (pentry->generation != MoveCache_Generation() || 0 != memcmp(&pentry->key, &key, sizeof(key)))
+		return false;
+
+	const float flLifetime = pentry->result == LOCALMOVE_VALID ? ROUTECACHE_PAIR_CLEAR_TIME : ROUTECACHE_PAIR_TIME;
+
+	if (gpGlobals->time < pentry->time || gpGlobals->time - pentry->time > flLifetime)
+		return false;
+
+	*piResult = pentry->result;
+
+	g_RouteStats.pairHits++;
+	return true;
+}
+
+//=========================================================
+// RouteCache_PairStore - right after the CheckLocalMove,
+// while trace_ent still holds whatever blocked it.
+//=========================================================
+void RouteCache_PairStore(CBaseMonster* pMonster, int iFrom, int iTo, CBaseEntity* pTarget, int iResult)
+{
+	if (0 == ai_routerepair.value || 0 == ai_movecache.value)
+		return;
+
+	const edict_t* pBlocker = gpGlobals->trace_ent;
+
+	// a monster or a player in the way will be somewhere else soon
+	if (iResult == LOCALMOVE_INVALID && !FNullEnt(pBlocker) && pBlocker->v.solid != SOLID_BSP)
+		return;
+
+	// it may only have been valid because the target was in the way
+	if (iResult == LOCALMOVE_VALID && pTarget && pBlocker == pTarget->edict())
+		return;
+
+	if (iResult == LOCALMOVE_VALID && RouteCache_PairOccupied(pMonster, iFrom, iTo))
+		return;
+
+	pairkey_t key;
+	pairentry_t* pentry = RouteCache_Pair(pMonster, iFrom, iTo, pTarget, &key);
+
+	pentry->key = key;
+	pentry->generation = MoveCache_Generation();
+	pentry->time = gpGlobals->time;
+	pentry->result = iResult;
+}
+
+void RouteCache_Reset()
+{
+	memset(g_RoutePairs, 0, sizeof(g_RoutePairs));
+}
+
+//=========================================================
+// RouteCache_Stats - "ai_routecache_stats [reset]" server
+// command.
+//=========================================================
+static void RouteCache_Stats()
+{
+	const routestats_t* s = &g_RouteStats;
+	const int paths = s->builds + s->repairs;
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("ai_routecache_stats: %d node paths, %d repaired (%.1f%%), %d repairs failed the sight checks\n",
+		paths, s->repairs, 0 != paths ? 100.0f * s->repairs / paths : 0.0f, s->repairsFailed));
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  node pair moves: %d looked up, %d from the cache (%.1f%%)\n",
+		s->pairLookups, s->pairHits, 0 != s->pairLookups ? 100.0f * s->pairHits / s->pairLookups : 0.0f));
+
+	if (CMD_ARGC() > 1 && 0 == stricmp(CMD_ARGV(1), "reset"))
+		memset(&g_RouteStats, 0, sizeof(g_RouteStats));
+}
+
+void RouteCache_Init()
+{
+	g_engfuncs.pfnAddServerCommand("ai_routecache_stats", RouteCache_Stats);
+}
@@ -0,0 +1,50 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+
+#pragma once
+
+//=========================================================
+// routecache.h - the node path behind a monster's route,
+// kept so that a chase whose goal only moved a little can
+// reuse it instead of finding the nearest nodes and the
+// shortest path again, and node to node local moves that
+// RouteSimplify checked, shared by monsters of one size.
+//=========================================================
+
+class CBaseMonster;
+class CBaseEntity;
+
+typedef struct
+{
+	int iNodes[MAX_PATH_SIZE]; // the whole path, m_Route only holds the first ROUTE_SIZE
+	int cNodes;				   // 0 if there is no path
+	int iHull;
+	int afCapability;
+	Vector vecBuiltGoal; // what FindShortestPath found it for, repairs don't move it
+	float flTime;	// when it was built, repairs don't renew it
+	bool fFresh;	// m_Route still holds iNodes from the start, as FGetNodeRoute left it
+} nodepath_t;
+
+void RouteCache_Init();
+void RouteCache_Reset(); // node numbers mean nothing on the next map
+
+// Fills iPath with what's left of the monster's last node path if that still leads to vecDest
+bool RouteCache_Repair(CBaseMonster* pMonster, const Vector& vecDest, int iHull, int* iPath, int* pcNodes);
+void RouteCache_Store(CBaseMonster* pMonster, const Vector& vecDest, int iHull, const int* iPath, int cNodes);
+
+// CheckLocalMove between the origins of two nodes
+bool RouteCache_PairLookup(CBaseMonster* pMonster, int iFrom, int iTo, CBaseEntity* pTarget, int* piResult);
+void RouteCache_PairStore(CBaseMonster* pMonster, int iFrom, int iTo, CBaseEntity* pTarget, int iResult);
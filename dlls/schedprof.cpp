@@ -0,0 +1,450 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// schedprof.cpp - schedule and task profiling
+//
+// Classes are told apart by classname, schedules by their
+// Schedule_t and tasks by number, so a monster's own tasks
+// show up as "custom" plus how far past LAST_COMMON_TASK
+// they are. The tables are fixed in size; anything that
+// doesn't fit is only counted as dropped.
+//
+// A task's traces and route builds are whatever calls
+// UTIL_TraceLine, UTIL_TraceHull and BuildRoute made while
+// it ran, including those of anything it called.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "monsters.h"
+#include "game.h"
+#include "schedprof.h"
+#include "perf_counter.h"
+
+#define SCHEDPROF_CLASSES 64
+#define SCHEDPROF_TASKS 2048	 // must be a power of two
+#define SCHEDPROF_SCHEDULES 1024 // must be a power of two
+#define SCHEDPROF_LINES 24		 // of each table in the report
+
+typedef struct
+{
+	char name[32];
+	int thinks;
+	int changes;
+	int thrash;	   // thinks that went through more than one schedule
+	int loopLimit; // thinks that gave up after ten
+	double time;
+} profclass_t;
+
+typedef struct
+{
+	int iClass;
+	int task;
+	int calls; // 0 if the slot is empty
+	int traces;
+	int routes;
+	double time;
+} proftask_t;
+
+typedef struct
+{
+	int iClass;
+	const Schedule_t* pSchedule; // NULL if the slot is empty
+	int entries;
+	int done;
+	int failed;
+	int interrupted;
+} profschedule_t;
+
+static const char* g_pszSharedTasks[LAST_COMMON_TASK] =
+{
+	"TASK_INVALID",
+	"TASK_WAIT",
+	"TASK_WAIT_FACE_ENEMY",
+	"TASK_WAIT_PVS",
+	"TASK_SUGGEST_STATE",
+	"TASK_WALK_TO_TARGET",
+	"TASK_RUN_TO_TARGET",
+	"TASK_MOVE_TO_TARGET_RANGE",
+	"TASK_GET_PATH_TO_ENEMY",
+	"TASK_GET_PATH_TO_ENEMY_LKP",
+	"TASK_GET_PATH_TO_ENEMY_CORPSE",
+	"TASK_GET_PATH_TO_LEADER",
+	"TASK_GET_PATH_TO_SPOT",
+	"TASK_GET_PATH_TO_TARGET",
+	"TASK_GET_PATH_TO_HINTNODE",
+	"TASK_GET_PATH_TO_LASTPOSITION",
+	"TASK_GET_PATH_TO_BESTSOUND",
+	"TASK_GET_PATH_TO_BESTSCENT",
+	"TASK_RUN_PATH",
+	"TASK_WALK_PATH",
+	"TASK_STRAFE_PATH",
+	"TASK_CLEAR_MOVE_WAIT",
+	"TASK_STORE_LASTPOSITION",
+	"TASK_CLEAR_LASTPOSITION",
+	"TASK_PLAY_ACTIVE_IDLE",
+	"TASK_FIND_HINTNODE",
+	"TASK_CLEAR_HINTNODE",
+	"TASK_SMALL_FLINCH",
+	"TASK_FACE_IDEAL",
+	"TASK_FACE_ROUTE",
+	"TASK_FACE_ENEMY",
+	"TASK_FACE_HINTNODE",
+	"TASK_FACE_TARGET",
+	"TASK_FACE_LASTPOSITION",
+	"TASK_RANGE_ATTACK1",
+	"TASK_RANGE_ATTACK2",
+	"TASK_MELEE_ATTACK1",
+	"TASK_MELEE_ATTACK2",
+	"TASK_RELOAD",
+	"TASK_RANGE_ATTACK1_NOTURN",
+	"TASK_RANGE_ATTACK2_NOTURN",
+	"TASK_MELEE_ATTACK1_NOTURN",
+	"TASK_MELEE_ATTACK2_NOTURN",
+	"TASK_RELOAD_NOTURN",
+	"TASK_SPECIAL_ATTACK1",
+	"TASK_SPECIAL_ATTACK2",
+	"TASK_CROUCH",
+	"TASK_STAND",
+	"TASK_GUARD",
+	"TASK_STEP_LEFT",
+	"TASK_STEP_RIGHT",
+	"TASK_STEP_FORWARD",
+	"TASK_STEP_BACK",
+	"TASK_DODGE_LEFT",
+	"TASK_DODGE_RIGHT",
+	"TASK_SOUND_ANGRY",
+	"TASK_SOUND_DEATH",
+	"TASK_SET_ACTIVITY",
+	"TASK_SET_SCHEDULE",
+	"TASK_SET_FAIL_SCHEDULE",
+	"TASK_CLEAR_FAIL_SCHEDULE",
+	"TASK_PLAY_SEQUENCE",
+	"TASK_PLAY_SEQUENCE_FACE_ENEMY",
+	"TASK_PLAY_SEQUENCE_FACE_TARGET",
+	"TASK_SOUND_IDLE",
+	"TASK_SOUND_WAKE",
+	"TASK_SOUND_PAIN",
+	"TASK_SOUND_DIE",
+	"TASK_FIND_COVER_FROM_BEST_SOUND",
+	"TASK_FIND_COVER_FROM_ENEMY",
+	"TASK_FIND_LATERAL_COVER_FROM_ENEMY",
+	"TASK_FIND_NODE_COVER_FROM_ENEMY",
+	"TASK_FIND_NEAR_NODE_COVER_FROM_ENEMY",
+	"TASK_FIND_FAR_NODE_COVER_FROM_ENEMY",
+	"TASK_FIND_COVER_FROM_ORIGIN",
+	"TASK_EAT",
+	"TASK_DIE",
+	"TASK_WAIT_FOR_SCRIPT",
+	"TASK_PLAY_SCRIPT",
+	"TASK_ENABLE_SCRIPT",
+	"TASK_PLANT_ON_SCRIPT",
+	"TASK_FACE_SCRIPT",
+	"TASK_WAIT_RANDOM",
+	"TASK_WAIT_INDEFINITE",
+	"TASK_STOP_MOVING",
+	"TASK_TURN_LEFT",
+	"TASK_TURN_RIGHT",
+	"TASK_REMEMBER",
+	"TASK_FORGET",
+	"TASK_WAIT_FOR_MOVEMENT",
+};
+
+static CPerformanceCounter g_SchedProfTimer;
+
+static profclass_t g_ProfClasses[SCHEDPROF_CLASSES];
+static int g_cProfClasses;
+static proftask_t g_ProfTasks[SCHEDPROF_TASKS];
+static profschedule_t g_ProfSchedules[SCHEDPROF_SCHEDULES];
+static int g_cProfDropped;
+
+static int SchedProf_Class(CBaseMonster* pMonster)
+{
+	const char* pszName = STRING(pMonster->pev->classname);
+	int i;
+
+	// copied, the string itself goes away with the map
+	for (i = 0; i < g_cProfClasses; i++)
+	{
+		if (0 == strncmp(g_ProfClasses[i].name, pszName, sizeof(g_ProfClasses[i].name) - 1))
+			return i;
+	}
+
+	if (g_cProfClasses == SCHEDPROF_CLASSES)
+	{
+		g_cProfDropped++;
+		return -1;
+	}
+
+	strncpy(g_ProfClasses[i].name, pszName, sizeof(g_ProfClasses[i].name) - 1);
+	return g_cProfClasses++;
+}
+
+static proftask_t* SchedProf_Task(int iClass, int iTask)
+{
+	unsigned int hash = (unsigned int)(iClass * 131 + iTask) * 2654435761u;
+
+	for (int i = 0; i < SCHEDPROF_TASKS; i++)
+	{
+		proftask_t* p = &g_ProfTasks[(hash + i) & (SCHEDPROF_TASKS - 1)];
+
+		if (0 == p->calls)
+		{
+			p->iClass = iClass;
+			p->task = iTask;
+			return p;
+		}
+
+		if (p->iClass == iClass && p->task == iTask)
+			return p;
+	}
+
+	g_cProfDropped++;
+	return NULL;
+}
+
+static profschedule_t* SchedProf_Schedule(int iClass, const Schedule_t* pSchedule)
+{
+	unsigned int hash = ((unsigned int)iClass * 131 + (unsigned int)((size_t)pSchedule >> 4)) * 2654435761u;
+
+	for (int i = 0; i < SCHEDPROF_SCHEDULES; i++)
+	{
+		profschedule_t* p = &g_ProfSchedules[(hash + i) & (SCHEDPROF_SCHEDULES - 1)];
+
+		if (!p->pSchedule)
+		{
+			p->iClass = iClass;
+			p->pSchedule = pSchedule;
+			return p;
+		}
+
+		if (p->iClass == iClass && p->pSchedule == pSchedule)
+			return p;
+	}
+
+	g_cProfDropped++;
+	return NULL;
+}
+
+//=========================================================
+// SchedProf_Begin - marks where a task or a schedule pick
+// starts. Does nothing unless ai_schedprof is set, and
+// then the matching End doesn't either.
+//=========================================================
+void SchedProf_Begin(schedprofmark_t* pmark)
+{
+	if (0 == ai_schedprof.value)
+	{
+		pmark->time = -1;
+		return;
+	}
+
+	pmark->time = g_SchedProfTimer.GetCurTime();
+	pmark->traces = g_cSchedProfTraces;
+	pmark->routes = g_cSchedProfRoutes;
+}
+
+//=========================================================
+// SchedProf_End
+//=========================================================
+void SchedProf_End(CBaseMonster* pMonster, int iTask, const schedprofmark_t* pmark)
+{
+	if (pmark->time < 0)
+		return;
+
+	const double flTime = g_SchedProfTimer.GetCurTime() - pmark->time;
+	const int iClass = SchedProf_Class(pMonster);
+
+	if (iClass < 0)
+		return;
+
+	g_ProfClasses[iClass].time += flTime;
+
+	proftask_t* p = SchedProf_Task(iClass, iTask);
+
+	if (!p)
+		return;
+
+	p->calls++;
+	p->time += flTime;
+	p->traces += g_cSchedProfTraces - pmark->traces;
+	p->routes += g_cSchedProfRoutes - pmark->routes;
+}
+
+//=========================================================
+// SchedProf_Change - the schedule being left is counted by
+// why: a failed task, running to the end, or anything else
+// in its interrupt mask.
+//=========================================================
+void SchedProf_Change(CBaseMonster* pMonster, Schedule_t* pNewSchedule)
+{
+	if (0 == ai_schedprof.value)
+		return;
+
+	const int iClass = SchedProf_Class(pMonster);
+
+	if (iClass < 0)
+		return;
+
+	g_ProfClasses[iClass].changes++;
+
+	profschedule_t* p;
+
+	if (pMonster->m_pSchedule && (p = SchedProf_Schedule(iClass, pMonster->m_pSchedule)) != NULL)
+	{
+		if (pMonster->HasConditions(bits_COND_TASK_FAILED))
+			p->failed++;
+		else if (pMonster->HasConditions(bits_COND_SCHEDULE_DONE))
+			p->done++;
+		else
+			p->interrupted++;
+	}
+
+	if (pNewSchedule && (p = SchedProf_Schedule(iClass, pNewSchedule)) != NULL)
+		p->entries++;
+}
+
+void SchedProf_Maintained(CBaseMonster* pMonster, int cChanges, bool fLoopLimit)
+{
+	if (0 == ai_schedprof.value)
+		return;
+
+	const int iClass = SchedProf_Class(pMonster);
+
+	if (iClass < 0)
+		return;
+
+	g_ProfClasses[iClass].thinks++;
+
+	if (cChanges > 1)
+		g_ProfClasses[iClass].thrash++;
+
+	if (fLoopLimit)
+		g_ProfClasses[iClass].loopLimit++;
+}
+
+static const char* SchedProf_TaskName(int iTask, char* szBuffer, int size)
+{
+	if (iTask == SCHEDPROF_SELECT)
+		return "(picking a schedule)";
+
+	if (iTask >= 0 && iTask < LAST_COMMON_TASK)
+		return g_pszSharedTasks[iTask];
+
+	snprintf(szBuffer, size, "custom %d", iTask - LAST_COMMON_TASK);
+	return szBuffer;
+}
+
+static int SchedProf_CompareClasses(const void* a, const void* b)
+{
+	const double ta = (*(const profclass_t**)a)->time;
+	const double tb = (*(const profclass_t**)b)->time;
+
+	return ta < tb ? 1 : (ta > tb ? -1 : 0);
+}
+
+static int SchedProf_CompareTasks(const void* a, const void* b)
+{
+	const double ta = (*(const proftask_t**)a)->time;
+	const double tb = (*(const proftask_t**)b)->time;
+
+	return ta < tb ? 1 : (ta > tb ? -1 : 0);
+}
+
+static int SchedProf_CompareSchedules(const void* a, const void* b)
+{
+	return (*(const profschedule_t**)b)->entries - (*(const profschedule_t**)a)->entries;
+}
+
+//=========================================================
+// SchedProf_Stats - "ai_schedprof_stats [reset]" server
+// command. Classes and tasks are sorted by time, schedules
+// by how often they were entered.
+//=========================================================
+static void SchedProf_Stats()
+{
+	static profclass_t* pClasses[SCHEDPROF_CLASSES];
+	static proftask_t* pTasks[SCHEDPROF_TASKS];
+	static profschedule_t* pSchedules[SCHEDPROF_SCHEDULES];
+	int i, c;
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("ai_schedprof_stats: ai_schedprof %g, %d dropped from full tables\n", ai_schedprof.value, g_cProfDropped));
+
+	for (i = 0; i < g_cProfClasses; i++)
+		pClasses[i] = &g_ProfClasses[i];
+
+	qsort(pClasses, g_cProfClasses, sizeof(pClasses[0]), SchedProf_CompareClasses);
+
+	g_engfuncs.pfnServerPrint("  class                           thinks  changes   thrash  gave up       ms\n");
+
+	for (i = 0; i < g_cProfClasses && i < SCHEDPROF_LINES; i++)
+	{
+		const profclass_t* p = pClasses[i];
+
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %-30s %7d %8d %8d %8d %8.2f\n", p->name, p->thinks, p->changes, p->thrash, p->loopLimit, p->time * 1000));
+	}
+
+	for (i = 0, c = 0; i < SCHEDPROF_TASKS; i++)
+	{
+		if (0 != g_ProfTasks[i].calls)
+			pTasks[c++] = &g_ProfTasks[i];
+	}
+
+	qsort(pTasks, c, sizeof(pTasks[0]), SchedProf_CompareTasks);
+
+	g_engfuncs.pfnServerPrint("  task                           class                  calls       ms   traces   routes\n");
+
+	for (i = 0; i < c && i < SCHEDPROF_LINES; i++)
+	{
+		const proftask_t* p = pTasks[i];
+		char szTask[32];
+
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %-30s %-20s %7d %8.2f %8d %8d\n",
+			SchedProf_TaskName(p->task, szTask, sizeof(szTask)), g_ProfClasses[p->iClass].name, p->calls, p->time * 1000, p->traces, p->routes));
+	}
+
+	for (i = 0, c = 0; i < SCHEDPROF_SCHEDULES; i++)
+	{
+		if (g_ProfSchedules[i].pSchedule)
+			pSchedules[c++] = &g_ProfSchedules[i];
+	}
+
+	qsort(pSchedules, c, sizeof(pSchedules[0]), SchedProf_CompareSchedules);
+
+	g_engfuncs.pfnServerPrint("  schedule                       class                entries     done   failed  interrupted\n");
+
+	for (i = 0; i < c && i < SCHEDPROF_LINES; i++)
+	{
+		const profschedule_t* p = pSchedules[i];
+
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %-30s %-20s %7d %8d %8d %8d\n",
+			p->pSchedule->pName ? p->pSchedule->pName : "?", g_ProfClasses[p->iClass].name, p->entries, p->done, p->failed, p->interrupted));
+	}
+
+	if (CMD_ARGC() > 1 && 0 == stricmp(CMD_ARGV(1), "reset"))
+	{
+		memset(g_ProfClasses, 0, sizeof(g_ProfClasses));
+		memset(g_ProfTasks, 0, sizeof(g_ProfTasks));
+		memset(g_ProfSchedules, 0, sizeof(g_ProfSchedules));
+		g_cProfClasses = 0;
+		g_cProfDropped = 0;
+	}
+}
+
+void SchedProf_Init()
+{
+	g_engfuncs.pfnAddServerCommand("ai_schedprof_stats", SchedProf_Stats);
+}
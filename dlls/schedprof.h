@@ -0,0 +1,52 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+
+#pragma once
+
+//=========================================================
+// schedprof.h - counts and times the schedule interpreter
+// per monster class while ai_schedprof is set: schedules
+// entered and how they ended, and the time, traces and
+// route builds of every task and of picking schedules.
+// "ai_schedprof_stats" prints the most expensive.
+//=========================================================
+
+#define SCHEDPROF_SELECT -1 // the "task" GetSchedule's time is counted against
+
+class CBaseMonster;
+struct Schedule_t;
+
+typedef struct
+{
+	double time;
+	int traces;
+	int routes;
+} schedprofmark_t;
+
+// UTIL_TraceLine, UTIL_TraceHull and BuildRoute calls, for the marks
+inline int g_cSchedProfTraces;
+inline int g_cSchedProfRoutes;
+
+void SchedProf_Init();
+
+void SchedProf_Begin(schedprofmark_t* pmark);
+void SchedProf_End(CBaseMonster* pMonster, int iTask, const schedprofmark_t* pmark);
+
+// from ChangeSchedule, before the conditions are cleared
+void SchedProf_Change(CBaseMonster* pMonster, Schedule_t* pNewSchedule);
+
+// from MaintainSchedule, how many schedules one think went through
+void SchedProf_Maintained(CBaseMonster* pMonster, int cChanges, bool fLoopLimit);
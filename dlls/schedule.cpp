@@ -25,6 +25,7 @@
 #include "nodes.h"
 #include "defaultai.h"
 #include "soundent.h"
+#include "schedprof.h"
 
 //=========================================================
 // FHaveSchedule - Returns true if monster's m_pSchedule
@@ -76,6 +77,8 @@ void CBaseMonster::ChangeSchedule(Schedule_t* pNewSchedule)
 {
 	ASSERT(pNewSchedule != NULL);
 
+	SchedProf_Change(this, pNewSchedule);
+
 	m_pSchedule = pNewSchedule;
 	m_iScheduleIndex = 0;
 	m_iTaskStatus = TASKSTATUS_NEW;
@@ -205,6 +208,8 @@ bool CBaseMonster::FScheduleValid()
 void CBaseMonster::MaintainSchedule()
 {
 	Schedule_t* pNewSchedule;
+	schedprofmark_t mark;
+	int cChanges = 0;
 	int i;
 
 	// UNDONE: Tune/fix this 10... This is just here so infinite loops are impossible
@@ -222,6 +227,9 @@ void CBaseMonster::MaintainSchedule()
 			// if the previous schedule was interrupted by a condition, GetIdealState will be
 			// called. Else, a schedule finished normally.
 
+			SchedProf_Begin(&mark);
+			cChanges++;
+
 			// Notify the monster that his schedule is changing
 			ScheduleChange();
 
@@ -260,6 +268,8 @@ void CBaseMonster::MaintainSchedule()
 					pNewSchedule = GetSchedule();
 				ChangeSchedule(pNewSchedule);
 			}
+
+			SchedProf_End(this, SCHEDPROF_SELECT, &mark);
 		}
 
 		if (m_iTaskStatus == TASKSTATUS_NEW)
@@ -267,7 +277,9 @@ void CBaseMonster::MaintainSchedule()
 			Task_t* pTask = GetTask();
 			ASSERT(pTask != NULL);
 			TaskBegin();
+			SchedProf_Begin(&mark);
 			StartTask(pTask);
+			SchedProf_End(this, pTask->iTask, &mark);
 		}
 
 		// UNDONE: Twice?!!!
@@ -284,9 +296,13 @@ void CBaseMonster::MaintainSchedule()
 	{
 		Task_t* pTask = GetTask();
 		ASSERT(pTask != NULL);
+		SchedProf_Begin(&mark);
 		RunTask(pTask);
+		SchedProf_End(this, pTask->iTask, &mark);
 	}
 
+	SchedProf_Maintained(this, cChanges, i == 10);
+
 	// UNDONE: We have to do this so that we have an animation set to blend to if RunTask changes the animation
 	// RunTask() will always change animations at the end of a script!
 	// Don't do this twice
@@ -21,6 +21,39 @@
 
 LINK_ENTITY_TO_CLASS(soundent, CSoundEnt);
 
+// the pool's blocks are kept from level to level, so a map only grows it as far as the last one did
+static CSound* g_pSoundBlocks[MAX_WORLD_SOUND_BLOCKS];
+static int g_cSoundBlocks;
+
+typedef struct
+{
+	int inserted;
+	int grown;
+	int evicted;
+	int dropped;
+	int peak; // most sounds active at once
+	int queries;
+	int examined; // sounds the queries handed back
+	int listed;	  // sounds in the active list at the time of those queries
+} soundstats_t;
+
+static soundstats_t g_SoundStats;
+
+static CSound& PoolSound(int iIndex)
+{
+	return g_pSoundBlocks[iIndex / MAX_WORLD_SOUNDS][iIndex % MAX_WORLD_SOUNDS];
+}
+
+static int SoundGridCell(float flCoord)
+{
+	return (int)floor(flCoord / SOUND_GRID_SIZE);
+}
+
+static int SoundGridBucket(int x, int y)
+{
+	return ((x * 73856093) ^ (y * 19349663)) & (SOUND_GRID_BUCKETS - 1);
+}
+
 //=========================================================
 // CSound - Clear - zeros all fields for a sound
 //=========================================================
@@ -32,6 +65,7 @@ void CSound::Clear()
 	m_flExpireTime = 0;
 	m_iNext = SOUNDLIST_EMPTY;
 	m_iNextAudible = 0;
+	m_iNextInCell = SOUNDLIST_EMPTY;
 }
 
 //=========================================================
@@ -100,9 +134,9 @@ void CSoundEnt::Think()
 
 	while (iSound != SOUNDLIST_EMPTY)
 	{
-		if (m_SoundPool[iSound].m_flExpireTime <= gpGlobals->time && m_SoundPool[iSound].m_flExpireTime != SOUND_NEVER_EXPIRE)
+		if (PoolSound(iSound).m_flExpireTime <= gpGlobals->time && PoolSound(iSound).m_flExpireTime != SOUND_NEVER_EXPIRE)
 		{
-			int iNext = m_SoundPool[iSound].m_iNext;
+			int iNext = PoolSound(iSound).m_iNext;
 
 			// move this sound back into the free list
 			FreeSound(iSound, iPreviousSound);
@@ -112,7 +146,7 @@ void CSoundEnt::Think()
 		else
 		{
 			iPreviousSound = iSound;
-			iSound = m_SoundPool[iSound].m_iNext;
+			iSound = PoolSound(iSound).m_iNext;
 		}
 	}
 
@@ -148,17 +182,85 @@ void CSoundEnt::FreeSound(int iSound, int iPrevious)
 		// iSound is not the head of the active list, so
 		// must fix the index for the Previous sound
 		//		pSoundEnt->m_SoundPool[ iPrevious ].m_iNext = m_SoundPool[ iSound ].m_iNext;
-		pSoundEnt->m_SoundPool[iPrevious].m_iNext = pSoundEnt->m_SoundPool[iSound].m_iNext;
+		PoolSound(iPrevious).m_iNext = PoolSound(iSound).m_iNext;
 	}
 	else
 	{
 		// the sound we're freeing IS the head of the active list.
-		pSoundEnt->m_iActiveSound = pSoundEnt->m_SoundPool[iSound].m_iNext;
+		pSoundEnt->m_iActiveSound = PoolSound(iSound).m_iNext;
 	}
 
 	// make iSound the head of the Free list.
-	pSoundEnt->m_SoundPool[iSound].m_iNext = pSoundEnt->m_iFreeSound;
+	PoolSound(iSound).m_iNext = pSoundEnt->m_iFreeSound;
 	pSoundEnt->m_iFreeSound = iSound;
+
+	pSoundEnt->m_cActiveSounds--;
+	pSoundEnt->m_fGridDirty = true; // can't unlink it from its bucket without walking it
+}
+
+//=========================================================
+// GrowPool - adds a block of sounds to the free list.
+//=========================================================
+bool CSoundEnt::GrowPool()
+{
+	if (g_cSoundBlocks == MAX_WORLD_SOUND_BLOCKS)
+	{
+		return false;
+	}
+
+	const int iFirst = g_cSoundBlocks * MAX_WORLD_SOUNDS;
+
+	g_pSoundBlocks[g_cSoundBlocks++] = new CSound[MAX_WORLD_SOUNDS];
+
+	for (int i = iFirst; i < iFirst + MAX_WORLD_SOUNDS; i++)
+	{
+		PoolSound(i).Clear();
+		PoolSound(i).m_iNext = i + 1;
+	}
+
+	PoolSound(iFirst + MAX_WORLD_SOUNDS - 1).m_iNext = m_iFreeSound;
+	m_iFreeSound = iFirst;
+
+	g_SoundStats.grown++;
+	return true;
+}
+
+//=========================================================
+// EvictSound - frees the active sound that would have
+// expired first. Returns false if every sound is a
+// player's reserved one or never expires.
+//=========================================================
+bool CSoundEnt::EvictSound()
+{
+	int iSound = m_iActiveSound;
+	int iPreviousSound = SOUNDLIST_EMPTY;
+	int iOldest = SOUNDLIST_EMPTY;
+	int iOldestPrevious = SOUNDLIST_EMPTY;
+
+	while (iSound != SOUNDLIST_EMPTY)
+	{
+		const CSound& sound = PoolSound(iSound);
+
+		if (iSound >= gpGlobals->maxClients && sound.m_flExpireTime != SOUND_NEVER_EXPIRE &&
+			(iOldest == SOUNDLIST_EMPTY || sound.m_flExpireTime < PoolSound(iOldest).m_flExpireTime))
+		{
+			iOldest = iSound;
+			iOldestPrevious = iPreviousSound;
+		}
+
+		iPreviousSound = iSound;
+		iSound = sound.m_iNext;
+	}
+
+	if (iOldest == SOUNDLIST_EMPTY)
+	{
+		return false;
+	}
+
+	FreeSound(iOldest, iOldestPrevious);
+
+	g_SoundStats.evicted++;
+	return true;
 }
 
 //=========================================================
@@ -169,7 +271,7 @@ int CSoundEnt::IAllocSound()
 {
 	int iNewSound;
 
-	if (m_iFreeSound == SOUNDLIST_EMPTY)
+	if (m_iFreeSound == SOUNDLIST_EMPTY && !GrowPool() && !EvictSound())
 	{
 		// no free sound!
 		ALERT(at_console, "Free Sound List is full!\n");
@@ -181,12 +283,15 @@ int CSoundEnt::IAllocSound()
 
 	iNewSound = m_iFreeSound; // copy the index of the next free sound
 
-	m_iFreeSound = m_SoundPool[m_iFreeSound].m_iNext; // move the index down into the free list.
+	m_iFreeSound = PoolSound(m_iFreeSound).m_iNext; // move the index down into the free list.
 
-	m_SoundPool[iNewSound].m_iNext = m_iActiveSound; // point the new sound at the top of the active list.
+	PoolSound(iNewSound).m_iNext = m_iActiveSound; // point the new sound at the top of the active list.
 
 	m_iActiveSound = iNewSound; // now make the new sound the top of the active list. You're done.
 
+	m_cActiveSounds++;
+	g_SoundStats.peak = V_max(g_SoundStats.peak, m_cActiveSounds);
+
 	return iNewSound;
 }
 
@@ -209,13 +314,129 @@ void CSoundEnt::InsertSound(int iType, const Vector& vecOrigin, int iVolume, flo
 	if (iThisSound == SOUNDLIST_EMPTY)
 	{
 		ALERT(at_console, "Could not AllocSound() for InsertSound() (DLL)\n");
+		g_SoundStats.dropped++;
 		return;
 	}
 
-	pSoundEnt->m_SoundPool[iThisSound].m_vecOrigin = vecOrigin;
-	pSoundEnt->m_SoundPool[iThisSound].m_iType = iType;
-	pSoundEnt->m_SoundPool[iThisSound].m_iVolume = iVolume;
-	pSoundEnt->m_SoundPool[iThisSound].m_flExpireTime = gpGlobals->time + flDuration;
+	PoolSound(iThisSound).m_vecOrigin = vecOrigin;
+	PoolSound(iThisSound).m_iType = iType;
+	PoolSound(iThisSound).m_iVolume = iVolume;
+	PoolSound(iThisSound).m_flExpireTime = gpGlobals->time + flDuration;
+
+	pSoundEnt->LinkToGrid(iThisSound);
+
+	g_SoundStats.inserted++;
+}
+
+//=========================================================
+// LinkToGrid - puts a sound at the head of the bucket for
+// the cell its origin is in.
+//=========================================================
+void CSoundEnt::LinkToGrid(int iSound)
+{
+	CSound& sound = PoolSound(iSound);
+	const int iBucket = SoundGridBucket(SoundGridCell(sound.m_vecOrigin.x), SoundGridCell(sound.m_vecOrigin.y));
+
+	sound.m_iNextInCell = m_iGrid[iBucket];
+	m_iGrid[iBucket] = iSound;
+
+	m_iGridMaxVolume = V_max(m_iGridMaxVolume, sound.m_iVolume);
+}
+
+//=========================================================
+// RebuildGrid - links every active sound but the players'
+// reserved ones into the grid again.
+//=========================================================
+void CSoundEnt::RebuildGrid()
+{
+	int i;
+
+	for (i = 0; i < SOUND_GRID_BUCKETS; i++)
+	{
+		m_iGrid[i] = SOUNDLIST_EMPTY;
+	}
+
+	m_iGridMaxVolume = 0;
+
+	for (i = m_iActiveSound; i != SOUNDLIST_EMPTY; i = PoolSound(i).m_iNext)
+	{
+		if (i >= gpGlobals->maxClients)
+		{
+			LinkToGrid(i);
+		}
+	}
+
+	m_fGridDirty = false;
+}
+
+//=========================================================
+// SoundsNear - the players' reserved sounds move with the
+// players, so they are always handed back; the rest come
+// from the cells within reach of the loudest sound in the
+// grid.
+//=========================================================
+int CSoundEnt::SoundsNear(const Vector& vecOrigin, float flSensitivity, int* piSounds, int iMaxSounds)
+{
+	int i;
+	int cSounds = 0;
+
+	if (!pSoundEnt)
+	{
+		return 0;
+	}
+
+	if (pSoundEnt->m_fGridDirty)
+	{
+		pSoundEnt->RebuildGrid();
+	}
+
+	for (i = 0; i < gpGlobals->maxClients && cSounds < iMaxSounds; i++)
+	{
+		piSounds[cSounds++] = i;
+	}
+
+	const float flReach = pSoundEnt->m_iGridMaxVolume * flSensitivity;
+	const int x0 = SoundGridCell(vecOrigin.x - flReach);
+	const int x1 = SoundGridCell(vecOrigin.x + flReach);
+	const int y0 = SoundGridCell(vecOrigin.y - flReach);
+	const int y1 = SoundGridCell(vecOrigin.y + flReach);
+
+	if ((x1 - x0 + 1) * (y1 - y0 + 1) > SOUND_GRID_BUCKETS)
+	{
+		// hears most of the map anyway
+		for (i = pSoundEnt->m_iActiveSound; i != SOUNDLIST_EMPTY && cSounds < iMaxSounds; i = PoolSound(i).m_iNext)
+		{
+			if (i >= gpGlobals->maxClients)
+			{
+				piSounds[cSounds++] = i;
+			}
+		}
+	}
+	else
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			for (int y = y0; y <= y1; y++)
+			{
+				// other cells hash into the same bucket too
+				for (i = pSoundEnt->m_iGrid[SoundGridBucket(x, y)]; i != SOUNDLIST_EMPTY && cSounds < iMaxSounds; i = PoolSound(i).m_iNextInCell)
+				{
+					const CSound& sound = PoolSound(i);
+
+					if (SoundGridCell(sound.m_vecOrigin.x) == x && SoundGridCell(sound.m_vecOrigin.y) == y)
+					{
+						piSounds[cSounds++] = i;
+					}
+				}
+			}
+		}
+	}
+
+	g_SoundStats.queries++;
+	g_SoundStats.examined += cSounds;
+	g_SoundStats.listed += pSoundEnt->m_cActiveSounds;
+
+	return cSounds;
 }
 
 //=========================================================
@@ -228,16 +449,31 @@ void CSoundEnt::Initialize()
 	int iSound;
 
 	m_cLastActiveSounds;
-	m_iFreeSound = 0;
+	m_iFreeSound = SOUNDLIST_EMPTY;
 	m_iActiveSound = SOUNDLIST_EMPTY;
+	m_cActiveSounds = 0;
 
-	for (i = 0; i < MAX_WORLD_SOUNDS; i++)
+	if (g_cSoundBlocks == 0)
+	{
+		GrowPool();
+	}
+
+	for (i = 0; i < g_cSoundBlocks * MAX_WORLD_SOUNDS; i++)
 	{ // clear all sounds, and link them into the free sound list.
-		m_SoundPool[i].Clear();
-		m_SoundPool[i].m_iNext = i + 1;
+		PoolSound(i).Clear();
+		PoolSound(i).m_iNext = i + 1;
 	}
 
-	m_SoundPool[i - 1].m_iNext = SOUNDLIST_EMPTY; // terminate the list here.
+	PoolSound(i - 1).m_iNext = SOUNDLIST_EMPTY; // terminate the list here.
+	m_iFreeSound = 0;
+
+	for (i = 0; i < SOUND_GRID_BUCKETS; i++)
+	{
+		m_iGrid[i] = SOUNDLIST_EMPTY;
+	}
+
+	m_iGridMaxVolume = 0;
+	m_fGridDirty = false;
 
 
 	// now reserve enough sounds for each client
@@ -251,7 +487,7 @@ void CSoundEnt::Initialize()
 			return;
 		}
 
-		pSoundEnt->m_SoundPool[iSound].m_flExpireTime = SOUND_NEVER_EXPIRE;
+		PoolSound(iSound).m_flExpireTime = SOUND_NEVER_EXPIRE;
 	}
 
 	if (CVAR_GET_FLOAT("displaysoundlist") == 1)
@@ -288,7 +524,7 @@ int CSoundEnt::ISoundsInList(int iListType)
 	{
 		i++;
 
-		iThisSound = m_SoundPool[iThisSound].m_iNext;
+		iThisSound = PoolSound(iThisSound).m_iNext;
 	}
 
 	return i;
@@ -331,7 +567,7 @@ CSound* CSoundEnt::SoundPointerForIndex(int iIndex)
 		return NULL;
 	}
 
-	if (iIndex > (MAX_WORLD_SOUNDS - 1))
+	if (iIndex > (g_cSoundBlocks * MAX_WORLD_SOUNDS - 1))
 	{
 		ALERT(at_console, "SoundPointerForIndex() - Index too large!\n");
 		return NULL;
@@ -343,7 +579,7 @@ CSound* CSoundEnt::SoundPointerForIndex(int iIndex)
 		return NULL;
 	}
 
-	return &pSoundEnt->m_SoundPool[iIndex];
+	return &PoolSound(iIndex);
 }
 
 //=========================================================
@@ -364,4 +600,22 @@ int CSoundEnt::ClientSoundIndex(edict_t* pClient)
 #endif // _DEBUG
 
 	return iReturn;
-}
\ No newline at end of file
+}
+
+//=========================================================
+// SoundEnt_Stats - "soundent_stats [reset]" server command
+//=========================================================
+void SoundEnt_Stats()
+{
+	const soundstats_t* s = &g_SoundStats;
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("soundent_stats: pool %d of %d, %d active now, peak %d\n",
+		g_cSoundBlocks * MAX_WORLD_SOUNDS, MAX_WORLD_SOUNDS_LIMIT, pSoundEnt ? pSoundEnt->m_cActiveSounds : 0, s->peak));
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %d inserted, %d blocks added, %d evicted, %d dropped\n",
+		s->inserted, s->grown, s->evicted, s->dropped));
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %d listens looked at %.1f sounds each instead of %.1f\n",
+		s->queries, 0 != s->queries ? (float)s->examined / s->queries : 0.0f, 0 != s->queries ? (float)s->listed / s->queries : 0.0f));
+
+	if (CMD_ARGC() > 1 && 0 == stricmp(CMD_ARGV(1), "reset"))
+		memset(&g_SoundStats, 0, sizeof(g_SoundStats));
+}
@@ -19,9 +19,21 @@
 // Soundent.h - the entity that spawns when the world
 // spawns, and handles the world's active and free sound
 // lists.
+//
+// The pool grows a block at a time when the free list runs
+// out, and once it can't grow any more the sound closest to
+// expiring makes room for the new one. Sounds are also
+// hashed into a grid on their origins so that a listening
+// monster only looks at the cells it could hear anything
+// in.
 //=========================================================
 
-#define MAX_WORLD_SOUNDS 64 // maximum number of sounds handled by the world at one time.
+#define MAX_WORLD_SOUNDS 64		  // sounds in each block of the pool
+#define MAX_WORLD_SOUND_BLOCKS 16 // the pool never grows past this many blocks
+#define MAX_WORLD_SOUNDS_LIMIT (MAX_WORLD_SOUNDS * MAX_WORLD_SOUND_BLOCKS) // maximum number of sounds handled by the world at one time.
+
+#define SOUND_GRID_SIZE 512	   // width of a grid cell
+#define SOUND_GRID_BUCKETS 256 // cells are hashed into this many lists, must be a power of two
 
 #define bits_SOUND_NONE 0
 #define bits_SOUND_COMBAT (1 << 0)	// gunshots, explosions
@@ -56,6 +68,7 @@ public:
 	float m_flExpireTime; // when the sound should be purged from the list
 	int m_iNext;		  // index of next sound in this list ( Active or Free )
 	int m_iNextAudible;	  // temporary link that monsters use to build a list of audible sounds
+	int m_iNextInCell;	  // next sound in the same grid bucket
 
 	bool FIsSound();
 	bool FIsScent();
@@ -81,6 +94,9 @@ public:
 	static CSound* SoundPointerForIndex(int iIndex); // return a pointer for this index in the sound list
 	static int ClientSoundIndex(edict_t* pClient);
 
+	// fills piSounds with the sounds a listener at vecOrigin might hear, the caller still checks the distance
+	static int SoundsNear(const Vector& vecOrigin, float flSensitivity, int* piSounds, int iMaxSounds);
+
 	bool IsEmpty() { return m_iActiveSound == SOUNDLIST_EMPTY; }
 	int ISoundsInList(int iListType);
 	int IAllocSound();
@@ -90,9 +106,19 @@ public:
 	int m_iActiveSound;		 // indes of the first sound in the active sound list
 	int m_cLastActiveSounds; // keeps track of the number of active sounds at the last update. (for diagnostic work)
 	bool m_fShowReport;		 // if true, dump information about free/active sounds.
+	int m_cActiveSounds;
 
 private:
-	CSound m_SoundPool[MAX_WORLD_SOUNDS];
+	bool GrowPool();
+	bool EvictSound();
+	void LinkToGrid(int iSound);
+	void RebuildGrid();
+
+	int m_iGrid[SOUND_GRID_BUCKETS]; // heads of the bucket lists, players' reserved sounds aren't in them
+	int m_iGridMaxVolume;			 // loudest sound in the grid
+	bool m_fGridDirty;				 // sounds were freed, rebuild before the next query
 };
 
+void SoundEnt_Stats();
+
 inline CSoundEnt* pSoundEnt;
@@ -43,6 +43,79 @@ TYPEDESCRIPTION CSquadMonster::m_SaveData[] =
 
 IMPLEMENT_SAVERESTORE(CSquadMonster, CBaseMonster);
 
+#define MAX_SQUAD_RECRUITS 256 // squad monsters looked at in one SquadRecruit
+
+static CSquadMonster* g_pSquadMonsters; // head of the list of every squad monster
+static int g_iSquadGeneration = 1;
+
+CSquadMonster::CSquadMonster()
+{
+	m_pNextSquadMonster = g_pSquadMonsters;
+	if (g_pSquadMonsters)
+		g_pSquadMonsters->m_pPrevSquadMonster = this;
+	g_pSquadMonsters = this;
+}
+
+CSquadMonster::~CSquadMonster()
+{
+	if (m_pPrevSquadMonster)
+		m_pPrevSquadMonster->m_pNextSquadMonster = m_pNextSquadMonster;
+	else
+		g_pSquadMonsters = m_pNextSquadMonster;
+
+	if (m_pNextSquadMonster)
+		m_pNextSquadMonster->m_pPrevSquadMonster = m_pPrevSquadMonster;
+
+	// boards may still point at this one
+	SquadChanged();
+}
+
+//=========================================================
+// SquadChanged
+//=========================================================
+void CSquadMonster::SquadChanged()
+{
+	g_iSquadGeneration++;
+}
+
+//=========================================================
+// SquadBoard - the squad as of this frame. Member origins
+// are where they were when it was built, and a member that
+// picked a new enemy of its own shows up as a split the
+// next frame.
+//=========================================================
+const squadboard_t& CSquadMonster::SquadBoard()
+{
+	CSquadMonster* pSquadLeader = MySquadLeader();
+	squadboard_t& board = pSquadLeader->m_SquadBoard;
+
+	if (board.generation == g_iSquadGeneration && board.time == gpGlobals->time)
+		return board;
+
+	CBaseEntity* pEnemy = pSquadLeader->m_hEnemy;
+
+	board.time = gpGlobals->time;
+	board.generation = g_iSquadGeneration;
+	board.count = 0;
+	board.fEnemySplit = false;
+
+	for (int i = 0; i < MAX_SQUAD_MEMBERS; i++)
+	{
+		CSquadMonster* pMember = pSquadLeader->MySquadMember(i);
+		if (pMember)
+		{
+			board.pMembers[board.count] = pMember;
+			board.vecOrigins[board.count] = pMember->pev->origin;
+			board.count++;
+
+			if (pMember->m_hEnemy != NULL && pMember->m_hEnemy != pEnemy)
+				board.fEnemySplit = true;
+		}
+	}
+
+	return board;
+}
+
 
 //=========================================================
 // OccupySlot - if any slots of the passed slots are
@@ -178,6 +251,7 @@ void CSquadMonster::SquadRemove(CSquadMonster* pRemove)
 	}
 
 	pRemove->m_hSquadLeader = NULL;
+	SquadChanged();
 }
 
 //=========================================================
@@ -197,6 +271,7 @@ bool CSquadMonster::SquadAdd(CSquadMonster* pAdd)
 		{
 			m_hSquadMember[i] = pAdd;
 			pAdd->m_hSquadLeader = this;
+			SquadChanged();
 			return true;
 		}
 	}
@@ -251,27 +326,27 @@ void CSquadMonster::SquadMakeEnemy(CBaseEntity* pEnemy)
 		return;
 	}
 
-	CSquadMonster* pSquadLeader = MySquadLeader();
-	for (int i = 0; i < MAX_SQUAD_MEMBERS; i++)
+	const squadboard_t& board = SquadBoard();
+	for (int i = 0; i < board.count; i++)
 	{
-		CSquadMonster* pMember = pSquadLeader->MySquadMember(i);
-		if (pMember)
+		CSquadMonster* pMember = board.pMembers[i];
+
+		// reset members who aren't activly engaged in fighting
+		if (pMember->m_hEnemy != pEnemy && !pMember->HasConditions(bits_COND_SEE_ENEMY))
 		{
-			// reset members who aren't activly engaged in fighting
-			if (pMember->m_hEnemy != pEnemy && !pMember->HasConditions(bits_COND_SEE_ENEMY))
+			if (pMember->m_hEnemy != NULL)
 			{
-				if (pMember->m_hEnemy != NULL)
-				{
-					// remember their current enemy
-					pMember->PushEnemy(pMember->m_hEnemy, pMember->m_vecEnemyLKP);
-				}
-				// give them a new enemy
-				pMember->m_hEnemy = pEnemy;
-				pMember->m_vecEnemyLKP = pEnemy->pev->origin;
-				pMember->SetConditions(bits_COND_NEW_ENEMY);
+				// remember their current enemy
+				pMember->PushEnemy(pMember->m_hEnemy, pMember->m_vecEnemyLKP);
 			}
+			// give them a new enemy
+			pMember->m_hEnemy = pEnemy;
+			pMember->m_vecEnemyLKP = pEnemy->pev->origin;
+			pMember->SetConditions(bits_COND_NEW_ENEMY);
 		}
 	}
+
+	SquadChanged();
 }
 
 
@@ -286,15 +361,12 @@ int CSquadMonster::SquadCount()
 	if (!InSquad())
 		return 0;
 
-	CSquadMonster* pSquadLeader = MySquadLeader();
-	int squadCount = 0;
-	for (int i = 0; i < MAX_SQUAD_MEMBERS; i++)
-	{
-		if (pSquadLeader->MySquadMember(i) != NULL)
-			squadCount++;
-	}
+	return SquadBoard().count;
+}
 
-	return squadCount;
+static int SquadRecruitCompare(const void* a, const void* b)
+{
+	return (*(CSquadMonster* const*)a)->edict() - (*(CSquadMonster* const*)b)->edict();
 }
 
 
@@ -347,9 +419,27 @@ int CSquadMonster::SquadRecruit(int searchRadius, int maxMembers)
 	}
 	else
 	{
-		while ((pEntity = UTIL_FindEntityInSphere(pEntity, pev->origin, searchRadius)) != NULL)
+		// only squad monsters can be recruited, so look through those instead of every entity
+		CSquadMonster* pRecruits[MAX_SQUAD_RECRUITS];
+		int cRecruits = 0;
+
+		for (CSquadMonster* pSquadMonster = g_pSquadMonsters; pSquadMonster && cRecruits < MAX_SQUAD_RECRUITS; pSquadMonster = pSquadMonster->m_pNextSquadMonster)
 		{
-			CSquadMonster* pRecruit = pEntity->MySquadMonsterPointer();
+			if (!pSquadMonster->pev || 0 != pSquadMonster->edict()->free)
+				continue;
+
+			if (!UTIL_BoxInSphere(pSquadMonster->pev->absmin, pSquadMonster->pev->absmax, pev->origin, searchRadius))
+				continue;
+
+			pRecruits[cRecruits++] = pSquadMonster;
+		}
+
+		// take them in edict order, as the sphere search did
+		qsort(pRecruits, cRecruits, sizeof(pRecruits[0]), SquadRecruitCompare);
+
+		for (int i = 0; i < cRecruits; i++)
+		{
+			CSquadMonster* pRecruit = pRecruits[i]->MySquadMonsterPointer();
 
 			if (pRecruit && pRecruit != this && pRecruit->IsAlive() && !pRecruit->m_pCine)
 			{
@@ -491,16 +581,15 @@ bool CSquadMonster::NoFriendlyFire()
 	ALERT ( at_console, "BackPlane: %f %f %f : %f\n", backPlane.m_vecNormal.x, backPlane.m_vecNormal.y, backPlane.m_vecNormal.z, backPlane.m_flDist );
 */
 
-	CSquadMonster* pSquadLeader = MySquadLeader();
-	for (int i = 0; i < MAX_SQUAD_MEMBERS; i++)
+	const squadboard_t& board = SquadBoard();
+	for (int i = 0; i < board.count; i++)
 	{
-		CSquadMonster* pMember = pSquadLeader->MySquadMember(i);
-		if (pMember && pMember != this)
+		if (board.pMembers[i] != this)
 		{
 
-			if (backPlane.PointInFront(pMember->pev->origin) &&
-				leftPlane.PointInFront(pMember->pev->origin) &&
-				rightPlane.PointInFront(pMember->pev->origin))
+			if (backPlane.PointInFront(board.vecOrigins[i]) &&
+				leftPlane.PointInFront(board.vecOrigins[i]) &&
+				rightPlane.PointInFront(board.vecOrigins[i]))
 			{
 				// this guy is in the check volume! Don't shoot!
 				return false;
@@ -566,18 +655,7 @@ bool CSquadMonster::SquadEnemySplit()
 	if (!InSquad())
 		return false;
 
-	CSquadMonster* pSquadLeader = MySquadLeader();
-	CBaseEntity* pEnemy = pSquadLeader->m_hEnemy;
-
-	for (int i = 0; i < MAX_SQUAD_MEMBERS; i++)
-	{
-		CSquadMonster* pMember = pSquadLeader->MySquadMember(i);
-		if (pMember != NULL && pMember->m_hEnemy != NULL && pMember->m_hEnemy != pEnemy)
-		{
-			return true;
-		}
-	}
-	return false;
+	return SquadBoard().fEnemySplit;
 }
 
 //=========================================================
@@ -590,12 +668,11 @@ bool CSquadMonster::SquadMemberInRange(const Vector& vecLocation, float flDist)
 	if (!InSquad())
 		return false;
 
-	CSquadMonster* pSquadLeader = MySquadLeader();
+	const squadboard_t& board = SquadBoard();
 
-	for (int i = 0; i < MAX_SQUAD_MEMBERS; i++)
+	for (int i = 0; i < board.count; i++)
 	{
-		CSquadMonster* pSquadMember = pSquadLeader->MySquadMember(i);
-		if (nullptr != pSquadMember && (vecLocation - pSquadMember->pev->origin).Length2D() <= flDist)
+		if ((vecLocation - board.vecOrigins[i]).Length2D() <= flDist)
 			return true;
 	}
 	return false;
@@ -53,6 +53,24 @@
 
 #define MAX_SQUAD_MEMBERS 5
 
+class CSquadMonster;
+
+//=========================================================
+// squadboard_t - what a squad's members share for a frame.
+// The leader builds it the first time anyone asks for it
+// in a frame, or after the squad or its enemy changed, so
+// members don't each walk the squad for it.
+//=========================================================
+typedef struct
+{
+	float time;		// gpGlobals->time it was built at
+	int generation; // g_iSquadGeneration it was built at
+	int count;
+	CSquadMonster* pMembers[MAX_SQUAD_MEMBERS];
+	Vector vecOrigins[MAX_SQUAD_MEMBERS];
+	bool fEnemySplit; // not every member is fighting the leader's enemy
+} squadboard_t;
+
 //=========================================================
 // CSquadMonster - for any monster that forms squads.
 //=========================================================
@@ -69,6 +87,15 @@ public:
 	// squad member info
 	int m_iMySlot; // this is the behaviour slot that the monster currently holds in the squad.
 
+	squadboard_t m_SquadBoard; // valid only for leader
+
+	// every squad monster in the level, for recruiting
+	CSquadMonster* m_pNextSquadMonster;
+	CSquadMonster* m_pPrevSquadMonster;
+
+	CSquadMonster();
+	~CSquadMonster() override;
+
 	bool CheckEnemy(CBaseEntity* pEnemy) override;
 	void StartMonster() override;
 	void VacateSlot();
@@ -107,6 +134,8 @@ public:
 	void SquadCopyEnemyInfo();
 	bool SquadEnemySplit();
 	bool SquadMemberInRange(const Vector& vecLocation, float flDist);
+	const squadboard_t& SquadBoard();
+	static void SquadChanged(); // a squad's members or enemy changed, rebuild the boards
 
 	CSquadMonster* MySquadMonsterPointer() override { return this; }
 
@@ -0,0 +1,234 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// tracecache.cpp - per frame trace results
+//
+// The table is direct mapped on a hash of the exact start,
+// end, flags, hull and ignored edict; nothing is rounded,
+// so a hit is the trace the engine would have returned as
+// of the time it was stored. Every entry is dropped at the
+// start of a frame and whenever a brush entity is moved
+// with UTIL_SetOrigin. Brushes the engine pushes, and with
+// sv_tracecache 2 monsters, can still move between two
+// identical traces in the same frame, which is why this is
+// off by default.
+//
+// sv_tracecache 1 keeps only traces that ignore monsters,
+// 2 keeps them all.
+//=========================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "tracecache.h"
+
+#define TRACECACHE_SLOTS 1024 // must be a power of two
+#define TRACECACHE_CALLERS 16
+
+// plain data, so it can be cleared, hashed and compared byte for byte
+typedef struct
+{
+	float start[3];
+	float end[3];
+	int type;
+	int flags;
+	int hull;
+	edict_t* pentIgnore;
+} tracekey_t;
+
+typedef struct
+{
+	tracekey_t key;
+	int generation; // 0 if the slot is empty
+	TraceResult tr;
+} traceentry_t;
+
+typedef struct
+{
+	const char* name;
+	int traces;
+	int hits;
+} tracecaller_t;
+
+static traceentry_t g_TraceCache[TRACECACHE_SLOTS];
+static int g_iTraceGeneration = 1;
+
+static tracecaller_t g_TraceCallers[TRACECACHE_CALLERS];
+static int g_cTraceCallers;
+static int g_iTraceFlushes;
+
+static tracecaller_t* TraceCache_Caller()
+{
+	int i;
+
+	// callers are named with string literals, so the pointer is enough
+	for (i = 0; i < g_cTraceCallers; i++)
+	{
+		if (g_TraceCallers[i].name == g_pszTraceCaller)
+			return &g_TraceCallers[i];
+	}
+
+	if (g_cTraceCallers == TRACECACHE_CALLERS)
+		return &g_TraceCallers[0];
+
+	g_TraceCallers[g_cTraceCallers].name = g_pszTraceCaller;
+	return &g_TraceCallers[g_cTraceCallers++];
+}
+
+static void TraceCache_Key(int iType, const Vector& vecStart, const Vector& vecEnd, int fNoMonsters, int iHull, edict_t* pentIgnore, tracekey_t* pkey)
+{
+	memset(pkey, 0, sizeof(*pkey));
+
+	vecStart.CopyToArray(pkey->start);
+	vecEnd.CopyToArray(pkey->end);
+	pkey->type = iType;
+	pkey->flags = fNoMonsters;
+	pkey->hull = iHull;
+
+	// always part of the key, even when ignoring monsters: the engine also skips whatever the
+	// ignored edict owns, and that can be a brush
+	pkey->pentIgnore = pentIgnore;
+}
+
+static traceentry_t* TraceCache_Slot(const tracekey_t* pkey)
+{
+	const byte* p = (const byte*)pkey;
+	unsigned int hash = 2166136261u;
+
+	for (int i = 0; i < (int)sizeof(*pkey); i++)
+	{
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return &g_TraceCache[hash & (TRACECACHE_SLOTS - 1)];
+}
+
+static bool TraceCache_Enabled(int fNoMonsters)
+{
+	if (sv_tracecache.value >= 2)
+		return true;
+
+	return sv_tracecache.value >= 1 && (fNoMonsters & 1) != 0;
+}
+
+//=========================================================
+// TraceCache_Lookup - counts the trace against the current
+// caller, and fills ptr and the engine's trace globals if
+// the same trace was made earlier this frame.
+//=========================================================
+bool TraceCache_Lookup(int iType, const Vector& vecStart, const Vector& vecEnd, int fNoMonsters, int iHull, edict_t* pentIgnore, TraceResult* ptr)
+{
+	tracecaller_t* pCaller = TraceCache_Caller();
+
+	pCaller->traces++;
+
+	if (!TraceCache_Enabled(fNoMonsters))
+		return false;
+
+	tracekey_t key;
+	TraceCache_Key(iType, vecStart, vecEnd, fNoMonsters, iHull, pentIgnore, &key);
+
+	const traceentry_t* pentry = TraceCache_Slot(&key);
+
+	if (pentry->generation != g_iTraceGeneration || 0 != memcmp(&pentry->key, &key, sizeof(key)))
+		return false;
+
+	// what it hit has been removed since
+	if (pentry->tr.pHit && 0 != pentry->tr.pHit->free)
+		return false;
+
+	*ptr = pentry->tr;
+
+	gpGlobals->trace_allsolid = ptr->fAllSolid;
+	gpGlobals->trace_startsolid = ptr->fStartSolid;
+	gpGlobals->trace_inopen = ptr->fInOpen;
+	gpGlobals->trace_inwater = ptr->fInWater;
+	gpGlobals->trace_fraction = ptr->flFraction;
+	gpGlobals->trace_plane_dist = ptr->flPlaneDist;
+	gpGlobals->trace_ent = ptr->pHit;
+	gpGlobals->trace_endpos = ptr->vecEndPos;
+	gpGlobals->trace_plane_normal = ptr->vecPlaneNormal;
+	gpGlobals->trace_hitgroup = ptr->iHitgroup;
+
+	pCaller->hits++;
+	return true;
+}
+
+//=========================================================
+// TraceCache_Store
+//=========================================================
+void TraceCache_Store(int iType, const Vector& vecStart, const Vector& vecEnd, int fNoMonsters, int iHull, edict_t* pentIgnore, const TraceResult* ptr)
+{
+	if (!TraceCache_Enabled(fNoMonsters))
+		return;
+
+	tracekey_t key;
+	TraceCache_Key(iType, vecStart, vecEnd, fNoMonsters, iHull, pentIgnore, &key);
+
+	traceentry_t* pentry = TraceCache_Slot(&key);
+
+	memcpy(&pentry->key, &key, sizeof(key)); // with the padding, for the memcmp
+	pentry->generation = g_iTraceGeneration;
+	pentry->tr = *ptr;
+}
+
+void TraceCache_Flush()
+{
+	g_iTraceGeneration++;
+	g_iTraceFlushes++;
+}
+
+void TraceCache_Frame()
+{
+	g_iTraceGeneration++;
+}
+
+//=========================================================
+// TraceCache_Stats - "tracecache_stats [reset]" server
+// command.
+//=========================================================
+static void TraceCache_Stats()
+{
+	int i;
+	int traces = 0, hits = 0;
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("tracecache_stats: sv_tracecache %g, %d flushes from moved brushes\n", sv_tracecache.value, g_iTraceFlushes));
+	g_engfuncs.pfnServerPrint("  caller                 traces     hits\n");
+
+	for (i = 0; i < g_cTraceCallers; i++)
+	{
+		const tracecaller_t* c = &g_TraceCallers[i];
+
+		g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %-20s %8d %8d (%.1f%%)\n", c->name, c->traces, c->hits, 0 != c->traces ? 100.0f * c->hits / c->traces : 0.0f));
+		traces += c->traces;
+		hits += c->hits;
+	}
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("  %-20s %8d %8d (%.1f%%)\n", "total", traces, hits, 0 != traces ? 100.0f * hits / traces : 0.0f));
+
+	if (CMD_ARGC() > 1 && 0 == stricmp(CMD_ARGV(1), "reset"))
+	{
+		memset(g_TraceCallers, 0, sizeof(g_TraceCallers));
+		g_cTraceCallers = 0;
+		g_iTraceFlushes = 0;
+	}
+}
+
+void TraceCache_Init()
+{
+	g_engfuncs.pfnAddServerCommand("tracecache_stats", TraceCache_Stats);
+}
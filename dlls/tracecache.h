@@ -0,0 +1,54 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+//=========================================================
+// tracecache.h - results of UTIL_TraceLine and
+// UTIL_TraceHull kept for the rest of the frame, so that
+// monsters checking the same line of sight in one frame
+// only pay for one engine trace. Off unless sv_tracecache
+// is set.
+//=========================================================
+
+enum
+{
+	TRACECACHE_LINE = 0,
+	TRACECACHE_HULL,
+};
+
+// the caller that traces are counted against, see CTraceCaller
+inline const char* g_pszTraceCaller = "other";
+
+//=========================================================
+// CTraceCaller - names the traces made in its scope for
+// "tracecache_stats".
+//=========================================================
+class CTraceCaller
+{
+public:
+	CTraceCaller(const char* pszCaller) : m_pszPrevious(g_pszTraceCaller) { g_pszTraceCaller = pszCaller; }
+	~CTraceCaller() { g_pszTraceCaller = m_pszPrevious; }
+
+private:
+	const char* m_pszPrevious;
+};
+
+void TraceCache_Init();
+void TraceCache_Frame(); // from StartFrame
+void TraceCache_Flush(); // a brush entity moved
+
+bool TraceCache_Lookup(int iType, const Vector& vecStart, const Vector& vecEnd, int fNoMonsters, int iHull, edict_t* pentIgnore, TraceResult* ptr);
+void TraceCache_Store(int iType, const Vector& vecStart, const Vector& vecEnd, int fNoMonsters, int iHull, edict_t* pentIgnore, const TraceResult* ptr);
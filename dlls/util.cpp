@@ -31,6 +31,8 @@
 #include "weapons.h"
 #include "gamerules.h"
 #include "UserMessages.h"
+#include "tracecache.h"
+#include "schedprof.h"
 
 float UTIL_WeaponTimeBase()
 {
@@ -515,6 +517,65 @@ int UTIL_MonstersInSphere(CBaseEntity** pList, int listMax, const Vector& center
 }
 
 
+//=========================================================
+// UTIL_BoxInSphere - the engine measures from the nearest
+// point of the bounding box, not from its middle.
+//=========================================================
+bool UTIL_BoxInSphere(const Vector& absmin, const Vector& absmax, const Vector& center, float radius)
+{
+	const float radiusSquared = radius * radius;
+	float distance = 0;
+
+	for (int i = 0; i < 3 && distance <= radiusSquared; i++)
+	{
+		float delta;
+
+		if (center[i] < absmin[i])
+			delta = center[i] - absmin[i];
+		else if (center[i] > absmax[i])
+			delta = center[i] - absmax[i];
+		else
+			delta = 0;
+
+		distance += delta * delta;
+	}
+
+	return distance <= radiusSquared;
+}
+
+
+//=========================================================
+// UTIL_EdictsInSphere - one pass over the edicts instead of
+// a FIND_ENTITY_IN_SPHERE call per entity found. Player
+// slots count while a client is in them; the engine asks
+// its own client list.
+//=========================================================
+int UTIL_EdictsInSphere(edict_t** pList, int listMax, const Vector& center, float radius)
+{
+	edict_t* pEdict = g_engfuncs.pfnPEntityOfEntIndex(1);
+	int count = 0;
+
+	if (!pEdict)
+		return count;
+
+	for (int i = 1; i < gpGlobals->maxEntities && count < listMax; i++, pEdict++)
+	{
+		if (0 != pEdict->free || 0 == pEdict->v.classname)
+			continue;
+
+		if (i <= gpGlobals->maxClients && (pEdict->v.flags & FL_CLIENT) == 0)
+			continue;
+
+		if (!UTIL_BoxInSphere(pEdict->v.absmin, pEdict->v.absmax, center, radius))
+			continue;
+
+		pList[count++] = pEdict;
+	}
+
+	return count;
+}
+
+
 CBaseEntity* UTIL_FindEntityInSphere(CBaseEntity* pStartEntity, const Vector& vecCenter, float flRadius)
 {
 	edict_t* pentEntity;
@@ -541,7 +602,12 @@ CBaseEntity* UTIL_FindEntityByString(CBaseEntity* pStartEntity, const char* szKe
 	else
 		pentEntity = NULL;
 
-	pentEntity = FIND_ENTITY_BY_STRING(pentEntity, szKeyword, szValue);
+	if (0 == strcmp(szKeyword, "classname"))
+		pentEntity = FIND_ENTITY_BY_CLASSNAME(pentEntity, szValue);
+	else if (0 == strcmp(szKeyword, "targetname"))
+		pentEntity = FIND_ENTITY_BY_TARGETNAME(pentEntity, szValue);
+	else
+		pentEntity = FIND_ENTITY_BY_STRING(pentEntity, szKeyword, szValue);
 
 	if (!FNullEnt(pentEntity))
 		return CBaseEntity::Instance(pentEntity);
@@ -959,19 +1025,43 @@ void UTIL_ShowMessageAll(const char* pString)
 void UTIL_TraceLine(const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, IGNORE_GLASS ignoreGlass, edict_t* pentIgnore, TraceResult* ptr)
 {
 	//TODO: define constants
-	TRACE_LINE(vecStart, vecEnd, (igmon == ignore_monsters ? 1 : 0) | (ignore_glass == ignoreGlass ? 0x100 : 0), pentIgnore, ptr);
+	const int fNoMonsters = (igmon == ignore_monsters ? 1 : 0) | (ignore_glass == ignoreGlass ? 0x100 : 0);
+
+	g_cSchedProfTraces++;
+
+	if (TraceCache_Lookup(TRACECACHE_LINE, vecStart, vecEnd, fNoMonsters, 0, pentIgnore, ptr))
+		return;
+
+	TRACE_LINE(vecStart, vecEnd, fNoMonsters, pentIgnore, ptr);
+	TraceCache_Store(TRACECACHE_LINE, vecStart, vecEnd, fNoMonsters, 0, pentIgnore, ptr);
 }
 
 
 void UTIL_TraceLine(const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, edict_t* pentIgnore, TraceResult* ptr)
 {
-	TRACE_LINE(vecStart, vecEnd, (igmon == ignore_monsters ? 1 : 0), pentIgnore, ptr);
+	const int fNoMonsters = (igmon == ignore_monsters ? 1 : 0);
+
+	g_cSchedProfTraces++;
+
+	if (TraceCache_Lookup(TRACECACHE_LINE, vecStart, vecEnd, fNoMonsters, 0, pentIgnore, ptr))
+		return;
+
+	TRACE_LINE(vecStart, vecEnd, fNoMonsters, pentIgnore, ptr);
+	TraceCache_Store(TRACECACHE_LINE, vecStart, vecEnd, fNoMonsters, 0, pentIgnore, ptr);
 }
 
 
 void UTIL_TraceHull(const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, int hullNumber, edict_t* pentIgnore, TraceResult* ptr)
 {
-	TRACE_HULL(vecStart, vecEnd, (igmon == ignore_monsters ? 1 : 0), hullNumber, pentIgnore, ptr);
+	const int fNoMonsters = (igmon == ignore_monsters ? 1 : 0);
+
+	g_cSchedProfTraces++;
+
+	if (TraceCache_Lookup(TRACECACHE_HULL, vecStart, vecEnd, fNoMonsters, hullNumber, pentIgnore, ptr))
+		return;
+
+	TRACE_HULL(vecStart, vecEnd, fNoMonsters, hullNumber, pentIgnore, ptr);
+	TraceCache_Store(TRACECACHE_HULL, vecStart, vecEnd, fNoMonsters, hullNumber, pentIgnore, ptr);
 }
 
 void UTIL_TraceModel(const Vector& vecStart, const Vector& vecEnd, int hullNumber, edict_t* pentModel, TraceResult* ptr)
@@ -1014,7 +1104,12 @@ void UTIL_SetOrigin(entvars_t* pev, const Vector& vecOrigin)
 {
 	edict_t* ent = ENT(pev);
 	if (ent)
+	{
 		SET_ORIGIN(ent, vecOrigin);
+
+		if (pev->solid == SOLID_BSP)
+			TraceCache_Flush();
+	}
 }
 
 void UTIL_ParticleEffect(const Vector& vecOrigin, const Vector& vecDirection, unsigned int ulColor, unsigned int ulCount)
@@ -22,6 +22,7 @@
 //
 #include "activity.h"
 #include "enginecallback.h"
+#include "nameindex.h"
 
 inline void MESSAGE_BEGIN(int msg_dest, int msg_type, const float* pOrigin, entvars_t* ent); // implementation later in this file
 
@@ -33,12 +34,12 @@ inline globalvars_t* gpGlobals = nullptr;
 
 inline edict_t* FIND_ENTITY_BY_CLASSNAME(edict_t* entStart, const char* pszName)
 {
-	return FIND_ENTITY_BY_STRING(entStart, "classname", pszName);
+	return NameIndex_Find(entStart, NAMEINDEX_CLASSNAME, pszName);
 }
 
 inline edict_t* FIND_ENTITY_BY_TARGETNAME(edict_t* entStart, const char* pszName)
 {
-	return FIND_ENTITY_BY_STRING(entStart, "targetname", pszName);
+	return NameIndex_Find(entStart, NAMEINDEX_TARGETNAME, pszName);
 }
 
 // for doing a reverse lookup. Say you have a door, and want to find its button.
@@ -236,6 +237,10 @@ extern void UTIL_MakeVectors(const Vector& vecAngles);
 extern int UTIL_MonstersInSphere(CBaseEntity** pList, int listMax, const Vector& center, float radius);
 extern int UTIL_EntitiesInBox(CBaseEntity** pList, int listMax, const Vector& mins, const Vector& maxs, int flagMask);
 
+// The test FIND_ENTITY_IN_SPHERE makes, and everything it would return one call at a time, in the same order
+extern bool UTIL_BoxInSphere(const Vector& absmin, const Vector& absmax, const Vector& center, float radius);
+extern int UTIL_EdictsInSphere(edict_t** pList, int listMax, const Vector& center, float radius);
+
 inline void UTIL_MakeVectorsPrivate(const Vector& vecAngles, float* p_vForward, float* p_vRight, float* p_vUp)
 {
 	g_engfuncs.pfnAngleVectors(vecAngles, p_vForward, p_vRight, p_vUp);
@@ -677,11 +677,11 @@ bool CBasePlayerWeapon::UpdateClientData(CBasePlayer* pPlayer)
 
 	if (bSend)
 	{
-		MESSAGE_BEGIN(MSG_ONE, gmsgCurWeapon, NULL, pPlayer->pev);
-		WRITE_BYTE(state);
-		WRITE_BYTE(m_iId);
-		WRITE_BYTE(m_iClip);
-		MESSAGE_END();
+		pPlayer->m_HudQueue.Begin(pPlayer->pev, gmsgCurWeapon, HudMessageKey(gmsgCurWeapon, m_iId), HUDMSG_WEAPONS);
+		pPlayer->m_HudQueue.WriteByte(state);
+		pPlayer->m_HudQueue.WriteByte(m_iId);
+		pPlayer->m_HudQueue.WriteByte(m_iClip);
+		pPlayer->m_HudQueue.End();
 
 		m_iClientClip = m_iClip;
 		m_iClientWeaponState = state;
@@ -12,12 +12,39 @@
 #include "mathlib.h"
 #include "bsplib.h"
 
+/*
+=============
+CountBSPLumps
+
+Sets the lump counts PrintBSPFileSizes reports straight from the file,
+without copying any lump.
+=============
+*/
+void CountBSPLumps (bspview_t *view)
+{
+	BSPLumpView (view, LUMP_MODELS, sizeof(dmodel_t), &nummodels);
+	BSPLumpView (view, LUMP_VERTEXES, sizeof(dvertex_t), &numvertexes);
+	BSPLumpView (view, LUMP_PLANES, sizeof(dplane_t), &numplanes);
+	BSPLumpView (view, LUMP_LEAFS, sizeof(dleaf_t), &numleafs);
+	BSPLumpView (view, LUMP_NODES, sizeof(dnode_t), &numnodes);
+	BSPLumpView (view, LUMP_TEXINFO, sizeof(texinfo_t), &numtexinfo);
+	BSPLumpView (view, LUMP_CLIPNODES, sizeof(dclipnode_t), &numclipnodes);
+	BSPLumpView (view, LUMP_FACES, sizeof(dface_t), &numfaces);
+	BSPLumpView (view, LUMP_MARKSURFACES, sizeof(dmarksurfaces[0]), &nummarksurfaces);
+	BSPLumpView (view, LUMP_SURFEDGES, sizeof(dsurfedges[0]), &numsurfedges);
+	BSPLumpView (view, LUMP_EDGES, sizeof(dedge_t), &numedges);
+
+	BSPLumpView (view, LUMP_TEXTURES, 1, &texdatasize);
+	BSPLumpView (view, LUMP_VISIBILITY, 1, &visdatasize);
+	BSPLumpView (view, LUMP_LIGHTING, 1, &lightdatasize);
+	BSPLumpView (view, LUMP_ENTITIES, 1, &entdatasize);
+}
+
 void main (int argc, char **argv)
 {
 	int			i;
 	char		source[1024];
-	int			size;
-	FILE		*f;
+	bspview_t	view;
 
 	printf( "bspinfo.exe v2.1 (%s)\n", __DATE__ );
 	printf ("---- bspinfo ----\n" );
@@ -31,18 +58,13 @@ void main (int argc, char **argv)
 		printf ("---------------------\n");
 		strcpy (source, argv[i]);
 		DefaultExtension (source, ".bsp");
-		f = fopen (source, "rb");
-		if (f)
-		{
-			size = filelength (f);
-			fclose (f);
-		}
-		else
-			size = 0;
-		printf ("%s: %i\n", source, size);
-		
-		LoadBSPFile (source);		
+
+		OpenBSPView (source, &view);
+		printf ("%s: %i\n", source, view.length);
+
+		CountBSPLumps (&view);
 		PrintBSPFileSizes ();
+		CloseBSPView (&view);
 		printf ("---------------------\n");
 	}
 }
@@ -288,6 +288,7 @@ extern	int			dsurfedges[MAX_MAP_SURFEDGES];
 extern  int			dsurfedges_checksum;
 
 int FastChecksum(void *buffer, int bytes);
+int BSPChecksum (void);
 
 void DecompressVis (byte *in, byte *decompressed);
 int CompressVis (byte *vis, byte *dest);
@@ -296,6 +297,35 @@ void	LoadBSPFile (char *filename);
 void	WriteBSPFile (char *filename);
 void	PrintBSPFileSizes (void);
 
+// in place access to the lumps of a bsp file on disk. LoadBSPFile reads
+// through one of these instead of a whole-file copy, but still copies
+// every lump into the arrays above; readers that only look, like
+// bspinfo, can use the lumps where they are
+typedef struct
+{
+	dheader_t	header;		// swapped to native order
+	byte		*base;		// the whole file
+	int			length;
+	qboolean	loaded;		// read into memory instead of mapped
+	void		*file;		// WIN32 mapping handles
+	void		*mapping;
+} bspview_t;
+
+void	OpenBSPView (char *filename, bspview_t *view);
+void	*BSPLumpView (bspview_t *view, int lump, int size, int *count);
+void	CloseBSPView (bspview_t *view);
+
+// lump by lump output
+typedef struct
+{
+	FILE		*file;
+	dheader_t	header;
+} bspwriter_t;
+
+void	BeginBSPWrite (char *filename, bspwriter_t *writer);
+void	WriteBSPLump (bspwriter_t *writer, int lumpnum, void *data, int len);
+void	EndBSPWrite (bspwriter_t *writer);
+
 //===============
 
 
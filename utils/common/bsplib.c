@@ -13,6 +13,20 @@
 #include "bsplib.h"
 #include "scriplib.h"
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef _SGI_SOURCE
+#define	__BIG_ENDIAN__
+#endif
+
 //=============================================================================
 
 int			nummodels;
@@ -94,6 +108,37 @@ int FastChecksum(void *buffer, int bytes)
 	return checksum;
 }
 
+/*
+===============
+BSPChecksum
+
+Folds the lump checksums taken by LoadBSPFile into one value, so saved
+compile state can be matched against the bsp it was made from.
+===============
+*/
+int BSPChecksum (void)
+{
+	int	checksum = 0;
+
+	checksum = _rotl(checksum, 4) ^ dmodels_checksum;
+	checksum = _rotl(checksum, 4) ^ dvertexes_checksum;
+	checksum = _rotl(checksum, 4) ^ dplanes_checksum;
+	checksum = _rotl(checksum, 4) ^ dleafs_checksum;
+	checksum = _rotl(checksum, 4) ^ dnodes_checksum;
+	checksum = _rotl(checksum, 4) ^ texinfo_checksum;
+	checksum = _rotl(checksum, 4) ^ dclipnodes_checksum;
+	checksum = _rotl(checksum, 4) ^ dfaces_checksum;
+	checksum = _rotl(checksum, 4) ^ dmarksurfaces_checksum;
+	checksum = _rotl(checksum, 4) ^ dsurfedges_checksum;
+	checksum = _rotl(checksum, 4) ^ dedges_checksum;
+	checksum = _rotl(checksum, 4) ^ dtexdata_checksum;
+	checksum = _rotl(checksum, 4) ^ dvisdata_checksum;
+	checksum = _rotl(checksum, 4) ^ dlightdata_checksum;
+	checksum = _rotl(checksum, 4) ^ dentdata_checksum;
+
+	return checksum;
+}
+
 /*
 ===============
 CompressVis
@@ -323,21 +368,143 @@ void SwapBSPFile (qboolean todisk)
 }
 
 
-dheader_t	*header;
+//============================================================================
+
+/*
+
+  BSP files are read through a read only mapping of the whole file, and
+  each lump can be looked at in place as an array of its disk type.  Lump
+  data is little endian, so on little endian machines a view can be used
+  directly and nothing needs to be swapped.
 
-int CopyLump (int lump, void *dest, int size)
+*/
+
+/*
+=============
+OpenBSPView
+=============
+*/
+void OpenBSPView (char *filename, bspview_t *view)
+{
+	int		i;
+
+	memset (view, 0, sizeof(*view));
+
+#ifdef WIN32
+	view->file = CreateFile (filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (view->file == INVALID_HANDLE_VALUE)
+		Error ("Error opening %s", filename);
+	view->length = GetFileSize (view->file, NULL);
+	if (view->length > 0)
+	{
+		view->mapping = CreateFileMapping (view->file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (view->mapping)
+			view->base = MapViewOfFile (view->mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	{
+		int			fd;
+		struct stat	st;
+
+		fd = open (filename, O_RDONLY);
+		if (fd == -1)
+			Error ("Error opening %s: %s", filename, strerror(errno));
+		if (fstat (fd, &st) == -1)
+			Error ("Error reading %s: %s", filename, strerror(errno));
+		view->length = st.st_size;
+		if (view->length > 0)
+		{
+			view->base = mmap (NULL, view->length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (view->base == MAP_FAILED)
+				view->base = NULL;
+		}
+		close (fd);
+	}
+#endif
+
+	// fall back to reading the whole thing
+	if (!view->base)
+	{
+		CloseBSPView (view);
+		view->length = LoadFile (filename, (void **)&view->base);
+		view->loaded = true;
+	}
+
+	if (view->length < sizeof(dheader_t))
+		Error ("%s is not a bsp file", filename);
+
+// swap the header
+	memcpy (&view->header, view->base, sizeof(dheader_t));
+	for (i=0 ; i< sizeof(dheader_t)/4 ; i++)
+		((int *)&view->header)[i] = LittleLong ( ((int *)&view->header)[i]);
+
+	if (view->header.version != BSPVERSION)
+		Error ("%s is version %i, not %i", filename, view->header.version, BSPVERSION);
+}
+
+/*
+=============
+BSPLumpView
+
+Returns the lump in place and the number of size byte elements in it.
+The data is in disk (little endian) order.
+=============
+*/
+void *BSPLumpView (bspview_t *view, int lump, int size, int *count)
 {
 	int		length, ofs;
 
-	length = header->lumps[lump].filelen;
-	ofs = header->lumps[lump].fileofs;
-	
+	length = view->header.lumps[lump].filelen;
+	ofs = view->header.lumps[lump].fileofs;
+
+	if (length < 0 || ofs < 0 || ofs > view->length || length > view->length - ofs)
+		Error ("BSPLumpView: lump %i is outside the file", lump);
 	if (length % size)
-		Error ("LoadBSPFile: odd lump size");
-	
-	memcpy (dest, (byte *)header + ofs, length);
+		Error ("BSPLumpView: lump %i isn't a whole number of %i byte entries", lump, size);
 
-	return length / size;
+	*count = length / size;
+	return view->base + ofs;
+}
+
+/*
+=============
+CloseBSPView
+=============
+*/
+void CloseBSPView (bspview_t *view)
+{
+	if (view->loaded)
+		free (view->base);
+#ifdef WIN32
+	else if (view->base)
+		UnmapViewOfFile (view->base);
+	if (view->mapping)
+		CloseHandle (view->mapping);
+	if (view->file && view->file != INVALID_HANDLE_VALUE)
+		CloseHandle (view->file);
+	view->mapping = NULL;
+	view->file = NULL;
+#else
+	else if (view->base)
+		munmap (view->base, view->length);
+#endif
+	view->base = NULL;
+	view->loaded = false;
+}
+
+int CopyLump (bspview_t *view, int lump, void *dest, int size, int maxcount)
+{
+	int		count;
+	void	*data;
+
+	data = BSPLumpView (view, lump, size, &count);
+	if (count > maxcount)
+		Error ("LoadBSPFile: lump %i has %i entries, limit is %i", lump, count, maxcount);
+
+	memcpy (dest, data, count * size);
+
+	return count;
 }
 
 /*
@@ -347,43 +514,35 @@ LoadBSPFile
 */
 void	LoadBSPFile (char *filename)
 {
-	int			i;
+	bspview_t	view;
 	
-//
-// load the file header
-//
-	LoadFile (filename, (void **)&header);
-
-// swap the header
-	for (i=0 ; i< sizeof(dheader_t)/4 ; i++)
-		((int *)header)[i] = LittleLong ( ((int *)header)[i]);
-
-	if (header->version != BSPVERSION)
-		Error ("%s is version %i, not %i", filename, header->version, BSPVERSION);
-
-	nummodels = CopyLump (LUMP_MODELS, dmodels, sizeof(dmodel_t));
-	numvertexes = CopyLump (LUMP_VERTEXES, dvertexes, sizeof(dvertex_t));
-	numplanes = CopyLump (LUMP_PLANES, dplanes, sizeof(dplane_t));
-	numleafs = CopyLump (LUMP_LEAFS, dleafs, sizeof(dleaf_t));
-	numnodes = CopyLump (LUMP_NODES, dnodes, sizeof(dnode_t));
-	numtexinfo = CopyLump (LUMP_TEXINFO, texinfo, sizeof(texinfo_t));
-	numclipnodes = CopyLump (LUMP_CLIPNODES, dclipnodes, sizeof(dclipnode_t));
-	numfaces = CopyLump (LUMP_FACES, dfaces, sizeof(dface_t));
-	nummarksurfaces = CopyLump (LUMP_MARKSURFACES, dmarksurfaces, sizeof(dmarksurfaces[0]));
-	numsurfedges = CopyLump (LUMP_SURFEDGES, dsurfedges, sizeof(dsurfedges[0]));
-	numedges = CopyLump (LUMP_EDGES, dedges, sizeof(dedge_t));
-
-	texdatasize = CopyLump (LUMP_TEXTURES, dtexdata, 1);
-	visdatasize = CopyLump (LUMP_VISIBILITY, dvisdata, 1);
-	lightdatasize = CopyLump (LUMP_LIGHTING, dlightdata, 1);
-	entdatasize = CopyLump (LUMP_ENTITIES, dentdata, 1);
-
-	free (header);		// everything has been copied out
+	OpenBSPView (filename, &view);
+
+	nummodels = CopyLump (&view, LUMP_MODELS, dmodels, sizeof(dmodel_t), MAX_MAP_MODELS);
+	numvertexes = CopyLump (&view, LUMP_VERTEXES, dvertexes, sizeof(dvertex_t), MAX_MAP_VERTS);
+	numplanes = CopyLump (&view, LUMP_PLANES, dplanes, sizeof(dplane_t), MAX_MAP_PLANES);
+	numleafs = CopyLump (&view, LUMP_LEAFS, dleafs, sizeof(dleaf_t), MAX_MAP_LEAFS);
+	numnodes = CopyLump (&view, LUMP_NODES, dnodes, sizeof(dnode_t), MAX_MAP_NODES);
+	numtexinfo = CopyLump (&view, LUMP_TEXINFO, texinfo, sizeof(texinfo_t), MAX_MAP_TEXINFO);
+	numclipnodes = CopyLump (&view, LUMP_CLIPNODES, dclipnodes, sizeof(dclipnode_t), MAX_MAP_CLIPNODES);
+	numfaces = CopyLump (&view, LUMP_FACES, dfaces, sizeof(dface_t), MAX_MAP_FACES);
+	nummarksurfaces = CopyLump (&view, LUMP_MARKSURFACES, dmarksurfaces, sizeof(dmarksurfaces[0]), MAX_MAP_MARKSURFACES);
+	numsurfedges = CopyLump (&view, LUMP_SURFEDGES, dsurfedges, sizeof(dsurfedges[0]), MAX_MAP_SURFEDGES);
+	numedges = CopyLump (&view, LUMP_EDGES, dedges, sizeof(dedge_t), MAX_MAP_EDGES);
+
+	texdatasize = CopyLump (&view, LUMP_TEXTURES, dtexdata, 1, MAX_MAP_MIPTEX);
+	visdatasize = CopyLump (&view, LUMP_VISIBILITY, dvisdata, 1, MAX_MAP_VISIBILITY);
+	lightdatasize = CopyLump (&view, LUMP_LIGHTING, dlightdata, 1, MAX_MAP_LIGHTING);
+	entdatasize = CopyLump (&view, LUMP_ENTITIES, dentdata, 1, MAX_MAP_ENTSTRING);
+
+	CloseBSPView (&view);		// everything has been copied out
 		
+#ifdef __BIG_ENDIAN__
 //
 // swap everything
 //	
 	SwapBSPFile (false);
+#endif
 
 	dmodels_checksum = FastChecksum( dmodels, nummodels*sizeof(dmodels[0]) );
     dvertexes_checksum = FastChecksum( dvertexes, numvertexes*sizeof(dvertexes[0]) );
@@ -405,59 +564,91 @@ void	LoadBSPFile (char *filename)
 
 //============================================================================
 
-FILE		*wadfile;
-dheader_t	outheader;
+/*
+=============
+BeginBSPWrite
+
+Lumps are written one at a time straight from the caller's memory,
+the header goes in last.
+=============
+*/
+void BeginBSPWrite (char *filename, bspwriter_t *writer)
+{
+	memset (writer, 0, sizeof(*writer));
+	writer->header.version = LittleLong (BSPVERSION);
+
+	writer->file = SafeOpenWrite (filename);
+	SafeWrite (writer->file, &writer->header, sizeof(dheader_t));	// overwritten later
+}
+
+/*
+=============
+WriteBSPLump
 
-void AddLump (int lumpnum, void *data, int len)
+The data must already be in disk order
+=============
+*/
+void WriteBSPLump (bspwriter_t *writer, int lumpnum, void *data, int len)
 {
-	lump_t *lump;
+	lump_t	*lump;
+	static byte	pad[4];
 
-	lump = &header->lumps[lumpnum];
+	lump = &writer->header.lumps[lumpnum];
 	
-	lump->fileofs = LittleLong( ftell(wadfile) );
+	lump->fileofs = LittleLong( ftell(writer->file) );
 	lump->filelen = LittleLong(len);
-	SafeWrite (wadfile, data, (len+3)&~3);
+	SafeWrite (writer->file, data, len);
+	if (len & 3)
+		SafeWrite (writer->file, pad, 4 - (len & 3));
+}
+
+void EndBSPWrite (bspwriter_t *writer)
+{
+	fseek (writer->file, 0, SEEK_SET);
+	SafeWrite (writer->file, &writer->header, sizeof(dheader_t));
+	fclose (writer->file);
+	writer->file = NULL;
 }
 
 /*
 =============
 WriteBSPFile
 
-Swaps the bsp file in place, so it should not be referenced again
+The lumps are still valid after writing
 =============
 */
 void	WriteBSPFile (char *filename)
 {		
-	header = &outheader;
-	memset (header, 0, sizeof(dheader_t));
-	
-	SwapBSPFile (true);
+	bspwriter_t	writer;
 
-	header->version = LittleLong (BSPVERSION);
-	
-	wadfile = SafeOpenWrite (filename);
-	SafeWrite (wadfile, header, sizeof(dheader_t));	// overwritten later
-
-	AddLump (LUMP_PLANES, dplanes, numplanes*sizeof(dplane_t));
-	AddLump (LUMP_LEAFS, dleafs, numleafs*sizeof(dleaf_t));
-	AddLump (LUMP_VERTEXES, dvertexes, numvertexes*sizeof(dvertex_t));
-	AddLump (LUMP_NODES, dnodes, numnodes*sizeof(dnode_t));
-	AddLump (LUMP_TEXINFO, texinfo, numtexinfo*sizeof(texinfo_t));
-	AddLump (LUMP_FACES, dfaces, numfaces*sizeof(dface_t));
-	AddLump (LUMP_CLIPNODES, dclipnodes, numclipnodes*sizeof(dclipnode_t));
-	AddLump (LUMP_MARKSURFACES, dmarksurfaces, nummarksurfaces*sizeof(dmarksurfaces[0]));
-	AddLump (LUMP_SURFEDGES, dsurfedges, numsurfedges*sizeof(dsurfedges[0]));
-	AddLump (LUMP_EDGES, dedges, numedges*sizeof(dedge_t));
-	AddLump (LUMP_MODELS, dmodels, nummodels*sizeof(dmodel_t));
-
-	AddLump (LUMP_LIGHTING, dlightdata, lightdatasize);
-	AddLump (LUMP_VISIBILITY, dvisdata, visdatasize);
-	AddLump (LUMP_ENTITIES, dentdata, entdatasize);
-	AddLump (LUMP_TEXTURES, dtexdata, texdatasize);
+#ifdef __BIG_ENDIAN__
+	SwapBSPFile (true);
+#endif
+
+	BeginBSPWrite (filename, &writer);
+
+	WriteBSPLump (&writer, LUMP_PLANES, dplanes, numplanes*sizeof(dplane_t));
+	WriteBSPLump (&writer, LUMP_LEAFS, dleafs, numleafs*sizeof(dleaf_t));
+	WriteBSPLump (&writer, LUMP_VERTEXES, dvertexes, numvertexes*sizeof(dvertex_t));
+	WriteBSPLump (&writer, LUMP_NODES, dnodes, numnodes*sizeof(dnode_t));
+	WriteBSPLump (&writer, LUMP_TEXINFO, texinfo, numtexinfo*sizeof(texinfo_t));
+	WriteBSPLump (&writer, LUMP_FACES, dfaces, numfaces*sizeof(dface_t));
+	WriteBSPLump (&writer, LUMP_CLIPNODES, dclipnodes, numclipnodes*sizeof(dclipnode_t));
+	WriteBSPLump (&writer, LUMP_MARKSURFACES, dmarksurfaces, nummarksurfaces*sizeof(dmarksurfaces[0]));
+	WriteBSPLump (&writer, LUMP_SURFEDGES, dsurfedges, numsurfedges*sizeof(dsurfedges[0]));
+	WriteBSPLump (&writer, LUMP_EDGES, dedges, numedges*sizeof(dedge_t));
+	WriteBSPLump (&writer, LUMP_MODELS, dmodels, nummodels*sizeof(dmodel_t));
+
+	WriteBSPLump (&writer, LUMP_LIGHTING, dlightdata, lightdatasize);
+	WriteBSPLump (&writer, LUMP_VISIBILITY, dvisdata, visdatasize);
+	WriteBSPLump (&writer, LUMP_ENTITIES, dentdata, entdatasize);
+	WriteBSPLump (&writer, LUMP_TEXTURES, dtexdata, texdatasize);
 	
-	fseek (wadfile, 0, SEEK_SET);
-	SafeWrite (wadfile, header, sizeof(dheader_t));
-	fclose (wadfile);	
+	EndBSPWrite (&writer);
+
+#ifdef __BIG_ENDIAN__
+	SwapBSPFile (false);
+#endif
 }
 
 //============================================================================
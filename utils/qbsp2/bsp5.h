@@ -162,6 +162,7 @@ extern	node_t	outside_node;		// portals outside the world face this
 void AddPortalToNodes (portal_t *p, node_t *front, node_t *back);
 void RemovePortalFromNode (portal_t *portal, node_t *l);
 void MakeHeadnodePortals (node_t *node, vec3_t mins, vec3_t maxs);
+void FreePortals (node_t *node);
 
 void WritePortalfile (node_t *headnode);
 
@@ -228,6 +229,7 @@ extern	qboolean	leakonly;
 extern	qboolean	watervis;
 
 extern	int		subdivide_size;
+extern	int		splitsamples;
 
 extern	int		hullnum;
 
@@ -25,6 +25,7 @@ qboolean	leakonly;
 qboolean	watervis;
 
 int		subdivide_size = 240;
+int		splitsamples;		// split candidates tried per node, 0 = all
 
 char	bspfilename[1024];
 char	pointfilename[1024];
@@ -568,9 +569,11 @@ winding_t *NewWinding (int points)
 	if (points > MAX_POINTS_ON_WINDING)
 		Error ("NewWinding: %i points", points);
 	
+	ThreadLock ();
 	c_activewindings++;
 	if (c_activewindings > c_peakwindings)
 		c_peakwindings = c_activewindings;
+	ThreadUnlock ();
 
 	size = (int)((winding_t *)0)->points[points];
 	w = malloc (size);
@@ -582,7 +585,9 @@ winding_t *NewWinding (int points)
 
 void FreeWinding (winding_t *w)
 {
+	ThreadLock ();
 	c_activewindings--;
+	ThreadUnlock ();
 	free (w);
 }
 
@@ -597,9 +602,11 @@ face_t *AllocFace (void)
 {
 	face_t	*f;
 	
+	ThreadLock ();
 	c_activefaces++;
 	if (c_activefaces > c_peakfaces)
 		c_peakfaces = c_activefaces;
+	ThreadUnlock ();
 		
 	f = malloc (sizeof(face_t));
 	memset (f, 0, sizeof(face_t));
@@ -611,7 +618,9 @@ face_t *AllocFace (void)
 
 void FreeFace (face_t *f)
 {
+	ThreadLock ();
 	c_activefaces--;
+	ThreadUnlock ();
 	free (f);
 }
 
@@ -628,16 +637,20 @@ surface_t *AllocSurface (void)
 	s = malloc (sizeof(surface_t));
 	memset (s, 0, sizeof(surface_t));
 	
+	ThreadLock ();
 	c_activesurfaces++;
 	if (c_activesurfaces > c_peaksurfaces)
 		c_peaksurfaces = c_activesurfaces;
+	ThreadUnlock ();
 		
 	return s;
 }
 
 void FreeSurface (surface_t *s)
 {
+	ThreadLock ();
 	c_activesurfaces--;
+	ThreadUnlock ();
 	free (s);
 }
 
@@ -650,9 +663,11 @@ portal_t *AllocPortal (void)
 {
 	portal_t	*p;
 	
+	ThreadLock ();
 	c_activeportals++;
 	if (c_activeportals > c_peakportals)
 		c_peakportals = c_activeportals;
+	ThreadUnlock ();
 	
 	p = malloc (sizeof(portal_t));
 	memset (p, 0, sizeof(portal_t));
@@ -662,7 +677,9 @@ portal_t *AllocPortal (void)
 
 void FreePortal (portal_t *p)
 {
+	ThreadLock ();
 	c_activeportals--;
+	ThreadUnlock ();
 	free (p);
 }
 
@@ -989,12 +1006,17 @@ int main (int argc, char **argv)
 			subdivide_size = atoi(argv[i+1]);
 			i++;
 		}
+		else if (!strcmp (argv[i],"-sample"))
+		{
+			splitsamples = atoi(argv[i+1]);
+			i++;
+		}
 		else
 			Error ("qbsp: Unknown option '%s'", argv[i]);
 	}
 	
 	if (i != argc - 2 && i != argc - 1)
-		Error ("usage: qbsp [-draw] [-leakonly] [-noclip] [-nofill] [-nogfx] [-notjunc] [-proj name] [-subdivide size] [-threads n] [-v] [-watervis] sourcefile");
+		Error ("usage: qbsp [-draw] [-leakonly] [-noclip] [-nofill] [-nogfx] [-notjunc] [-proj name] [-sample n] [-subdivide size] [-threads n] [-v] [-watervis] sourcefile");
 
 	ThreadSetDefault ();
 
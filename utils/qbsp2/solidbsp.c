@@ -23,6 +23,12 @@ int		c_leaffaces;
 int		c_nodefaces;
 int		c_splitnodes;
 
+#define	BOX_EPSILON				0.001	// slack for classifying a bbox against a sloping plane
+#define	PARALLEL_CANDIDATES		64		// count splits in parallel for at least this many candidates
+#define	SUBTREE_SURFACES		512		// nodes with no more surfaces than this are built as separate subtrees
+
+qboolean	buildingsubtrees;			// true while subtrees are built in worker threads
+
 //============================================================================
 
 /*
@@ -87,6 +93,36 @@ int FaceSide (face_t *in, dplane_t *split)
 	return SIDE_ON;
 }
 
+/*
+==================
+SplitDistribution
+
+Split metric along an axial plane, smaller values are better
+==================
+*/
+vec_t SplitDistribution (dplane_t *plane, vec3_t mins, vec3_t maxs)
+{
+	int		j, l;
+	vec_t	value, dist;
+
+	l = plane->type;
+	value = 0;
+
+	for (j=0 ; j<3 ; j++)
+	{
+		if (j == l)
+		{
+			dist = plane->dist * plane->normal[l];
+			value += (maxs[l]-dist)*(maxs[l]-dist);
+			value += (dist-mins[l])*(dist-mins[l]);
+		}
+		else
+			value += 2*(maxs[j]-mins[j])*(maxs[j]-mins[j]);
+	}
+
+	return value;
+}
+
 /*
 ==================
 ChooseMidPlaneFromList
@@ -97,9 +133,9 @@ to the middle.
 */
 surface_t *ChooseMidPlaneFromList (surface_t *surfaces, vec3_t mins, vec3_t maxs)
 {
-	int			j,l;
+	int			l;
 	surface_t	*p, *bestsurface;
-	vec_t		bestvalue, value, dist;
+	vec_t		bestvalue, value;
 	dplane_t		*plane;
 
 //
@@ -120,23 +156,7 @@ surface_t *ChooseMidPlaneFromList (surface_t *surfaces, vec3_t mins, vec3_t maxs
 		if (l > PLANE_Z)
 			continue;
 
-	//
-	// calculate the split metric along axis l, smaller values are better
-	//
-		value = 0;
-
-		dist = plane->dist * plane->normal[l];
-		for (j=0 ; j<3 ; j++)
-		{
-			if (j == l)
-			{
-				value += (maxs[l]-dist)*(maxs[l]-dist);
-				value += (dist-mins[l])*(dist-mins[l]);
-			}
-			else
-				value += 2*(maxs[j]-mins[j])*(maxs[j]-mins[j]);
-		}
-		
+		value = SplitDistribution (plane, mins, maxs);
 		if (value > bestvalue)
 			continue;
 		
@@ -160,99 +180,238 @@ surface_t *ChooseMidPlaneFromList (surface_t *surfaces, vec3_t mins, vec3_t maxs
 
 
 
+/*
+==================
+SurfaceSide
+
+Classifies the bounding box of a surface against a plane.  Only surfaces
+that come back SIDE_ON can have faces that FaceSide would call split.
+==================
+*/
+int SurfaceSide (surface_t *surf, dplane_t *split)
+{
+	int		i;
+	vec_t	front, back;
+
+// axial planes can use the same test FaceSide does
+	if (split->type < 3)
+	{
+		if (surf->maxs[split->type] <= split->dist + ON_EPSILON)
+			return SIDE_BACK;
+		if (surf->mins[split->type] >= split->dist - ON_EPSILON)
+			return SIDE_FRONT;
+		return SIDE_ON;
+	}
+
+// sloping planes test the nearest and farthest corners
+	front = back = -split->dist;
+	for (i=0 ; i<3 ; i++)
+	{
+		if (split->normal[i] > 0)
+		{
+			front += split->normal[i] * surf->maxs[i];
+			back += split->normal[i] * surf->mins[i];
+		}
+		else
+		{
+			front += split->normal[i] * surf->mins[i];
+			back += split->normal[i] * surf->maxs[i];
+		}
+	}
+
+// leave some slack so round off can't disagree with FaceSide
+	if (front < ON_EPSILON - BOX_EPSILON)
+		return SIDE_BACK;
+	if (back > -ON_EPSILON + BOX_EPSILON)
+		return SIDE_FRONT;
+	return SIDE_ON;
+}
+
+/*
+==================
+CountSplits
+
+Returns the number of faces that would be split by the plane of p,
+stopping early once the count goes over bound.
+==================
+*/
+int CountSplits (surface_t *surfaces, surface_t *p, int bound)
+{
+	int			k;
+	surface_t	*p2;
+	dplane_t	*plane;
+	face_t		*f;
+
+	plane = &dplanes[p->planenum];
+	k = 0;
+
+	for (p2=surfaces ; p2 ; p2=p2->next)
+	{
+		if (p2 == p)
+			continue;
+		if (p2->onnode)
+			continue;
+		if (SurfaceSide (p2, plane) != SIDE_ON)
+			continue;	// no face can cross the plane
+			
+		for (f=p2->faces ; f ; f=f->next)
+		{
+			if (FaceSide (f, plane) == SIDE_ON)
+			{
+				k++;
+				if (k > bound)
+					return k;
+			}
+		}
+	}
+
+	return k;
+}
+
+typedef struct
+{
+	surface_t	*surface;
+	int			splits;
+} candidate_t;
+
+// shared with CandidateThread when the top of the tree counts splits in parallel
+candidate_t		*candidates;
+surface_t		*candidatesurfaces;
+int				candidatebound;
+
+/*
+==================
+CandidateThread
+
+Counts the splits for one candidate.  candidatebound only ever drops to
+a count that was fully evaluated, so an early out can never throw away
+the best plane.
+==================
+*/
+void CandidateThread (int i)
+{
+	int		k;
+
+	k = CountSplits (candidatesurfaces, candidates[i].surface, candidatebound);
+	candidates[i].splits = k;
+
+	if (k < candidatebound)
+	{
+		ThreadLock ();
+		if (k < candidatebound)
+			candidatebound = k;
+		ThreadUnlock ();
+	}
+}
+
 /*
 ==================
 ChoosePlaneFromList
 
-Choose the plane that splits the least faces
+Choose the plane that splits the least faces.  If equal numbers, axial
+planes win, then decide on spatial subdivision, then on list order, so
+the choice doesn't depend on the order the candidates were counted in.
+
+If splitsamples is set, only that many evenly spaced candidates are tried.
 ==================
 */
 surface_t *ChoosePlaneFromList (surface_t *surfaces, vec3_t mins, vec3_t maxs)
 {
-	int			j,k,l;
-	surface_t	*p, *p2, *bestsurface;
-	vec_t		bestvalue, bestdistribution, value, dist;
-	dplane_t		*plane;
-	face_t		*f;
+	int			i, j, count, stride, numlist;
+	candidate_t	*list;
+	surface_t	*p, *bestsurface;
+	vec_t		bestdistribution, value;
+	int			bestvalue, k;
+	dplane_t	*plane;
+	qboolean	axial, bestaxial;
 	
+//
+// gather the candidates
+//
+	count = 0;
+	for (p=surfaces ; p ; p=p->next)
+		if (!p->onnode)
+			count++;
+
+	stride = 1;
+	if (splitsamples > 0 && count > splitsamples)
+		stride = (count + splitsamples - 1) / splitsamples;
+
+	list = malloc (((count + stride - 1) / stride) * sizeof(*list));
+	numlist = 0;
+
+	j = 0;
+	for (p=surfaces ; p ; p=p->next)
+	{
+		if (p->onnode)
+			continue;
+		if (j++ % stride)
+			continue;
+		list[numlist].surface = p;
+		list[numlist].splits = 0;
+		numlist++;
+	}
+
+//
+// count the splits for each of them
+//
+	if (!buildingsubtrees && numthreads > 1 && numlist >= PARALLEL_CANDIDATES)
+	{
+		candidates = list;
+		candidatesurfaces = surfaces;
+		candidatebound = 99999;
+		RunThreadsOnIndividual (numlist, false, CandidateThread);
+		bestvalue = candidatebound;
+	}
+	else
+	{
+		bestvalue = 99999;
+		for (i=0 ; i<numlist ; i++)
+		{
+			k = CountSplits (surfaces, list[i].surface, bestvalue);
+			list[i].splits = k;
+			if (k < bestvalue)
+				bestvalue = k;
+		}
+	}
+
 //
 // pick the plane that splits the least
 //
-	bestvalue = 99999;
 	bestsurface = NULL;
+	bestaxial = false;
 	bestdistribution = 9e30;
 	
-	for (p=surfaces ; p ; p=p->next)
+	for (i=0 ; i<numlist ; i++)
 	{
-		if (p->onnode)
+		if (list[i].splits > bestvalue)
 			continue;
 
+		p = list[i].surface;
 		plane = &dplanes[p->planenum];
-		k = 0;
+		axial = plane->type <= PLANE_Z;
 
-		for (p2=surfaces ; p2 ; p2=p2->next)
-		{
-			if (p2 == p)
-				continue;
-			if (p2->onnode)
-				continue;
-				
-			for (f=p2->faces ; f ; f=f->next)
-			{
-				if (FaceSide (f, plane) == SIDE_ON)
-				{
-					k++;
-					if (k >= bestvalue)
-						break;
-				}
-				
-			}
-			if (k > bestvalue)
-				break;
-		}
-
-		if (k > bestvalue)
+		if (bestsurface && bestaxial && !axial)
 			continue;
-			
-	// if equal numbers, axial planes win, then decide on spatial subdivision
-	
-		if (k < bestvalue || (k == bestvalue && plane->type < PLANE_ANYX) )
+		if (bestsurface && bestaxial == axial && !axial)
+			continue;
+
+		if (axial)
 		{
-		// check for axis aligned surfaces
-			l = plane->type;
-	
-			if (l <= PLANE_Z)
-			{	// axial aligned						
-			//
-			// calculate the split metric along axis l
-			//
-				value = 0;
-		
-				for (j=0 ; j<3 ; j++)
-				{
-					if (j == l)
-					{
-						dist = plane->dist * plane->normal[l];
-						value += (maxs[l]-dist)*(maxs[l]-dist);
-						value += (dist-mins[l])*(dist-mins[l]);
-					}
-					else
-						value += 2*(maxs[j]-mins[j])*(maxs[j]-mins[j]);
-				}
-				
-				if (value > bestdistribution && k == bestvalue)
-					continue;
-				bestdistribution = value;
-			}
-		//
-		// currently the best!
-		//
-			bestvalue = k;
-			bestsurface = p;
+			value = SplitDistribution (plane, mins, maxs);
+			if (bestaxial && value >= bestdistribution)
+				continue;
+			bestdistribution = value;
 		}
 
+	//
+	// currently the best!
+	//
+		bestsurface = p;
+		bestaxial = axial;
 	}
 
+	free (list);
 
 	return bestsurface;
 }
@@ -609,7 +768,9 @@ void LinkLeafFaces (surface_t *planelist, node_t *leafnode)
 			}
 		}
 
+		ThreadLock ();
 		c_leaffaces += nummarkfaces;
+		ThreadUnlock ();
 		markfaces[nummarkfaces] = NULL;	// end marker
 		nummarkfaces++;
 
@@ -822,6 +983,7 @@ but they will reference these originals.
 void CopyFacesToNode (node_t *node, surface_t *surf)
 {
 	face_t	**prevptr, *f, *newf;
+	int		count;
 
 	// merge as much as possible
 	MergePlaneFaces (surf);
@@ -841,6 +1003,7 @@ void CopyFacesToNode (node_t *node, surface_t *surf)
 	// copy the faces to the node, and consider them the originals
 	node->surfaces = NULL;
 	node->faces = NULL;
+	count = 0;
 	for (f=surf->faces ; f ; f=f->next)
 	{
 		if (f->contents != CONTENTS_SOLID)
@@ -850,9 +1013,13 @@ void CopyFacesToNode (node_t *node, surface_t *surf)
 			f->original = newf;
 			newf->next = node->faces;
 			node->faces = newf;
-			c_nodefaces++;
+			count++;
 		}
 	}
+
+	ThreadLock ();
+	c_nodefaces += count;
+	ThreadUnlock ();
 }
 
 /*
@@ -876,10 +1043,13 @@ void DrawSurfaces (surface_t *surf)
 
 /*
 ==================
-BuildBspTree_r
+PartitionNode
+
+Picks a plane for node and splits its surfaces and portals between two
+new children.  Returns false if node became a leaf instead.
 ==================
 */
-void BuildBspTree_r (node_t *node)
+qboolean PartitionNode (node_t *node)
 {
 	surface_t		*split;
 	qboolean		midsplit;
@@ -887,14 +1057,15 @@ void BuildBspTree_r (node_t *node)
 
 	midsplit = CalcNodeBounds (node);
 
-	DrawSurfaces (node->surfaces);
+	if (!buildingsubtrees)
+		DrawSurfaces (node->surfaces);
 
 	split = SelectPartition (node->surfaces, node, midsplit);
 	if (!split)
 	{	// this is a leaf node
 		node->planenum = PLANENUM_LEAF;
 		LinkLeafFaces (node->surfaces, node);
-		return;
+		return false;
 	}
 
 	//
@@ -905,7 +1076,10 @@ void BuildBspTree_r (node_t *node)
 	node->planenum = split->planenum;
 	node->faces = NULL;
 	CopyFacesToNode (node, split);
+
+	ThreadLock ();
 	c_splitnodes++;
+	ThreadUnlock ();
 
 	node->children[0] = AllocNode ();
 	node->children[1] = AllocNode ();
@@ -925,6 +1099,19 @@ void BuildBspTree_r (node_t *node)
 	//
 	SplitNodePortals (node);
 
+	return true;
+}
+
+/*
+==================
+BuildBspTree_r
+==================
+*/
+void BuildBspTree_r (node_t *node)
+{
+	if (!PartitionNode (node))
+		return;
+
 	//
 	// recursively do the children
 	//
@@ -932,6 +1119,181 @@ void BuildBspTree_r (node_t *node)
 	BuildBspTree_r (node->children[1]);
 }
 
+//============================================================================
+
+/*
+
+  Once a node is down to SUBTREE_SURFACES surfaces, the rest of its subtree
+  only depends on its own surfaces and the portals that bound it, so the
+  subtrees below the top of the tree are built in parallel.
+
+  Each subtree gets private copies of its bounding portals, leading to a
+  stand in outside node instead of its neighbours.  When every subtree is
+  done, all the portals are thrown away and rebuilt down the finished tree,
+  the same way a single pass would have made them.
+
+  The top of the tree, the subtree boundaries and the split choices are
+  the same for any number of threads, so the output is too.
+
+*/
+
+typedef struct
+{
+	node_t		*node;
+	node_t		outside;
+} subtree_t;
+
+int			numsubtrees;
+int			maxsubtrees;
+subtree_t	*subtrees;
+
+int CountSurfaces (surface_t *surfaces)
+{
+	int		count;
+
+	count = 0;
+	for ( ; surfaces ; surfaces=surfaces->next)
+		count++;
+	return count;
+}
+
+/*
+==================
+BuildTopTree_r
+
+Partitions the nodes that are too big to be subtrees, leaving the rest as
+temporary leafs to be picked up by BuildSubtrees.
+==================
+*/
+void BuildTopTree_r (node_t *node)
+{
+	subtree_t	*st;
+
+	if (CountSurfaces (node->surfaces) <= SUBTREE_SURFACES)
+	{
+		if (numsubtrees == maxsubtrees)
+		{
+			maxsubtrees = maxsubtrees ? maxsubtrees*2 : 64;
+			subtrees = realloc (subtrees, maxsubtrees * sizeof(*subtrees));
+			if (!subtrees)
+				Error ("BuildTopTree_r: out of memory");
+		}
+		st = &subtrees[numsubtrees++];
+		memset (st, 0, sizeof(*st));
+		st->node = node;
+		node->planenum = PLANENUM_LEAF;	// so FreePortals stops here
+		return;
+	}
+
+	if (!PartitionNode (node))
+		return;
+
+	BuildTopTree_r (node->children[0]);
+	BuildTopTree_r (node->children[1]);
+}
+
+/*
+==================
+IsolateSubtrees
+
+Replaces the portals of the top of the tree with private copies that
+lead from each subtree to its own outside node.
+==================
+*/
+void IsolateSubtrees (node_t *headnode)
+{
+	int			i, side;
+	subtree_t	*st;
+	portal_t	*p, *copy, *copies;
+	node_t		*front, *back;
+
+	copies = NULL;
+	for (i=0, st=subtrees ; i<numsubtrees ; i++, st++)
+	{
+		for (p = st->node->portals ; p ; p = p->next[side])
+		{
+			if (p->nodes[0] == st->node)
+				side = 0;
+			else if (p->nodes[1] == st->node)
+				side = 1;
+			else
+				Error ("IsolateSubtrees: mislinked portal");
+
+			copy = AllocPortal ();
+			copy->plane = p->plane;
+			copy->onnode = p->onnode;
+			copy->winding = CopyWinding (p->winding);
+			copy->nodes[side] = st->node;
+			copy->nodes[!side] = &st->outside;
+			copy->next[0] = copies;		// just for holding the list
+			copies = copy;
+		}
+	}
+
+	FreePortals (headnode);
+
+	// link them back in reverse so each node sees its portals in the same order
+	for (p = copies ; p ; p = copy)
+	{
+		copy = p->next[0];
+		front = p->nodes[0];
+		back = p->nodes[1];
+		p->nodes[0] = p->nodes[1] = NULL;
+		AddPortalToNodes (p, front, back);
+	}
+}
+
+void BuildSubtree (int i)
+{
+	BuildBspTree_r (subtrees[i].node);
+}
+
+/*
+==================
+MakeTreePortals_r
+
+Rebuilds the portals and node bounds of a finished tree
+==================
+*/
+void MakeTreePortals_r (node_t *node)
+{
+	CalcNodeBounds (node);
+	if (node->planenum == PLANENUM_LEAF)
+		return;
+
+	MakeNodePortal (node);
+	SplitNodePortals (node);
+
+	MakeTreePortals_r (node->children[0]);
+	MakeTreePortals_r (node->children[1]);
+}
+
+/*
+==================
+BuildSubtrees
+==================
+*/
+void BuildSubtrees (node_t *headnode, surfchain_t *surfhead)
+{
+	numsubtrees = 0;
+	BuildTopTree_r (headnode);
+
+	IsolateSubtrees (headnode);
+
+	qprintf ("%5i subtrees\n", numsubtrees);
+	buildingsubtrees = true;
+	RunThreadsOnIndividual (numsubtrees, verbose, BuildSubtree);
+	buildingsubtrees = false;
+
+	FreePortals (headnode);
+	MakeHeadnodePortals (headnode, surfhead->mins, surfhead->maxs);
+	MakeTreePortals_r (headnode);
+
+	free (subtrees);
+	subtrees = NULL;
+	numsubtrees = maxsubtrees = 0;
+}
+
 /*
 ==================
 SolidBSP
@@ -973,7 +1335,10 @@ node_t *SolidBSP (surfchain_t *surfhead)
 	//
 	// recursively partition everything
 	//
-	BuildBspTree_r (headnode);
+	if (CountSurfaces (headnode->surfaces) <= SUBTREE_SURFACES)
+		BuildBspTree_r (headnode);
+	else
+		BuildSubtrees (headnode, surfhead);
 
 	qprintf ("%5i split nodes\n", c_splitnodes);
 	qprintf ("%5i node faces\n", c_nodefaces);
@@ -72,6 +72,7 @@ typedef struct
 {
 	vec3_t	mins, maxs;
 	bface_t	*faces;
+	bface_t	*outside;	// final faces, waiting to be written in brush order
 } brushhull_t;
 
 typedef struct brush_s
@@ -222,18 +222,19 @@ void WriteFace (int hull, bface_t *f)
 SaveOutside
 
 The faces remaining on the outside list are final
-polygons.  Write them to the output file.
-
-Passable contents (water, lava, etc) will generate
-a mirrored copy of the face to be seen from the inside.
+polygons.  Keep them on the hull until WriteOutside
+can write them in brush order.
 ==================
 */
-void SaveOutside (brush_t *b, int hull, bface_t *outside, int mirrorcontents)
+void SaveOutside (brush_t *b, int hull, bface_t *outside)
 {
 	bface_t	*f , *next, *f2;
-	int		i;
-	int		planenum;
-	vec3_t	temp;
+	bface_t	**last;
+	int		tiny, used;
+
+	tiny = used = 0;
+	last = &b->hulls[hull].outside;
+	*last = NULL;
 
 	for (f=outside ; f ; f=next)
 	{
@@ -241,9 +242,10 @@ void SaveOutside (brush_t *b, int hull, bface_t *outside, int mirrorcontents)
 
 		if (WindingArea (f->w) < 1.0)
 		{
-			c_tiny++;
+			tiny++;
 			qprintf ("Entity %i, Brush %i: tiny fragment\n"
 				, b->entitynum, b->brushnum);
+			FreeFace (f);
 			continue;
 		}
 
@@ -257,20 +259,51 @@ void SaveOutside (brush_t *b, int hull, bface_t *outside, int mirrorcontents)
 					if (!f2->used)
 					{
 						f2->used = true;
-						c_outfaces++;
+						used++;
 					}
 					break;
 				}
 			}
 		}
 
+		f->next = NULL;
+		*last = f;
+		last = &f->next;
+	}
+
+	ThreadLock ();
+	c_tiny += tiny;
+	c_outfaces += used;
+	ThreadUnlock ();
+}
+
+/*
+==================
+WriteOutside
+
+Write the saved faces of a brush hull to the output file.
+
+Passable contents (water, lava, etc) will generate
+a mirrored copy of the face to be seen from the inside.
+==================
+*/
+void WriteOutside (brush_t *b, int hull)
+{
+	bface_t	*f , *next;
+	int		i;
+	vec3_t	temp;
+
+	for (f=b->hulls[hull].outside ; f ; f=next)
+	{
+		next = f->next;
+
 		WriteFace (hull, f);
 
-//		if (mirrorcontents != CONTENTS_SOLID)
+//		if (b->contents != CONTENTS_SOLID)
 		{
 			f->planenum ^= 1;
 			f->plane = &mapplanes[f->planenum];
-			f->contents = mirrorcontents;
+			f->contents = b->contents;
 
 			// swap point orders
 			for (i=0 ; i<f->w->numpoints/2 ; i++)	// add points backwards
@@ -285,6 +318,8 @@ void SaveOutside (brush_t *b, int hull, bface_t *outside, int mirrorcontents)
 
 		FreeFace (f);
 	}
+
+	b->hulls[hull].outside = NULL;
 }
 
 
@@ -344,12 +379,14 @@ bface_t *CopyFacesToOutside (brushhull_t *bh)
 {
 	bface_t		*f, *newf;
 	bface_t		*outside;
+	int			count;
 
 	outside = NULL;
+	count = 0;
 	
 	for (f=bh->faces ; f ; f=f->next)
 	{
-		brushfaces++;
+		count++;
 
 		newf = CopyFace (f);
 		WindingBounds (newf->w, newf->mins, newf->maxs);
@@ -357,146 +394,412 @@ bface_t *CopyFacesToOutside (brushhull_t *bh)
 		outside = newf;
 	}
 
+	ThreadLock ();
+	brushfaces += count;
+	ThreadUnlock ();
+
 	return outside;
 }
 
 //============================================================
 
 
+/*
+
+  A brush only has to be clipped by the brushes of its entity whose
+  bounds touch its own, so the brushes of the entity being processed
+  are sorted into a coarse grid for each hull.
+
+*/
+
+#define	BRUSHGRID_SIZE		256		// smallest cell size
+#define	BRUSHGRID_CELLS		64		// most cells along an axis
+#define	BRUSHGRID_MAXSPAN	64		// brushes covering more cells than this are kept on their own list
+
+typedef struct
+{
+	vec3_t	origin;
+	vec3_t	cellsize;
+	int		size[3];
+	int		*cellstart;		// index into cellbrushes for each cell, plus an end marker
+	int		*cellbrushes;	// entity relative brush numbers, in order
+	int		numlarge;
+	int		*largebrushes;
+} brushgrid_t;
+
+entity_t	*csgentity;
+brushgrid_t	brushgrids[NUM_HULLS];
+
+/*
+===========
+GridRange
+
+Finds the cells touched by a box, returns the number of cells
+===========
+*/
+int GridRange (brushgrid_t *g, vec3_t mins, vec3_t maxs, int lo[3], int hi[3])
+{
+	int		i, count;
+
+	count = 1;
+	for (i=0 ; i<3 ; i++)
+	{
+		lo[i] = (int)floor ((mins[i] - g->origin[i]) / g->cellsize[i]);
+		hi[i] = (int)floor ((maxs[i] - g->origin[i]) / g->cellsize[i]);
+		if (lo[i] < 0)
+			lo[i] = 0;
+		if (hi[i] > g->size[i] - 1)
+			hi[i] = g->size[i] - 1;
+		if (hi[i] < lo[i])
+			return 0;
+		count *= hi[i] - lo[i] + 1;
+	}
+
+	return count;
+}
+
+/*
+===========
+BuildBrushGrid
+===========
+*/
+void BuildBrushGrid (entity_t *e, int hull)
+{
+	brushgrid_t	*g;
+	brushhull_t	*bh;
+	vec3_t		mins, maxs;
+	int			lo[3], hi[3];
+	int			i, j, x, y, z, c, numcells;
+	int			*fill;
+
+	g = &brushgrids[hull];
+	memset (g, 0, sizeof(*g));
+
+	ClearBounds (mins, maxs);
+	for (i=0 ; i<e->numbrushes ; i++)
+	{
+		bh = &mapbrushes[e->firstbrush + i].hulls[hull];
+		if (!bh->faces)
+			continue;
+		AddPointToBounds (bh->mins, mins, maxs);
+		AddPointToBounds (bh->maxs, mins, maxs);
+	}
+	if (mins[0] > maxs[0])
+		return;		// nothing in this hull
+
+	for (j=0 ; j<3 ; j++)
+	{
+		g->origin[j] = mins[j];
+		g->cellsize[j] = (maxs[j] - mins[j]) / BRUSHGRID_CELLS;
+		if (g->cellsize[j] < BRUSHGRID_SIZE)
+			g->cellsize[j] = BRUSHGRID_SIZE;
+		g->size[j] = (int)((maxs[j] - mins[j]) / g->cellsize[j]) + 1;
+		if (g->size[j] > BRUSHGRID_CELLS)
+			g->size[j] = BRUSHGRID_CELLS;
+	}
+
+	numcells = g->size[0] * g->size[1] * g->size[2];
+	g->cellstart = malloc ((numcells + 1) * sizeof(int));
+	memset (g->cellstart, 0, (numcells + 1) * sizeof(int));
+	g->largebrushes = malloc (e->numbrushes * sizeof(int));
+
+	// count the brushes in each cell
+	for (i=0 ; i<e->numbrushes ; i++)
+	{
+		bh = &mapbrushes[e->firstbrush + i].hulls[hull];
+		if (!bh->faces)
+			continue;
+		if (GridRange (g, bh->mins, bh->maxs, lo, hi) > BRUSHGRID_MAXSPAN)
+		{
+			g->largebrushes[g->numlarge++] = i;
+			continue;
+		}
+		for (z=lo[2] ; z<=hi[2] ; z++)
+			for (y=lo[1] ; y<=hi[1] ; y++)
+				for (x=lo[0] ; x<=hi[0] ; x++)
+					g->cellstart[(z*g->size[1] + y)*g->size[0] + x + 1]++;
+	}
+
+	for (c=0 ; c<numcells ; c++)
+		g->cellstart[c+1] += g->cellstart[c];
+
+	// fill them in brush order
+	g->cellbrushes = malloc ((g->cellstart[numcells] + 1) * sizeof(int));
+	fill = malloc (numcells * sizeof(int));
+	memcpy (fill, g->cellstart, numcells * sizeof(int));
+
+	for (i=0 ; i<e->numbrushes ; i++)
+	{
+		bh = &mapbrushes[e->firstbrush + i].hulls[hull];
+		if (!bh->faces)
+			continue;
+		if (GridRange (g, bh->mins, bh->maxs, lo, hi) > BRUSHGRID_MAXSPAN)
+			continue;
+		for (z=lo[2] ; z<=hi[2] ; z++)
+			for (y=lo[1] ; y<=hi[1] ; y++)
+				for (x=lo[0] ; x<=hi[0] ; x++)
+				{
+					c = (z*g->size[1] + y)*g->size[0] + x;
+					g->cellbrushes[fill[c]++] = i;
+				}
+	}
+
+	free (fill);
+}
+
+void FreeBrushGrid (int hull)
+{
+	brushgrid_t	*g;
+
+	g = &brushgrids[hull];
+	free (g->cellstart);
+	free (g->cellbrushes);
+	free (g->largebrushes);
+	memset (g, 0, sizeof(*g));
+}
+
+static int CompareBrushNums (const void *a, const void *b)
+{
+	return *(int *)a - *(int *)b;
+}
+
+/*
+===========
+BrushesNearBrush
+
+Returns a list of the brushes in the entity that might touch bh,
+in entity order, with no duplicates.  The caller frees it.
+===========
+*/
+int *BrushesNearBrush (brushgrid_t *g, brushhull_t *bh, int *numnear)
+{
+	int		lo[3], hi[3];
+	int		i, j, x, y, z, c, count, span;
+	int		*list;
+
+	*numnear = 0;
+	if (!g->cellstart)
+		return NULL;
+
+	span = GridRange (g, bh->mins, bh->maxs, lo, hi);
+	if (span > BRUSHGRID_MAXSPAN)
+	{
+		// big brushes just check everything
+		list = malloc (csgentity->numbrushes * sizeof(int));
+		for (i=0 ; i<csgentity->numbrushes ; i++)
+			list[i] = i;
+		*numnear = csgentity->numbrushes;
+		return list;
+	}
+
+	count = g->numlarge;
+	for (z=lo[2] ; z<=hi[2] && span ; z++)
+		for (y=lo[1] ; y<=hi[1] ; y++)
+			for (x=lo[0] ; x<=hi[0] ; x++)
+			{
+				c = (z*g->size[1] + y)*g->size[0] + x;
+				count += g->cellstart[c+1] - g->cellstart[c];
+			}
+
+	list = malloc ((count + 1) * sizeof(int));
+	memcpy (list, g->largebrushes, g->numlarge * sizeof(int));
+	count = g->numlarge;
+	for (z=lo[2] ; z<=hi[2] && span ; z++)
+		for (y=lo[1] ; y<=hi[1] ; y++)
+			for (x=lo[0] ; x<=hi[0] ; x++)
+			{
+				c = (z*g->size[1] + y)*g->size[0] + x;
+				for (j=g->cellstart[c] ; j<g->cellstart[c+1] ; j++)
+					list[count++] = g->cellbrushes[j];
+			}
+
+	// brushes that cover several cells show up more than once
+	qsort (list, count, sizeof(int), CompareBrushNums);
+	for (i=j=0 ; i<count ; i++)
+		if (!j || list[i] != list[j-1])
+			list[j++] = list[i];
+
+	*numnear = j;
+	return list;
+}
+
 /*
 ===========
 CSGBrush
+
+Clips one hull of a brush in csgentity by the other brushes of the
+entity.  Work is numbered brush by brush, hull by hull.
 ===========
 */
-void CSGBrush (int brushnum)
+void CSGBrush (int work)
 {
 	int			hull;
 	brush_t		*b1, *b2;
 	brushhull_t	*bh1, *bh2;
-	int			bn;
+	int			brushnum, bn;
+	int			*nearbrushes, numnear, n;
 	qboolean	overwrite;
 	int			i;
 	bface_t		*f, *f2, *next, *fcopy;
 	bface_t		*outside, *oldoutside;
 	entity_t	*e;
 	vec_t		area;
+	int			tinyclips;
 
 	SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_ABOVE_NORMAL);
 
-	b1 = &mapbrushes[brushnum];
+	e = csgentity;
+	brushnum = work / NUM_HULLS;
+	hull = work % NUM_HULLS;
 
-	e = &entities[b1->entitynum];
+	b1 = &mapbrushes[e->firstbrush + brushnum];
+	bh1 = &b1->hulls[hull];
 
-	for (hull = 0 ; hull<NUM_HULLS ; hull++)
+	if (!bh1->faces)
 	{
-		bh1 = &b1->hulls[hull];
+		bh1->outside = NULL;
+		return;		// brush isn't in this hull
+	}
 
-		// set outside to a copy of the brush's faces
-		outside = CopyFacesToOutside (bh1);
-		overwrite = false;
+	// set outside to a copy of the brush's faces
+	outside = CopyFacesToOutside (bh1);
+	tinyclips = 0;
 
-		for (bn=0 ; bn<e->numbrushes ; bn++)
-		{
-			// see if b2 needs to clip a chunk out of b1
+	nearbrushes = BrushesNearBrush (&brushgrids[hull], bh1, &numnear);
 
-			if (bn==brushnum)
-			{
-				overwrite = true;	// later brushes now overwrite
-				continue;
-			}
+	for (n=0 ; n<numnear ; n++)
+	{
+		// see if b2 needs to clip a chunk out of b1
+		bn = nearbrushes[n];
+		if (bn==brushnum)
+			continue;
+		overwrite = bn > brushnum;	// later brushes overwrite
+
+		b2 = &mapbrushes[e->firstbrush + bn];
+		bh2 = &b2->hulls[hull];
+
+		if (!bh2->faces)
+			continue;		// brush isn't in this hull
 
-			b2 = &mapbrushes[e->firstbrush + bn];
-			bh2 = &b2->hulls[hull];
+		// check brush bounding box first
+		for (i=0 ; i<3 ; i++)
+			if (bh1->mins[i] > bh2->maxs[i] 
+			|| bh1->maxs[i] < bh2->mins[i])
+				break;
+		if (i<3)
+			continue;
 
-			if (!bh2->faces)
-				continue;		// brush isn't in this hull
+		// divide faces by the planes of the b2 to find which
+		// fragments are inside
+	
+		f = outside;
+		outside = NULL;
+		for ( ; f ; f=next)
+		{
+			next = f->next;
 
-			// check brush bounding box first
+			// check face bounding box first
 			for (i=0 ; i<3 ; i++)
-				if (bh1->mins[i] > bh2->maxs[i] 
-				|| bh1->maxs[i] < bh2->mins[i])
+				if (bh2->mins[i] > f->maxs[i] 
+				|| bh2->maxs[i] < f->mins[i])
 					break;
 			if (i<3)
+			{	// this face doesn't intersect brush2's bbox
+				f->next = outside;
+				outside = f;
 				continue;
+			}
 
-			// divide faces by the planes of the b2 to find which
-			// fragments are inside
-		
-			f = outside;
-			outside = NULL;
-			for ( ; f ; f=next)
+			oldoutside = outside;
+			fcopy = CopyFace (f);	// save to avoid fake splits
+
+			// throw pieces on the front sides of the planes
+			// into the outside list, return the remains on the inside
+			for (f2=bh2->faces ; f2 && f ; f2=f2->next)
+				f = ClipFace (b1, f, &outside, f2->planenum, overwrite);
+
+			area = f ? WindingArea (f->w) : 0;
+			if (f && area < 1.0)
 			{
-				next = f->next;
-
-				// check face bounding box first
-				for (i=0 ; i<3 ; i++)
-					if (bh2->mins[i] > f->maxs[i] 
-					|| bh2->maxs[i] < f->mins[i])
-						break;
-				if (i<3)
-				{	// this face doesn't intersect brush2's bbox
+				qprintf ("Entity %i, Brush %i: tiny penetration\n"
+					, b1->entitynum, b1->brushnum);
+				tinyclips++;
+				FreeFace (f);
+				f = NULL;
+			}
+			if (f)
+			{
+				// there is one convex fragment of the original
+				// face left inside brush2
+				FreeFace (fcopy);
+
+				if (b1->contents > b2->contents)
+				{	// inside a water brush
+					f->contents = b2->contents;
 					f->next = outside;
 					outside = f;
-					continue;
 				}
+				else	// inside a solid brush
+					FreeFace (f);	// throw it away
+			}
+			else
+			{	// the entire thing was on the outside, even
+				// though the bounding boxes intersected,
+				// which will never happen with axial planes
 
-				oldoutside = outside;
-				fcopy = CopyFace (f);	// save to avoid fake splits
-
-				// throw pieces on the front sides of the planes
-				// into the outside list, return the remains on the inside
-				for (f2=bh2->faces ; f2 && f ; f2=f2->next)
-					f = ClipFace (b1, f, &outside, f2->planenum, overwrite);
-
-				area = f ? WindingArea (f->w) : 0;
-				if (f && area < 1.0)
+				// free the fragments chopped to the outside
+				while (outside != oldoutside)
 				{
-					qprintf ("Entity %i, Brush %i: tiny penetration\n"
-						, b1->entitynum, b1->brushnum);
-					c_tiny_clip++;
-					FreeFace (f);
-					f = NULL;
+					f2 = outside->next;
+					FreeFace (outside);
+					outside = f2;
 				}
-				if (f)
-				{
-					// there is one convex fragment of the original
-					// face left inside brush2
-					FreeFace (fcopy);
-
-					if (b1->contents > b2->contents)
-					{	// inside a water brush
-						f->contents = b2->contents;
-						f->next = outside;
-						outside = f;
-					}
-					else	// inside a solid brush
-						FreeFace (f);	// throw it away
-				}
-				else
-				{	// the entire thing was on the outside, even
-					// though the bounding boxes intersected,
-					// which will never happen with axial planes
 
-					// free the fragments chopped to the outside
-					while (outside != oldoutside)
-					{
-						f2 = outside->next;
-						FreeFace (outside);
-						outside = f2;
-					}
-
-					// revert to the original face to avoid
-					// unneeded false cuts
-					fcopy->next = outside;
-					outside = fcopy;
-				}
+				// revert to the original face to avoid
+				// unneeded false cuts
+				fcopy->next = outside;
+				outside = fcopy;
 			}
-
 		}
-
-		// all of the faces left in outside are real surface faces
-		SaveOutside (b1, hull, outside, b1->contents);
 	}
+
+	free (nearbrushes);
+
+	ThreadLock ();
+	c_tiny_clip += tinyclips;
+	ThreadUnlock ();
+
+	// all of the faces left in outside are real surface faces
+	SaveOutside (b1, hull, outside);
+}
+
+/*
+===========
+CSGEntity
+
+Runs every hull of every brush in the entity across the threads,
+then writes the results in the same order a single thread would.
+===========
+*/
+void CSGEntity (int entitynum)
+{
+	int		hull, j;
+
+	csgentity = &entities[entitynum];
+
+	for (hull=0 ; hull<NUM_HULLS ; hull++)
+		BuildBrushGrid (csgentity, hull);
+
+	RunThreadsOnIndividual (csgentity->numbrushes * NUM_HULLS, entitynum == 0, CSGBrush);
+
+	for (hull=0 ; hull<NUM_HULLS ; hull++)
+		FreeBrushGrid (hull);
+
+	for (j=0 ; j<csgentity->numbrushes ; j++)
+		for (hull=0 ; hull<NUM_HULLS ; hull++)
+			WriteOutside (&mapbrushes[csgentity->firstbrush + j], hull);
+
+	csgentity = NULL;
 }
 
 //======================================================================
@@ -663,15 +966,7 @@ void ProcessModels (void)
 		//
 		// csg them in order
 		//
-		if (i == 0)
-		{
-			RunThreadsOnIndividual (entities[i].numbrushes, 1 , CSGBrush);
-		}
-		else
-		{
-			for (j=0 ; j<entities[i].numbrushes ; j++)
-				CSGBrush (first + j);
-		}
+		CSGEntity (i);
 
 		// write end of model marker
 		if (!glview)
@@ -39,6 +39,10 @@ qboolean	dumppatches;
 
 int TestLine (vec3_t start, vec3_t stop);
 
+void CheckpointScales (int patchnum);
+void CheckpointBounce (unsigned bounce);
+void CloseCheckpoint (void);
+
 int			junk;
 
 vec3_t		ambient = { 0, 0, 0 };
@@ -65,6 +69,16 @@ float		smoothing_threshold = 0; // default: cos(45.0*(Q_PI/180));
 float		coring = 1.0;	// Light threshold to force to blackness(minimizes lightmaps)
 qboolean	texscale = true;
 
+qboolean	checkpoint = false;		// save transfers and bounces as we go
+qboolean	resume = false;			// pick up from a previous checkpoint
+char		checkpointfile[_MAX_PATH] = "";
+FILE		*checkpointhandle;
+double		lastcheckpoint;
+byte		scalesdone[MAX_PATCHES];	// transfers restored from the checkpoint
+unsigned	bouncesdone;				// bounces restored from the checkpoint
+vec3_t		*bouncetotallight;			// patch state after the last restored bounce
+vec3_t		*bounceemitlight;
+
 /*
 ===================================================================
 
@@ -711,6 +725,9 @@ void MakeScales (int threadnum)
 
 		patch = patches + i;
 
+		if (scalesdone[i])
+			continue;		// restored from the checkpoint
+
 		total = 0;
 		patch->numtransfers = 0;
 
@@ -792,6 +809,8 @@ void MakeScales (int threadnum)
 				t->patch = t2->patch;
 			}
 		}
+
+		CheckpointScales (i);
 	}
 
 	ThreadLock ();
@@ -998,7 +1017,19 @@ void BounceLight (void)
 	for (i=0 ; i<num_patches ; i++)
 		VectorScale( patches[i].totallight, TRANSFER_SCALE, emitlight[i] );
 
-	for (i=0 ; i<numbounce ; i++)
+	if ( bouncesdone )
+	{
+		for (i=0 ; i<num_patches ; i++)
+		{
+			VectorCopy( bouncetotallight[i], patches[i].totallight );
+			VectorCopy( bounceemitlight[i], emitlight[i] );
+		}
+		free( bouncetotallight );
+		free( bounceemitlight );
+		qprintf ("\tBounces #1-#%i restored from checkpoint\n", bouncesdone );
+	}
+
+	for (i=bouncesdone ; i<numbounce ; i++)
 	{
 		RunThreadsOn (num_patches, true, GatherLight);
 		CollectLight( added );
@@ -1009,7 +1040,11 @@ void BounceLight (void)
 			sprintf (name, "bounce%i.txt", i);
 			WriteWorld (name);
 		}
+
+		CheckpointBounce( i+1 );
 	}
+
+	CloseCheckpoint ();
 }
 
 
@@ -1160,29 +1195,406 @@ readtransfers(char *transferfile, long numpatches)
 }
 
 
+/*
+===================================================================
+
+CHECKPOINTS
+
+A checkpoint file is a radcheckpoint_t header followed by records,
+each starting with a checkpointrecord_t:
+
+ckpt_transfers:	int patchnum, int numtransfers, transfer_t[numtransfers]
+ckpt_bounce:	unsigned bounce, vec3_t totallight[num_patches],
+				vec3_t emitlight[num_patches]
+
+Transfers are saved as MakeScales leaves them, before SwapTransfersTask.
+The header also records every option that changes the patches, transfers
+or bounced light, so a -resume with different options starts over.
+===================================================================
+*/
+
+#define	CHECKPOINT_ID		(('P'<<24)+('C'<<16)+('R'<<8)+'Q')
+#define	CHECKPOINT_VERSION	2
+#define	CHECKPOINT_INTERVAL	30		// seconds between checkpoint flushes
+
+typedef enum
+{
+	ckpt_transfers,
+	ckpt_bounce
+} checkpointrecord_t;
+
+typedef struct
+{
+	float		maxchop, minchop;
+	float		lightscale;
+	vec3_t		ambient;
+	float		maxlight;
+	float		dlight_threshold;
+	float		gamma;
+	float		indirect_sun;
+	float		smoothing_threshold;
+	float		coring;
+	int			extra;
+	int			texscale;
+	unsigned	lights;			// hash of the .rad file names and contents
+} radoptions_t;
+
+typedef struct
+{
+	int			ident;
+	int			version;
+	int			checksum;		// BSPChecksum() of the source bsp
+	unsigned	num_patches;
+	radoptions_t	options;
+} radcheckpoint_t;
+
+/*
+=============
+HashLightsFile
+
+Folds a texture lights file's name and contents into hash, so editing
+lights.rad between runs invalidates the checkpoint too.
+=============
+*/
+unsigned HashLightsFile (unsigned hash, char *filename)
+{
+	FILE	*f;
+	char	*c;
+	int		ch;
+
+	for ( c = filename; *c; c++ )
+		hash = (hash ^ (byte)*c) * 16777619u;
+
+	if ( !*filename || !(f = fopen (filename, "rb")) )
+		return hash;
+	while ( (ch = getc (f)) != EOF )
+		hash = (hash ^ (byte)ch) * 16777619u;
+	fclose (f);
+
+	return hash;
+}
+
+/*
+=============
+CheckpointOptions
+
+Fills in the options the checkpointed state was computed with.
+=============
+*/
+void CheckpointOptions (radoptions_t *options)
+{
+	memset (options, 0, sizeof(*options));
+
+	options->maxchop = maxchop;
+	options->minchop = minchop;
+	options->lightscale = lightscale;
+	VectorCopy (ambient, options->ambient);
+	options->maxlight = maxlight;
+	options->dlight_threshold = dlight_threshold;
+	options->gamma = gamma;
+	options->indirect_sun = indirect_sun;
+	options->smoothing_threshold = smoothing_threshold;
+	options->coring = coring;
+	options->extra = extra;
+	options->texscale = texscale;
+
+	options->lights = 2166136261u;
+	options->lights = HashLightsFile (options->lights, global_lights);
+	options->lights = HashLightsFile (options->lights, designer_lights);
+	options->lights = HashLightsFile (options->lights, level_lights);
+}
+
+void WriteCheckpointTransfers (int patchnum)
+{
+	checkpointrecord_t	type = ckpt_transfers;
+	patch_t	*patch = &patches[patchnum];
+
+	SafeWrite (checkpointhandle, &type, sizeof(type));
+	SafeWrite (checkpointhandle, &patchnum, sizeof(patchnum));
+	SafeWrite (checkpointhandle, &patch->numtransfers, sizeof(patch->numtransfers));
+	if ( patch->numtransfers )
+		SafeWrite (checkpointhandle, patch->transfers, patch->numtransfers*sizeof(transfer_t));
+}
+
+void WriteCheckpointBounce (unsigned bounce, vec3_t *totallight, vec3_t *emit)
+{
+	checkpointrecord_t	type = ckpt_bounce;
+
+	SafeWrite (checkpointhandle, &type, sizeof(type));
+	SafeWrite (checkpointhandle, &bounce, sizeof(bounce));
+	SafeWrite (checkpointhandle, totallight, num_patches*sizeof(vec3_t));
+	SafeWrite (checkpointhandle, emit, num_patches*sizeof(vec3_t));
+}
+
+/*
+=============
+ReadCheckpoint
+
+Restores whatever an earlier run on the same bsp with the same options
+got done.  A torn record at the end of the file is ignored.
+Returns the number of patches whose transfers were restored.
+=============
+*/
+unsigned ReadCheckpoint (void)
+{
+	radcheckpoint_t		header;
+	radoptions_t		options;
+	checkpointrecord_t	type;
+	FILE		*f;
+	patch_t		*patch;
+	transfer_t	*transfers;
+	vec3_t		*totallight, *emit;
+	int			patchnum, numtransfers;
+	unsigned	bounce;
+	unsigned	restored = 0;
+
+	if ( !(f = fopen (checkpointfile, "rb")) )
+	{
+		printf ("No checkpoint %s, starting from scratch\n", checkpointfile);
+		return 0;
+	}
+
+	if ( fread (&header, sizeof(header), 1, f) != 1
+	  || header.ident != CHECKPOINT_ID
+	  || header.version != CHECKPOINT_VERSION
+	  || header.checksum != BSPChecksum ()
+	  || header.num_patches != num_patches )
+	{
+		printf ("WARNING: %s doesn't match this bsp, starting from scratch\n", checkpointfile);
+		fclose (f);
+		return 0;
+	}
+
+	CheckpointOptions (&options);
+	if ( memcmp (&header.options, &options, sizeof(options)) )
+	{
+		printf ("WARNING: %s was made with different options, starting from scratch\n", checkpointfile);
+		fclose (f);
+		return 0;
+	}
+
+	totallight = malloc (num_patches*sizeof(vec3_t));
+	emit = malloc (num_patches*sizeof(vec3_t));
+
+	while ( fread (&type, sizeof(type), 1, f) == 1 )
+	{
+		if ( type == ckpt_transfers )
+		{
+			if ( fread (&patchnum, sizeof(patchnum), 1, f) != 1
+			  || fread (&numtransfers, sizeof(numtransfers), 1, f) != 1
+			  || patchnum < 0 || (unsigned)patchnum >= num_patches
+			  || numtransfers < 0 || (unsigned)numtransfers > num_patches )
+				break;
+
+			transfers = NULL;
+			if ( numtransfers )
+			{
+				transfers = calloc (numtransfers, sizeof(transfer_t));
+				if ( !transfers )
+					Error ("Memory allocation failure");
+				if ( fread (transfers, sizeof(transfer_t), numtransfers, f) != (size_t)numtransfers )
+				{
+					free (transfers);
+					break;
+				}
+			}
+
+			if ( scalesdone[patchnum] )
+			{
+				free (transfers);
+				continue;
+			}
+
+			patch = &patches[patchnum];
+			patch->numtransfers = numtransfers;
+			patch->transfers = transfers;
+			scalesdone[patchnum] = true;
+			total_transfer += numtransfers;
+			restored++;
+		}
+		else if ( type == ckpt_bounce )
+		{
+			if ( fread (&bounce, sizeof(bounce), 1, f) != 1
+			  || fread (totallight, sizeof(vec3_t), num_patches, f) != num_patches
+			  || fread (emit, sizeof(vec3_t), num_patches, f) != num_patches )
+				break;
+
+			if ( !bouncetotallight )
+			{
+				bouncetotallight = malloc (num_patches*sizeof(vec3_t));
+				bounceemitlight = malloc (num_patches*sizeof(vec3_t));
+			}
+			memcpy (bouncetotallight, totallight, num_patches*sizeof(vec3_t));
+			memcpy (bounceemitlight, emit, num_patches*sizeof(vec3_t));
+			bouncesdone = bounce;
+		}
+		else
+			break;
+	}
+
+	free (totallight);
+	free (emit);
+	fclose (f);
+
+	// bounces need the complete transfer lists they were gathered with, and
+	// only the light after the last bounce is kept, so a lower -bounce than
+	// the checkpoint got to has to gather them all again
+	if ( bouncesdone && (restored != num_patches || bouncesdone > numbounce) )
+	{
+		free (bouncetotallight);
+		free (bounceemitlight);
+		bouncetotallight = bounceemitlight = NULL;
+		bouncesdone = 0;
+	}
+
+	printf ("%-20s Restored %u of %u patches and %u bounces from [%s]\n",
+		"MakeAllScales:", restored, num_patches, bouncesdone, checkpointfile );
+
+	return restored;
+}
+
+/*
+=============
+OpenCheckpoint
+
+Starts a fresh checkpoint, carrying over anything restored by -resume.
+Returns the number of patches whose transfers were restored.
+=============
+*/
+unsigned OpenCheckpoint (void)
+{
+	radcheckpoint_t	header;
+	unsigned		restored = 0;
+	unsigned		i;
+
+	strcpy(checkpointfile, source);
+	StripExtension( checkpointfile );
+	DefaultExtension( checkpointfile, ".r3" );
+
+	if ( resume )
+		restored = ReadCheckpoint ();
+
+	header.ident = CHECKPOINT_ID;
+	header.version = CHECKPOINT_VERSION;
+	header.checksum = BSPChecksum ();
+	header.num_patches = num_patches;
+	CheckpointOptions (&header.options);
+
+	checkpointhandle = SafeOpenWrite (checkpointfile);
+	SafeWrite (checkpointhandle, &header, sizeof(header));
+
+	for ( i = 0; i < num_patches; i++ )
+	{
+		if ( scalesdone[i] )
+			WriteCheckpointTransfers (i);
+	}
+	if ( bouncesdone )
+		WriteCheckpointBounce (bouncesdone, bouncetotallight, bounceemitlight);
+
+	fflush (checkpointhandle);
+	lastcheckpoint = I_FloatTime ();
+
+	return restored;
+}
+
+/*
+=============
+CheckpointScales
+
+Appends a finished patch's transfers, flushing every CHECKPOINT_INTERVAL
+seconds.  Run from the MakeScales threads.
+=============
+*/
+void CheckpointScales (int patchnum)
+{
+	double	now;
+
+	if ( !checkpointhandle )
+		return;
+
+	ThreadLock ();
+
+	WriteCheckpointTransfers (patchnum);
+
+	now = I_FloatTime ();
+	if ( now - lastcheckpoint >= CHECKPOINT_INTERVAL )
+	{
+		fflush (checkpointhandle);
+		lastcheckpoint = now;
+	}
+
+	ThreadUnlock ();
+}
+
+/*
+=============
+CheckpointBounce
+
+Saves the patch light after a finished bounce.  Every bounce is
+flushed, since each one costs a full GatherLight pass.
+=============
+*/
+void CheckpointBounce (unsigned bounce)
+{
+	vec3_t		*totallight;
+	unsigned	i;
+
+	if ( !checkpointhandle )
+		return;
+
+	totallight = malloc (num_patches*sizeof(vec3_t));
+	for ( i = 0; i < num_patches; i++ )
+		VectorCopy( patches[i].totallight, totallight[i] );
+
+	WriteCheckpointBounce (bounce, totallight, emitlight);
+	fflush (checkpointhandle);
+	lastcheckpoint = I_FloatTime ();
+
+	free (totallight);
+}
+
+void CloseCheckpoint (void)
+{
+	if ( !checkpointhandle )
+		return;
+
+	fclose (checkpointhandle);
+	checkpointhandle = NULL;
+}
+
 //==============================================================
 
 void MakeAllScales (void)
 {
+	unsigned	restored = 0;
+
 	strcpy(transferfile, source);
 	StripExtension( transferfile );
 	DefaultExtension( transferfile, ".r2" );
 
-	if ( !incremental
+	if ( checkpoint )
+		restored = OpenCheckpoint ();
+
+	if ( restored
+	  || !incremental
 	  || !IsIncremental(incrementfile)
 	  || (unsigned)readtransfers(transferfile, num_patches) != num_patches )
 	{
-		// determine visibility between patches
-		BuildVisMatrix ();
+		if ( restored != num_patches )
+		{
+			// determine visibility between patches
+			BuildVisMatrix ();
+
+			RunThreadsOn (num_patches, true, MakeScales);
+
+			// release visibility matrix
+			FreeVisMatrix ();
+		}
 
-		RunThreadsOn (num_patches, true, MakeScales);
 		if ( incremental )
 			writetransfers(transferfile, num_patches);
 		else
 			unlink(transferfile);
-
-		// release visibility matrix
-		FreeVisMatrix ();
 	}
 
 	qprintf ("transfer lists: %5.1f megs\n"
@@ -1485,6 +1897,15 @@ int main (int argc, char **argv)
 		{
 			texscale = false;
 		}
+		else if (!strcmp(argv[i],"-checkpoint"))
+		{
+			checkpoint = true;
+		}
+		else if (!strcmp(argv[i],"-resume"))
+		{
+			checkpoint = true;
+			resume = true;
+		}
 		else
 		{
 			break;
@@ -1497,7 +1918,7 @@ int main (int argc, char **argv)
 		maxlight = 255;
 
 	if (i != argc - 1)
-		Error ("usage: qrad [-dump] [-inc] [-bounce n] [-threads n] [-verbose] [-terse] [-chop n] [-maxchop n] [-scale n] [-ambient red green blue] [-proj file] [-maxlight n] [-threads n] [-lights file] [-gamma n] [-dlight n] [-extra] [-smooth n] [-coring n] [-notexscale] bspfile");
+		Error ("usage: qrad [-dump] [-inc] [-bounce n] [-threads n] [-verbose] [-terse] [-chop n] [-maxchop n] [-scale n] [-ambient red green blue] [-proj file] [-maxlight n] [-threads n] [-lights file] [-gamma n] [-dlight n] [-extra] [-smooth n] [-coring n] [-notexscale] [-checkpoint] [-resume] bspfile");
 
 	start = I_FloatTime ();
 
@@ -1549,6 +1970,10 @@ int main (int argc, char **argv)
 
 	WriteBSPFile (source);
 
+	// the bsp now holds everything the checkpoint did
+	if ( checkpoint )
+		unlink(checkpointfile);
+
 	if ( incremental )
 	{
 		if ( !IsIncremental(incrementfile) )
@@ -29,6 +29,7 @@
 #include "lbmlib.h"
 #include "scriplib.h"
 #include "mathlib.h"
+#include "threads.h"
 #define EXTERN
 #include "../../engine/studio.h"
 #include "studiomdl.h"
@@ -54,7 +55,9 @@ void *kalloc( int num, int size )
 {
 	// printf( "calloc( %d, %d )\n", num, size );
 	// printf( "%d ", num * size );
+	ThreadLock();
 	k_memtotal += num * size;
+	ThreadUnlock();
 	return calloc( num, size );
 }
 
@@ -378,6 +381,193 @@ void MakeTransitions( )
 
 
 
+/*
+=================
+SequenceBounds
+
+Finds the bounding box of a sequence over all of its frames and blends
+=================
+*/
+void SequenceBounds( int i )
+{
+	int j, k, n, q;
+	vec3_t bmin, bmax;
+
+	// find intersection box volume for each bone
+	for (j = 0; j < 3; j++)
+	{
+		bmin[j] = 9999.0;
+		bmax[j] = -9999.0;
+	}
+
+	for (q = 0; q < sequence[i].numblends; q++)
+	{
+		for (n = 0; n < sequence[i].numframes; n++)
+		{
+			float bonetransform[MAXSTUDIOBONES][3][4];	// bone transformation matrix
+			float bonematrix[3][4];						// local transformation matrix
+			vec3_t pos;
+
+			for (j = 0; j < numbones; j++)
+			{
+				vec3_t angle;
+
+				// convert to degrees
+				angle[0]	= sequence[i].panim[q]->rot[j][n][0] * (180.0 / Q_PI);
+				angle[1]	= sequence[i].panim[q]->rot[j][n][1] * (180.0 / Q_PI);
+				angle[2]	= sequence[i].panim[q]->rot[j][n][2] * (180.0 / Q_PI);
+
+				AngleMatrix( angle, bonematrix );
+
+				bonematrix[0][3] = sequence[i].panim[q]->pos[j][n][0];
+				bonematrix[1][3] = sequence[i].panim[q]->pos[j][n][1];
+				bonematrix[2][3] = sequence[i].panim[q]->pos[j][n][2];
+
+				if (bonetable[j].parent == -1)
+				{
+					MatrixCopy( bonematrix, bonetransform[j] );
+				}
+				else
+				{
+					R_ConcatTransforms (bonetransform[bonetable[j].parent], bonematrix, bonetransform[j]);
+				}
+			}
+
+			for (k = 0; k < nummodels; k++)
+			{
+				for (j = 0; j < model[k]->numverts; j++)
+				{
+					VectorTransform( model[k]->vert[j].org, bonetransform[model[k]->vert[j].bone], pos );
+
+					if (pos[0] < bmin[0]) bmin[0] = pos[0];
+					if (pos[1] < bmin[1]) bmin[1] = pos[1];
+					if (pos[2] < bmin[2]) bmin[2] = pos[2];
+					if (pos[0] > bmax[0]) bmax[0] = pos[0];
+					if (pos[1] > bmax[1]) bmax[1] = pos[1];
+					if (pos[2] > bmax[2]) bmax[2] = pos[2];
+				}
+			}
+		}
+	}
+
+	VectorCopy( bmin, sequence[i].bmin );
+	VectorCopy( bmax, sequence[i].bmax );
+
+	/*
+	printf("%s : %.0f %.0f %.0f %.0f %.0f %.0f\n", 
+		sequence[i].name, bmin[0], bmax[0], bmin[1], bmax[1], bmin[2], bmax[2] );
+	*/
+	// printf("%s  %.2f\n", sequence[i].name, sequence[i].panim[0]->pos[9][0][0] / bonetable[9].pos[0] );
+}
+
+/*
+=================
+CompressSequence
+
+Run length encodes the animation values of a sequence
+=================
+*/
+void CompressSequence( int i )
+{
+	int j, k, n, m, q;
+	
+	for (q = 0; q < sequence[i].numblends; q++)
+	{
+		for (j = 0; j < numbones; j++)
+		{
+			for (k = 0; k < 6; k++)
+			{
+				mstudioanimvalue_t	*pcount, *pvalue;
+				float v;
+				short value[MAXSTUDIOANIMATIONS];
+				mstudioanimvalue_t data[MAXSTUDIOANIMATIONS];
+
+				for (n = 0; n < sequence[i].numframes; n++)
+				{
+					switch(k)
+					{
+					case 0: 
+					case 1: 
+					case 2: 
+						value[n] = ( sequence[i].panim[q]->pos[j][n][k] - bonetable[j].pos[k] ) / bonetable[j].posscale[k]; 
+						break;
+					case 3:
+					case 4:
+					case 5:
+						v = ( sequence[i].panim[q]->rot[j][n][k-3] - bonetable[j].rot[k-3] ); 
+						if (v >= Q_PI)
+							v -= Q_PI * 2;
+						if (v < -Q_PI)
+							v += Q_PI * 2;
+
+						value[n] = v / bonetable[j].rotscale[k-3]; 
+						break;
+					}
+				}
+				if (n == 0)
+					Error("no animation frames: \"%s\"\n", sequence[i].name );
+
+
+				sequence[i].panim[q]->numanim[j][k] = 0;
+
+				memset( data, 0, sizeof( data ) ); 
+				pcount = data; 
+				pvalue = pcount + 1;
+
+				pcount->num.valid = 1;
+				pcount->num.total = 1;
+				pvalue->value = value[0];
+				pvalue++;
+
+				// this compression algorithm needs work
+
+				for (m = 1; m < n; m++)
+				{
+					if (pcount->num.total == 255)
+					{
+						// too many, force a new entry
+						pcount = pvalue;
+						pvalue = pcount + 1;
+						pcount->num.valid++;
+						pvalue->value = value[m];
+						pvalue++;
+					} 
+					// insert value if they're not equal, 
+					// or if we're not on a run and the run is less than 3 units
+					else if ((value[m] != value[m-1]) 
+						|| ((pcount->num.total == pcount->num.valid) && ((m < n - 1) && value[m] != value[m+1])))
+					{
+						if (pcount->num.total != pcount->num.valid)
+						{
+							//if (j == 0) printf("%d:%d   ", pcount->num.valid, pcount->num.total ); 
+							pcount = pvalue;
+							pvalue = pcount + 1;
+						}
+						pcount->num.valid++;
+						pvalue->value = value[m];
+						pvalue++;
+					}
+					pcount->num.total++;
+				}
+				//if (j == 0) printf("%d:%d\n", pcount->num.valid, pcount->num.total ); 
+
+				sequence[i].panim[q]->numanim[j][k] = pvalue - data;
+				if (sequence[i].panim[q]->numanim[j][k] == 2 && value[0] == 0)
+				{
+					sequence[i].panim[q]->numanim[j][k] = 0;
+				}
+				else
+				{
+					sequence[i].panim[q]->anim[j][k] = kalloc( pvalue - data, sizeof( mstudioanimvalue_t ) );
+					memmove( sequence[i].panim[q]->anim[j][k], data, (pvalue - data) * sizeof( mstudioanimvalue_t ) );
+				}
+				// printf("%d(%d) ", sequence[i].panim[q]->numanim[j][k], n );
+			}
+			// printf("\n");
+		}
+	}
+}
+
 void SimplifyModel (void)
 {
 	int i, j, k;
@@ -841,193 +1031,10 @@ void SimplifyModel (void)
 
 
 	// find bounding box for each sequence
-	for (i = 0; i < numseq; i++)
-	{
-		vec3_t bmin, bmax;
-
-		// find intersection box volume for each bone
-		for (j = 0; j < 3; j++)
-		{
-			bmin[j] = 9999.0;
-			bmax[j] = -9999.0;
-		}
-
-		for (q = 0; q < sequence[i].numblends; q++)
-		{
-			for (n = 0; n < sequence[i].numframes; n++)
-			{
-				float bonetransform[MAXSTUDIOBONES][3][4];	// bone transformation matrix
-				float bonematrix[3][4];						// local transformation matrix
-				vec3_t pos;
-
-				for (j = 0; j < numbones; j++)
-				{
-					vec3_t angle;
-
-					// convert to degrees
-					angle[0]	= sequence[i].panim[q]->rot[j][n][0] * (180.0 / Q_PI);
-					angle[1]	= sequence[i].panim[q]->rot[j][n][1] * (180.0 / Q_PI);
-					angle[2]	= sequence[i].panim[q]->rot[j][n][2] * (180.0 / Q_PI);
-
-					AngleMatrix( angle, bonematrix );
-
-					bonematrix[0][3] = sequence[i].panim[q]->pos[j][n][0];
-					bonematrix[1][3] = sequence[i].panim[q]->pos[j][n][1];
-					bonematrix[2][3] = sequence[i].panim[q]->pos[j][n][2];
-
-					if (bonetable[j].parent == -1)
-					{
-						MatrixCopy( bonematrix, bonetransform[j] );
-					}
-					else
-					{
-						R_ConcatTransforms (bonetransform[bonetable[j].parent], bonematrix, bonetransform[j]);
-					}
-				}
-
-				for (k = 0; k < nummodels; k++)
-				{
-					for (j = 0; j < model[k]->numverts; j++)
-					{
-						VectorTransform( model[k]->vert[j].org, bonetransform[model[k]->vert[j].bone], pos );
-
-						if (pos[0] < bmin[0]) bmin[0] = pos[0];
-						if (pos[1] < bmin[1]) bmin[1] = pos[1];
-						if (pos[2] < bmin[2]) bmin[2] = pos[2];
-						if (pos[0] > bmax[0]) bmax[0] = pos[0];
-						if (pos[1] > bmax[1]) bmax[1] = pos[1];
-						if (pos[2] > bmax[2]) bmax[2] = pos[2];
-					}
-				}
-			}
-		}
-
-		VectorCopy( bmin, sequence[i].bmin );
-		VectorCopy( bmax, sequence[i].bmax );
-
-		/*
-		printf("%s : %.0f %.0f %.0f %.0f %.0f %.0f\n", 
-			sequence[i].name, bmin[0], bmax[0], bmin[1], bmax[1], bmin[2], bmax[2] );
-		*/
-		// printf("%s  %.2f\n", sequence[i].name, sequence[i].panim[0]->pos[9][0][0] / bonetable[9].pos[0] );
-	}
+	RunThreadsOnIndividual( numseq, false, SequenceBounds );
 
 	// reduce animations
-	{
-		int total = 0;
-		int changes = 0;
-		int p;
-		
-		for (i = 0; i < numseq; i++)
-		{
-			for (q = 0; q < sequence[i].numblends; q++)
-			{
-				for (j = 0; j < numbones; j++)
-				{
-					for (k = 0; k < 6; k++)
-					{
-						mstudioanimvalue_t	*pcount, *pvalue;
-						float v;
-						short value[MAXSTUDIOANIMATIONS];
-						mstudioanimvalue_t data[MAXSTUDIOANIMATIONS];
-
-						for (n = 0; n < sequence[i].numframes; n++)
-						{
-							switch(k)
-							{
-							case 0: 
-							case 1: 
-							case 2: 
-								value[n] = ( sequence[i].panim[q]->pos[j][n][k] - bonetable[j].pos[k] ) / bonetable[j].posscale[k]; 
-								break;
-							case 3:
-							case 4:
-							case 5:
-								v = ( sequence[i].panim[q]->rot[j][n][k-3] - bonetable[j].rot[k-3] ); 
-								if (v >= Q_PI)
-									v -= Q_PI * 2;
-								if (v < -Q_PI)
-									v += Q_PI * 2;
-
-								value[n] = v / bonetable[j].rotscale[k-3]; 
-								break;
-							}
-						}
-						if (n == 0)
-							Error("no animation frames: \"%s\"\n", sequence[i].name );
-
-
-						sequence[i].panim[q]->numanim[j][k] = 0;
-
-						memset( data, 0, sizeof( data ) ); 
-						pcount = data; 
-						pvalue = pcount + 1;
-
-						pcount->num.valid = 1;
-						pcount->num.total = 1;
-						pvalue->value = value[0];
-						pvalue++;
-
-						for (m = 1, p = 0; m < n; m++)
-						{
-							if (abs(value[p] - value[m]) > 1600)
-							{
-								changes++;
-								p = m;
-							}
-						}
-
-						// this compression algorithm needs work
-
-						for (m = 1; m < n; m++)
-						{
-							if (pcount->num.total == 255)
-							{
-								// too many, force a new entry
-								pcount = pvalue;
-								pvalue = pcount + 1;
-								pcount->num.valid++;
-								pvalue->value = value[m];
-								pvalue++;
-							} 
-							// insert value if they're not equal, 
-							// or if we're not on a run and the run is less than 3 units
-							else if ((value[m] != value[m-1]) 
-								|| ((pcount->num.total == pcount->num.valid) && ((m < n - 1) && value[m] != value[m+1])))
-							{
-								total++;
-								if (pcount->num.total != pcount->num.valid)
-								{
-									//if (j == 0) printf("%d:%d   ", pcount->num.valid, pcount->num.total ); 
-									pcount = pvalue;
-									pvalue = pcount + 1;
-								}
-								pcount->num.valid++;
-								pvalue->value = value[m];
-								pvalue++;
-							}
-							pcount->num.total++;
-						}
-						//if (j == 0) printf("%d:%d\n", pcount->num.valid, pcount->num.total ); 
-
-						sequence[i].panim[q]->numanim[j][k] = pvalue - data;
-						if (sequence[i].panim[q]->numanim[j][k] == 2 && value[0] == 0)
-						{
-							sequence[i].panim[q]->numanim[j][k] = 0;
-						}
-						else
-						{
-							sequence[i].panim[q]->anim[j][k] = kalloc( pvalue - data, sizeof( mstudioanimvalue_t ) );
-							memmove( sequence[i].panim[q]->anim[j][k], data, (pvalue - data) * sizeof( mstudioanimvalue_t ) );
-						}
-						// printf("%d(%d) ", sequence[i].panim[q]->numanim[j][k], n );
-					}
-					// printf("\n");
-				}
-			}
-		}
-		// printf("total %.0f changes %.0f\n", total, changes );
-	}
+	RunThreadsOnIndividual( numseq, false, CompressSequence );
 
 	// auto groups
 	if (numseqgroups == 1 && maxseqgroupsize < 1024 * 1024) 
@@ -3360,7 +3367,7 @@ int main (int argc, char **argv)
 	gamma = 1.8;
 
 	if (argc == 1)
-		Error ("usage: studiomdl [-t texture] -r(tag reversed) -n(tag bad normals) -f(flip all triangles) [-a normal_blend_angle] -h(dump hboxes) -i(ignore warnings) -p(force power of 2 textures) [-g max_sequencegroup_size(K)] file.qc");
+		Error ("usage: studiomdl [-t texture] -r(tag reversed) -n(tag bad normals) -f(flip all triangles) [-a normal_blend_angle] -h(dump hboxes) -i(ignore warnings) -p(force power of 2 textures) -b(best strips) [-g max_sequencegroup_size(K)] file.qc");
 		
 	for (i = 1; i < argc - 1; i++) {
 		if (argv[i][0] == '-') {
@@ -3403,6 +3410,9 @@ int main (int argc, char **argv)
 			case 'i':
 				ignore_warnings = 1;
 				break;
+			case 'b':
+				best_strips = 1;
+				break;
 			}
 		}
 	}	
@@ -3410,6 +3420,8 @@ int main (int argc, char **argv)
 	strcpy( sequencegroup[numseqgroups].label, "default" );
 	numseqgroups = 1;
 
+	ThreadSetDefault ();
+
 //
 // load the script
 //
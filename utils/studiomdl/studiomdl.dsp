@@ -109,6 +109,10 @@ SOURCE=.\studiomdl.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\common\threads.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\common\trilib.c
 # End Source File
 # Begin Source File
@@ -141,6 +145,10 @@ SOURCE=..\common\scriplib.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\common\threads.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\studiomdl.h
 # End Source File
 # Begin Source File
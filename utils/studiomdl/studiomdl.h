@@ -51,6 +51,7 @@ EXTERN	int			flip_triangles;
 EXTERN	float		normal_blend;
 EXTERN	int			dump_hboxes;
 EXTERN	int			ignore_warnings;
+EXTERN	int			best_strips;		// slower strip search that makes fewer strips
 
 EXTERN	vec3_t		eyeposition;
 EXTERN	int			gflags;
@@ -331,6 +332,11 @@ typedef struct
 
 	int skinref;
 	int numnorms;
+
+	// triangle commands from BuildTris
+	byte *cmds;
+	int numcmdbytes;
+	int numstrips;
 } s_mesh_t;
 
 
@@ -393,7 +399,7 @@ EXTERN	int numbodyparts;
 EXTERN	s_bodypart_t bodypart[MAXSTUDIOBODYPARTS];
 
 
-extern int BuildTris (s_trianglevert_t (*x)[3], s_mesh_t *y, byte **ppdata );
+extern int BuildTris (s_trianglevert_t (*x)[3], s_mesh_t *y, byte **ppdata, int *numstrips );
 
 
 
@@ -27,66 +27,124 @@
 #include "..\..\engine\studio.h"
 #include "studiomdl.h"
 
-int		used[MAXSTUDIOTRIANGLES];
-
-// the command list holds counts and s/t values that are valid for
-// every frame
-short	commands[MAXSTUDIOTRIANGLES * 13];
-int		numcommands;
-
 // all frames will have their vertexes rearranged and expanded
 // so they are in the order expected by the command list
 
-int		allverts, alltris;
-
-int		stripverts[MAXSTUDIOTRIANGLES+2];
-int		striptris[MAXSTUDIOTRIANGLES+2];
-int		stripcount;
-
-int		neighbortri[MAXSTUDIOTRIANGLES][3];
-int		neighboredge[MAXSTUDIOTRIANGLES][3];
+// everything needed to strip one mesh, so meshes can be done in parallel
+typedef struct
+{
+	s_trianglevert_t	(*triangles)[3];
+	s_mesh_t	*pmesh;
+
+	int		*used;
+	int		(*neighbortri)[3];
+	int		(*neighboredge)[3];
+
+	int		*stripverts;
+	int		*striptris;
+	int		stripcount;
+
+	// the command list holds counts and s/t values that are valid for
+	// every frame
+	short	*commands;
+	int		numcommands;
+	int		numcommandnodes;
+} tristrip_t;
+
+// triangle edges are hashed by their two verts to find neighbors
+typedef struct edgehash_s
+{
+	int		tri;
+	int		edge;
+	struct edgehash_s	*next;
+} edgehash_t;
 
+#define	EDGE_HASH_SIZE	4096
 
-s_trianglevert_t (*triangles)[3];
-s_mesh_t *pmesh;
+unsigned EdgeHash (s_trianglevert_t *v0, s_trianglevert_t *v1)
+{
+	unsigned	hash;
+	
+	hash = v0->vertindex * 31 + v0->normindex * 7 + v0->s * 3 + v0->t;
+	hash = hash * 131 + v1->vertindex * 31 + v1->normindex * 7 + v1->s * 3 + v1->t;
+	return hash & (EDGE_HASH_SIZE - 1);
+}
 
+/*
+================
+FindNeighbors
 
-void	FindNeighbor (int starttri, int startv)
+Links each triangle edge to the first later triangle that shares it
+in the opposite direction.  The hash chains are kept in triangle order
+so the links come out the same as a scan of every later triangle.
+================
+*/
+void FindNeighbors (tristrip_t *ts)
 {
-	s_trianglevert_t			m1, m2;
-	int			j;
+	edgehash_t	*hash[EDGE_HASH_SIZE];
+	edgehash_t	*edges, *e;
+	s_trianglevert_t	m1, m2;
 	s_trianglevert_t	*last, *check;
-	int			k;
-
-	// used[starttri] |= (1 << startv);
+	int		i, j, k, startv;
+	unsigned	h;
 
-	last = &triangles[starttri][0];
+	memset (hash, 0, sizeof(hash));
+	edges = malloc (ts->pmesh->numtris * 3 * sizeof(*edges));
 
-	m1 = last[(startv+1)%3];
-	m2 = last[(startv+0)%3];
+	for (i=ts->pmesh->numtris-1 ; i>=0 ; i--)
+	{
+		for (k=2 ; k>=0 ; k--)
+		{
+			e = &edges[i*3+k];
+			e->tri = i;
+			e->edge = k;
+			h = EdgeHash (&ts->triangles[i][k], &ts->triangles[i][(k+1)%3]);
+			e->next = hash[h];
+			hash[h] = e;
+		}
+	}
 
-	for (j=starttri+1, check=&triangles[starttri+1][0] ; j<pmesh->numtris ; j++, check += 3)
+	for (i=0 ; i<ts->pmesh->numtris; i++)
 	{
-		if (used[j] == 7)
-			continue;
-		for (k=0 ; k<3 ; k++)
+		for (startv = 0; startv < 3; startv++)
 		{
-			if (memcmp(&check[k],&m1,sizeof(m1)))
-				continue;
-			if (memcmp(&check[ (k+1)%3 ],&m2,sizeof(m2)))
+			if (ts->used[i] & (1 << startv))
 				continue;
 
-			neighbortri[starttri][startv] = j;
-			neighboredge[starttri][startv] = k;
+			last = &ts->triangles[i][0];
 
-			neighbortri[j][k] = starttri;
-			neighboredge[j][k] = startv;
+			m1 = last[(startv+1)%3];
+			m2 = last[(startv+0)%3];
 
-			used[starttri] |= (1 << startv);
-			used[j] |= (1 << k);
-			return;
+			for (e = hash[EdgeHash (&m1, &m2)] ; e ; e = e->next)
+			{
+				j = e->tri;
+				k = e->edge;
+				if (j <= i)
+					continue;
+				if (ts->used[j] == 7)
+					continue;
+
+				check = &ts->triangles[j][0];
+				if (memcmp(&check[k],&m1,sizeof(m1)))
+					continue;
+				if (memcmp(&check[ (k+1)%3 ],&m2,sizeof(m2)))
+					continue;
+
+				ts->neighbortri[i][startv] = j;
+				ts->neighboredge[i][startv] = k;
+
+				ts->neighbortri[j][k] = i;
+				ts->neighboredge[j][k] = startv;
+
+				ts->used[i] |= (1 << startv);
+				ts->used[j] |= (1 << k);
+				break;
+			}
 		}
 	}
+
+	free (edges);
 }
 
 
@@ -95,42 +153,42 @@ void	FindNeighbor (int starttri, int startv)
 StripLength
 ================
 */
-int	StripLength (int starttri, int startv)
+int	StripLength (tristrip_t *ts, int starttri, int startv)
 {
 	int			j;
 	int			k;
 
-	used[starttri] = 2;
+	ts->used[starttri] = 2;
 
-	stripverts[0] = (startv)%3;
-	stripverts[1] = (startv+1)%3;
-	stripverts[2] = (startv+2)%3;
+	ts->stripverts[0] = (startv)%3;
+	ts->stripverts[1] = (startv+1)%3;
+	ts->stripverts[2] = (startv+2)%3;
 
-	striptris[0] = starttri;
-	striptris[1] = starttri;
-	striptris[2] = starttri;
-	stripcount = 3;
+	ts->striptris[0] = starttri;
+	ts->striptris[1] = starttri;
+	ts->striptris[2] = starttri;
+	ts->stripcount = 3;
 
 	while( 1 )
 	{
-		if (stripcount & 1)
+		if (ts->stripcount & 1)
 		{
-			j = neighbortri[starttri][(startv+1)%3];
-			k = neighboredge[starttri][(startv+1)%3];
+			j = ts->neighbortri[starttri][(startv+1)%3];
+			k = ts->neighboredge[starttri][(startv+1)%3];
 		}
 		else
 		{
-			j = neighbortri[starttri][(startv+2)%3];
-			k = neighboredge[starttri][(startv+2)%3];
+			j = ts->neighbortri[starttri][(startv+2)%3];
+			k = ts->neighboredge[starttri][(startv+2)%3];
 		}
-		if (j == -1 || used[j])
+		if (j == -1 || ts->used[j])
 			goto done;
 
-		stripverts[stripcount] = (k+2)%3;
-		striptris[stripcount] = j;
-		stripcount++;
+		ts->stripverts[ts->stripcount] = (k+2)%3;
+		ts->striptris[ts->stripcount] = j;
+		ts->stripcount++;
 
-		used[j] = 2;
+		ts->used[j] = 2;
 
 		starttri = j;
 		startv = k;
@@ -138,12 +196,11 @@ int	StripLength (int starttri, int startv)
 
 done:
 
-	// clear the temp used flags
-	for (j=0 ; j<pmesh->numtris ; j++)
-		if (used[j] == 2)
-			used[j] = 0;
+	// clear the temp used flags, only the strip's own tris were set
+	for (j=0 ; j<ts->stripcount ; j++)
+		ts->used[ts->striptris[j]] = 0;
 
-	return stripcount;
+	return ts->stripcount;
 }
 
 /*
@@ -151,35 +208,35 @@ done:
 FanLength
 ===========
 */
-int	FanLength (int starttri, int startv)
+int	FanLength (tristrip_t *ts, int starttri, int startv)
 {
 	int		j;
 	int		k;
 
-	used[starttri] = 2;
+	ts->used[starttri] = 2;
 
-	stripverts[0] = (startv)%3;
-	stripverts[1] = (startv+1)%3;
-	stripverts[2] = (startv+2)%3;
+	ts->stripverts[0] = (startv)%3;
+	ts->stripverts[1] = (startv+1)%3;
+	ts->stripverts[2] = (startv+2)%3;
 
-	striptris[0] = starttri;
-	striptris[1] = starttri;
-	striptris[2] = starttri;
-	stripcount = 3;
+	ts->striptris[0] = starttri;
+	ts->striptris[1] = starttri;
+	ts->striptris[2] = starttri;
+	ts->stripcount = 3;
 
 	while( 1 )
 	{
-		j = neighbortri[starttri][(startv+2)%3];
-		k = neighboredge[starttri][(startv+2)%3];
+		j = ts->neighbortri[starttri][(startv+2)%3];
+		k = ts->neighboredge[starttri][(startv+2)%3];
 
-		if (j == -1 || used[j])
+		if (j == -1 || ts->used[j])
 			goto done;
 
-		stripverts[stripcount] = (k+2)%3;
-		striptris[stripcount] = j;
-		stripcount++;
+		ts->stripverts[ts->stripcount] = (k+2)%3;
+		ts->striptris[ts->stripcount] = j;
+		ts->stripcount++;
 
-		used[j] = 2;
+		ts->used[j] = 2;
 
 		starttri = j;
 		startv = k;
@@ -187,12 +244,32 @@ int	FanLength (int starttri, int startv)
 
 done:
 
-	// clear the temp used flags
-	for (j=0 ; j<pmesh->numtris ; j++)
-		if (used[j] == 2)
-			used[j] = 0;
+	// clear the temp used flags, only the fan's own tris were set
+	for (j=0 ; j<ts->stripcount ; j++)
+		ts->used[ts->striptris[j]] = 0;
+
+	return ts->stripcount;
+}
+
+/*
+===========
+FreeNeighbors
+
+Number of unused triangles next to tri, for best_strips
+===========
+*/
+int FreeNeighbors (tristrip_t *ts, int tri)
+{
+	int		e, j, count;
 
-	return stripcount;
+	count = 0;
+	for (e=0 ; e<3 ; e++)
+	{
+		j = ts->neighbortri[tri][e];
+		if (j != -1 && !ts->used[j])
+			count++;
+	}
+	return count;
 }
 
 
@@ -202,61 +279,66 @@ BuildTris
 
 Generate a list of trifans or strips
 for the model, which holds for all frames
+
+The command list is allocated here and freed by the caller.
+
+With best_strips set, every starting triangle is tried and ties go to
+the one with the fewest free neighbors, so fewer single triangles get
+stranded.  This gives fewer strips but different output.
 ================
 */
-int	numcommandnodes;
-
-int BuildTris (s_trianglevert_t (*x)[3], s_mesh_t *y, byte **ppdata )
+int BuildTris (s_trianglevert_t (*x)[3], s_mesh_t *y, byte **ppdata, int *numstrips )
 {
+	tristrip_t	ts;
 	int		i, j, k, m;
 	int		startv;
-	int		len, bestlen, besttype;
-	int		bestverts[MAXSTUDIOTRIANGLES];
-	int		besttris[MAXSTUDIOTRIANGLES];
-	int		peak[MAXSTUDIOTRIANGLES];
+	int		len, bestlen, besttype, bestfree, freecount;
+	int		*bestverts;
+	int		*besttris;
+	int		*peak;
 	int		type;
 	int		total = 0;
 	long 	t;
 	int		maxlen;
 
-	triangles = x;
-	pmesh = y;
+	memset (&ts, 0, sizeof(ts));
+	ts.triangles = x;
+	ts.pmesh = y;
 
+	ts.used = kalloc (y->numtris + 1, sizeof(int));
+	ts.neighbortri = kalloc (y->numtris + 1, sizeof(*ts.neighbortri));
+	ts.neighboredge = kalloc (y->numtris + 1, sizeof(*ts.neighboredge));
+	ts.stripverts = kalloc (y->numtris + 2, sizeof(int));
+	ts.striptris = kalloc (y->numtris + 2, sizeof(int));
+	ts.commands = kalloc (y->numtris * 13 + 1, sizeof(short));
+	bestverts = kalloc (y->numtris + 2, sizeof(int));
+	besttris = kalloc (y->numtris + 2, sizeof(int));
+	peak = kalloc (y->numtris + 1, sizeof(int));
 
 	t = time( NULL );
 
-	for (i=0 ; i<pmesh->numtris ; i++)
+	for (i=0 ; i<ts.pmesh->numtris ; i++)
 	{
-		neighbortri[i][0] = neighbortri[i][1] = neighbortri[i][2] = -1;
-		used[i] = 0;
-		peak[i] = pmesh->numtris;
+		ts.neighbortri[i][0] = ts.neighbortri[i][1] = ts.neighbortri[i][2] = -1;
+		ts.used[i] = 0;
+		peak[i] = ts.pmesh->numtris;
 	}
 
 	// printf("finding neighbors\n");
-	for (i=0 ; i<pmesh->numtris; i++)
-	{
-		for (k = 0; k < 3; k++)
-		{
-			if (used[i] & (1 << k))
-				continue;
-
-			FindNeighbor( i, k );
-		}
-		// printf("%d", used[i] );
-	}
-	// printf("\n");
+	FindNeighbors (&ts);
 
 	//
 	// build tristrips
 	//
-	numcommandnodes = 0;
-	numcommands = 0;
-	memset (used, 0, sizeof(used));
+	ts.numcommandnodes = 0;
+	ts.numcommands = 0;
+	memset (ts.used, 0, ts.pmesh->numtris * sizeof(int));
 
-	for (i=0 ; i<pmesh->numtris ;)
+	besttype = 0;
+	for (i=0 ; i<ts.pmesh->numtris ;)
 	{
 		// pick an unused triangle and start the trifan
-		if (used[i])
+		if (ts.used[i])
 		{
 			i++;
 			continue;
@@ -264,38 +346,42 @@ int BuildTris (s_trianglevert_t (*x)[3], s_mesh_t *y, byte **ppdata )
 
 		maxlen = 9999;
 		bestlen = 0;
+		bestfree = 3;
 		m = 0;
-		for (k = i; k < pmesh->numtris && bestlen < 127; k++)
+		for (k = i; k < ts.pmesh->numtris && (best_strips || bestlen < 127); k++)
 		{
 			int localpeak = 0;
 
-			if (used[k])
+			if (ts.used[k])
 				continue;
 
-			if (peak[k] <= bestlen)
+			if (peak[k] < bestlen || (!best_strips && peak[k] == bestlen))
 				continue;
 
+			freecount = best_strips ? FreeNeighbors (&ts, k) : 0;
+
 			m++;
 			for (type = 0 ; type < 2 ; type++)
 			{
 				for (startv =0 ; startv < 3 ; startv++)
 				{
 					if (type == 1)
-						len = FanLength (k, startv);
+						len = FanLength (&ts, k, startv);
 					else
-						len = StripLength (k, startv);
+						len = StripLength (&ts, k, startv);
 					if (len > 127)
 					{
 						// skip these, they are too long to encode
 					}
-					else if (len > bestlen)
+					else if (len > bestlen || (best_strips && len == bestlen && freecount < bestfree))
 					{
 						besttype = type;
 						bestlen = len;
+						bestfree = freecount;
 						for (j=0 ; j<bestlen ; j++)
 						{
-							besttris[j] = striptris[j];
-							bestverts[j] = stripverts[j];
+							besttris[j] = ts.striptris[j];
+							bestverts[j] = ts.stripverts[j];
 						}
 						// printf("%d %d\n", k, bestlen );
 					}
@@ -304,7 +390,7 @@ int BuildTris (s_trianglevert_t (*x)[3], s_mesh_t *y, byte **ppdata )
 				}
 			}
 			peak[k] = localpeak;
-			if (localpeak == maxlen)
+			if (localpeak == maxlen && !best_strips)
 				break;
 		}
 		total += (bestlen - 2);
@@ -315,39 +401,48 @@ int BuildTris (s_trianglevert_t (*x)[3], s_mesh_t *y, byte **ppdata )
 
 		// mark the tris on the best strip as used
 		for (j=0 ; j<bestlen ; j++)
-			used[besttris[j]] = 1;
+			ts.used[besttris[j]] = 1;
 
 		if (besttype == 1)
-			commands[numcommands++] = -bestlen;
+			ts.commands[ts.numcommands++] = -bestlen;
 		else
-			commands[numcommands++] = bestlen;
+			ts.commands[ts.numcommands++] = bestlen;
 
 		for (j=0 ; j<bestlen ; j++)
 		{
 			s_trianglevert_t *tri;
 
-			tri = &triangles[besttris[j]][bestverts[j]];
+			tri = &ts.triangles[besttris[j]][bestverts[j]];
 
-			commands[numcommands++] = tri->vertindex;
-			commands[numcommands++] = tri->normindex;
-			commands[numcommands++] = tri->s;
-			commands[numcommands++] = tri->t;
+			ts.commands[ts.numcommands++] = tri->vertindex;
+			ts.commands[ts.numcommands++] = tri->normindex;
+			ts.commands[ts.numcommands++] = tri->s;
+			ts.commands[ts.numcommands++] = tri->t;
 		}
 		// printf("%d ", bestlen - 2 );
-		numcommandnodes++;
+		ts.numcommandnodes++;
 
 		if (t != time(NULL))
 		{
-			printf("%2d%%\r", (total * 100) / pmesh->numtris );
+			printf("%2d%%\r", (total * 100) / ts.pmesh->numtris );
 			t = time(NULL);
 		}
 	}
 
-	commands[numcommands++] = 0;		// end of list marker
+	ts.commands[ts.numcommands++] = 0;		// end of list marker
+
+	free (ts.used);
+	free (ts.neighbortri);
+	free (ts.neighboredge);
+	free (ts.stripverts);
+	free (ts.striptris);
+	free (bestverts);
+	free (besttris);
+	free (peak);
 
-	*ppdata = (byte *)commands;
+	*ppdata = (byte *)ts.commands;
+	*numstrips = ts.numcommandnodes;
 
 	// printf("%d %d %d\n", numcommandnodes, numcommands, pmesh->numtris  );
-	return numcommands * sizeof( short );
+	return ts.numcommands * sizeof( short );
 }
-
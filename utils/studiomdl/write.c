@@ -28,13 +28,13 @@
 #include "lbmlib.h"
 #include "scriplib.h"
 #include "mathlib.h"
+#include "threads.h"
 #include "..\..\engine\studio.h"
 #include "studiomdl.h"
 
 
 int totalframes = 0;
 float totalseconds = 0;
-extern int numcommandnodes;
 
 
 
@@ -376,6 +376,16 @@ void WriteTextures( )
 }
 
 
+// the model whose meshes are being stripped
+s_model_t *stripmodel;
+
+void BuildMeshTris( int j )
+{
+	s_mesh_t *pmesh = stripmodel->pmesh[j];
+
+	pmesh->numcmdbytes = BuildTris( pmesh->triangle, pmesh, &pmesh->cmds, &pmesh->numstrips );
+}
+
 void WriteModel( )
 {
 	int i, j, k;
@@ -487,32 +497,37 @@ void WriteModel( )
 		pData += pmodel[i].nummesh * sizeof( mstudiomesh_t );
 		ALIGN( pData );
 
-		total_tris = 0;
-		total_strips = 0;
 		for (j = 0; j < model[i]->nummesh; j++)
 		{
-			int numCmdBytes;
-			byte *pCmdSrc;
-
-			pmesh[j].numtris	= model[i]->pmesh[j]->numtris;
-			pmesh[j].skinref	= model[i]->pmesh[j]->skinref;
-			pmesh[j].numnorms	= model[i]->pmesh[j]->numnorms;
-
 			psrctri				= (s_trianglevert_t *)(model[i]->pmesh[j]->triangle);
-			for (k = 0; k < pmesh[j].numtris * 3; k++) 
+			for (k = 0; k < model[i]->pmesh[j]->numtris * 3; k++) 
 			{
 				psrctri->normindex	= normmap[psrctri->normindex];
 				psrctri++;
 			}
+		}
 
-			numCmdBytes = BuildTris( model[i]->pmesh[j]->triangle, model[i]->pmesh[j], &pCmdSrc );
+		// strip all the meshes at once
+		stripmodel = model[i];
+		RunThreadsOnIndividual( model[i]->nummesh, false, BuildMeshTris );
+
+		total_tris = 0;
+		total_strips = 0;
+		for (j = 0; j < model[i]->nummesh; j++)
+		{
+			pmesh[j].numtris	= model[i]->pmesh[j]->numtris;
+			pmesh[j].skinref	= model[i]->pmesh[j]->skinref;
+			pmesh[j].numnorms	= model[i]->pmesh[j]->numnorms;
 
 			pmesh[j].triindex	= (pData - pStart);
-			memcpy( pData, pCmdSrc, numCmdBytes );
-			pData += numCmdBytes;
+			memcpy( pData, model[i]->pmesh[j]->cmds, model[i]->pmesh[j]->numcmdbytes );
+			pData += model[i]->pmesh[j]->numcmdbytes;
 			ALIGN( pData );
 			total_tris += pmesh[j].numtris;
-			total_strips += numcommandnodes;
+			total_strips += model[i]->pmesh[j]->numstrips;
+
+			free( model[i]->pmesh[j]->cmds );
+			model[i]->pmesh[j]->cmds = NULL;
 		}
 		printf("mesh      %6d bytes (%d tris, %d strips)\n", pData - cur, total_tris, total_strips);
 		cur = (int)pData;
@@ -39,6 +39,12 @@ int		bitlongs;
 qboolean		fastvis;
 qboolean		verbose;
 
+qboolean		checkpoint;		// save finished portals as we go
+qboolean		resume;			// pick up from a previous checkpoint
+char			checkpointfile[1024];
+FILE			*checkpointhandle;
+double			lastcheckpoint;
+
 //=============================================================================
 
 void PlaneFromWinding (winding_t *w, plane_t *plane)
@@ -142,6 +148,167 @@ portal_t *GetNextPortal (void)
 	return p;
 }
 
+/*
+=============
+WriteCheckpointPortal
+=============
+*/
+void WriteCheckpointPortal (portal_t *p)
+{
+	int		portalnum;
+
+	portalnum = p - portals;
+	SafeWrite (checkpointhandle, &portalnum, sizeof(portalnum));
+	SafeWrite (checkpointhandle, p->visbits, bitbytes);
+}
+
+/*
+=============
+CheckpointPortal
+
+Appends a finished portal to the checkpoint file, flushing it to disk
+every CHECKPOINT_INTERVAL seconds.
+=============
+*/
+void CheckpointPortal (portal_t *p)
+{
+	double	now;
+
+	if (!checkpointhandle)
+		return;
+
+	ThreadLock ();
+
+	WriteCheckpointPortal (p);
+
+	now = I_FloatTime ();
+	if (now - lastcheckpoint >= CHECKPOINT_INTERVAL)
+	{
+		fflush (checkpointhandle);
+		lastcheckpoint = now;
+	}
+
+	ThreadUnlock ();
+}
+
+/*
+=============
+CheckpointOptions
+
+The command line options that change the visbits.
+=============
+*/
+int CheckpointOptions (void)
+{
+	int		options;
+
+	options = 0;
+	if (fastvis)
+		options |= CHECKPOINT_FASTVIS;
+
+	return options;
+}
+
+/*
+=============
+OpenCheckpoint
+
+With -resume, restores the portals finished by an earlier run on the
+same bsp with the same options.  The checkpoint is then rewritten from the restored portals,
+which drops a record torn by the interrupted run.
+Returns the number of portals restored.
+=============
+*/
+int OpenCheckpoint (void)
+{
+	vischeckpoint_t	header;
+	FILE		*f;
+	portal_t	*p;
+	byte		*visbits;
+	int			portalnum;
+	int			restored;
+	int			i;
+
+	restored = 0;
+
+	if (resume)
+	{
+		f = fopen (checkpointfile, "rb");
+		if (!f)
+			printf ("no checkpoint %s, starting from scratch\n", checkpointfile);
+		else
+		{
+			if (fread (&header, sizeof(header), 1, f) != 1
+			|| header.ident != CHECKPOINT_ID
+			|| header.version != CHECKPOINT_VERSION
+			|| header.checksum != BSPChecksum ()
+			|| header.numportals != numportals
+			|| header.portalleafs != portalleafs)
+			{
+				printf ("WARNING: %s doesn't match this bsp, starting from scratch\n", checkpointfile);
+			}
+			else if (header.options != CheckpointOptions ())
+			{
+				printf ("WARNING: %s was made with different options, starting from scratch\n", checkpointfile);
+			}
+			else
+			{
+				visbits = malloc (bitbytes);
+				while (fread (&portalnum, sizeof(portalnum), 1, f) == 1
+				&& fread (visbits, bitbytes, 1, f) == 1)
+				{
+					if (portalnum < 0 || portalnum >= numportals*2)
+						break;
+					p = &portals[portalnum];
+					if (p->status == stat_done)
+						continue;
+					p->visbits = visbits;
+					p->status = stat_done;
+					visbits = malloc (bitbytes);
+					restored++;
+				}
+				free (visbits);
+			}
+			fclose (f);
+		}
+
+		printf ("%i portals restored from %s\n", restored, checkpointfile);
+	}
+
+	header.ident = CHECKPOINT_ID;
+	header.version = CHECKPOINT_VERSION;
+	header.checksum = BSPChecksum ();
+	header.numportals = numportals;
+	header.portalleafs = portalleafs;
+	header.options = CheckpointOptions ();
+
+	checkpointhandle = SafeOpenWrite (checkpointfile);
+	SafeWrite (checkpointhandle, &header, sizeof(header));
+	for (i=0, p=portals ; i<numportals*2 ; i++, p++)
+	{
+		if (p->status == stat_done)
+			WriteCheckpointPortal (p);
+	}
+	fflush (checkpointhandle);
+	lastcheckpoint = I_FloatTime ();
+
+	return restored;
+}
+
+/*
+=============
+CloseCheckpoint
+=============
+*/
+void CloseCheckpoint (void)
+{
+	if (!checkpointhandle)
+		return;
+
+	fclose (checkpointhandle);
+	checkpointhandle = NULL;
+}
+
 /*
 ==============
 LeafThread
@@ -158,6 +325,7 @@ void LeafThread (int thread)
 			break;
 			
 		PortalFlow (p);
+		CheckpointPortal (p);
 		
 		qprintf ("portal:%4i  mightsee:%4i  cansee:%4i\n", (int)(p - portals), p->nummightsee, p->numcansee);
 	} while (1);
@@ -275,6 +443,7 @@ CalcPortalVis
 void CalcPortalVis (void)
 {
 	int		i;
+	int		restored;
 
 // fastvis just uses mightsee for a very loose bound
 	if (fastvis)
@@ -288,8 +457,14 @@ void CalcPortalVis (void)
 	}
 	
 	leafon = 0;
+
+	restored = 0;
+	if (checkpoint)
+		restored = OpenCheckpoint ();
 	
-	RunThreadsOn (numportals*2, true, LeafThread);
+	RunThreadsOn (numportals*2 - restored, true, LeafThread);
+
+	CloseCheckpoint ();
 
 	qprintf ("portalcheck: %i  portaltest: %i  portalpass: %i\n",c_portalcheck, c_portaltest, c_portalpass);
 	qprintf ("c_vistest: %i  c_mighttest: %i\n",c_vistest, c_mighttest);
@@ -474,6 +649,17 @@ int main (int argc, char **argv)
 			printf ("verbose = true\n");
 			verbose = true;
 		}
+		else if (!strcmp(argv[i], "-checkpoint"))
+		{
+			printf ("checkpoint = true\n");
+			checkpoint = true;
+		}
+		else if (!strcmp(argv[i], "-resume"))
+		{
+			printf ("resume = true\n");
+			checkpoint = true;
+			resume = true;
+		}
 		else if (argv[i][0] == '-')
 			Error ("Unknown option \"%s\"", argv[i]);
 		else
@@ -481,7 +667,7 @@ int main (int argc, char **argv)
 	}
 
 	if (i != argc - 1)
-		Error ("usage: vis [-threads #] [-level 0-4] [-fast] [-v] bspfile");
+		Error ("usage: vis [-threads #] [-level 0-4] [-fast] [-v] [-checkpoint] [-resume] bspfile");
 
 	start = I_FloatTime ();
 	
@@ -500,6 +686,10 @@ int main (int argc, char **argv)
 	strcat (portalfile, ".prt");
 	
 	LoadPortals (portalfile);
+
+	strcpy (checkpointfile, argv[i]);
+	StripExtension (checkpointfile);
+	strcat (checkpointfile, ".vck");
 	
 	uncompressed = malloc(bitbytes*portalleafs);
 	memset (uncompressed, 0, bitbytes*portalleafs);
@@ -514,6 +704,10 @@ int main (int argc, char **argv)
 	CalcAmbientSounds ();
 
 	WriteBSPFile (source);	
+
+	// the bsp now holds everything the checkpoint did
+	if (checkpoint)
+		remove (checkpointfile);
 	
 //	unlink (portalfile);
 
@@ -18,6 +18,24 @@
 
 #define	PORTALFILE	"PRT1"
 
+#define	CHECKPOINT_ID		(('P'<<24)+('C'<<16)+('S'<<8)+'V')
+#define	CHECKPOINT_VERSION	2
+#define	CHECKPOINT_INTERVAL	30		// seconds between checkpoint flushes
+
+// a checkpoint file is this header followed by any number of
+// (int portalnum, byte visbits[bitbytes]) records, in completion order
+#define	CHECKPOINT_FASTVIS	1		// options bit: visbits are just mightsee
+
+typedef struct
+{
+	int		ident;
+	int		version;
+	int		checksum;		// BSPChecksum() of the source bsp
+	int		numportals;
+	int		portalleafs;
+	int		options;		// CHECKPOINT_ options the visbits were made with
+} vischeckpoint_t;
+
 //#define	ON_EPSILON	0.1
 
 typedef struct